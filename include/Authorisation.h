@@ -1,18 +1,56 @@
 #ifndef AUTHORISATION_H
 #define AUTHORISATION_H
 
-#include <string>
-#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include "Logger.h"
+#include "HttpConnectionPool.h"
 
+// One issued access token. Immutable once published: a refresh publishes a
+// new snapshot instead of modifying the current one.
+struct AuthToken {
+    std::string accessToken;
+    std::string bearerHeader; // "Authorization: Bearer <token>", ready for curl
+    time_t expiryTime = 0;    // Unix timestamp when the token expires
+};
 
+struct AuthStats {
+    uint64_t refreshes = 0;     // successful refreshes/re-authentications after startup
+    uint64_t failures = 0;      // failed attempts
+    int64_t lastRefreshNs = 0;  // duration of the last successful refresh
+    time_t expiryTime = 0;      // expiry of the current token
+};
 
+// Holds the Deribit access token and keeps it valid from a background thread,
+// which renews it ahead of expiry and retries with backoff on failure. The
+// order path only loads a pointer to the published snapshot: it never waits
+// for a refresh, takes no lock and does no I/O.
 class Authorization {
 public:
-    Authorization(const std::string& clientId, const std::string& clientSecret);
-    // Returns the current valid access token (refreshes if expired)
-    std::string getAccessToken();
+    // poolOptions supplies the endpoint and TLS settings; pool sizing is fixed for auth traffic.
+    // Authenticates once before returning, then starts the refresher.
+    Authorization(const std::string& clientId, const std::string& clientSecret,
+                  const HttpPoolOptions& poolOptions = HttpPoolOptions());
+    ~Authorization();
+
+    Authorization(const Authorization&) = delete;
+    Authorization& operator=(const Authorization&) = delete;
+
+    // Copy of the current access token (empty if authentication never succeeded).
+    std::string getAccessToken() const;
+    // The current snapshot. It stays valid until kRetainedTokens further
+    // refreshes have been published, so copy what you need rather than keep it.
+    const AuthToken& currentToken() const { return *current.load(std::memory_order_acquire); }
+    AuthStats stats() const;
+
     std::string getClientId(){
     	return clientId;
     }
@@ -20,28 +58,48 @@ public:
     	return clientSecret;
     }
 
-
 private:
     std::string clientId;
     std::string clientSecret;
-    std::string accessToken;
+    // Refresher thread only (and the constructor before it starts).
     std::string refreshToken;
-    time_t expiryTime; // Unix timestamp when token expires
-    std::mutex tokenMutex;
- 
+    std::chrono::system_clock::time_point refreshAt;
+    HttpConnectionPool pool; // single kept-alive connection for auth requests
+    std::string authUrl;
+
+    // Refreshes are minutes apart, so a reader would have to stall across
+    // several of them to see a snapshot freed.
+    static constexpr size_t kRetainedTokens = 4;
+    std::atomic<const AuthToken*> current;
+    // Owns the published snapshot and the ones before it, newest last. Written
+    // by the refresher thread (and the constructor before it starts).
+    std::deque<std::unique_ptr<const AuthToken>> published;
+
+    std::atomic<uint64_t> refreshes;
+    std::atomic<uint64_t> failures;
+    std::atomic<int64_t> lastRefreshNs;
+
+    std::atomic<bool> running;
+    std::thread refresher;
+    std::mutex refreshMutex;
+    std::condition_variable refreshCv;
+
     // Makes a POST request to Deribit and returns the response as a string.
     std::string httpPost(const std::string& url, const std::string& jsonPayload);
-    
-    
+
     // Perform initial authentication to get tokens.
     bool performAuthentication();
-    
+
     // Perform a token refresh.
     bool performTokenRefresh();
-    
-    // Update token details.
+
+    // Publish a new token snapshot.
     void updateToken(const std::string& newToken, const std::string& newRefreshToken, int expiresIn);
-};
+    void publish(std::unique_ptr<const AuthToken> token);
 
-#endif 
+    void refreshLoop();
+    // Sleeps until 'deadline' or shutdown; returns false on shutdown.
+    bool waitUntil(std::chrono::system_clock::time_point deadline);
+};
 
+#endif
@@ -0,0 +1,103 @@
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Hot-path event types written as fixed-size binary records. Latency is not
+// recorded per sample: the per-thread histograms (LatencyHistogram.h) cover it.
+enum class BinaryRecordType : uint16_t {
+    BOOK_DELTA = 2,     // tag = instrument, a = change_id, b = timestamp, value32 = bids << 16 | asks, x/y = best bid/ask
+    ORDER_ACK = 3       // tag = order id, a = round trip ns, value32 = status, x = amount, y = price
+};
+
+// Status carried by ORDER_ACK records.
+enum class OrderAckStatus : uint32_t {
+    ACCEPTED = 0,
+    REJECTED = 1,
+    BAD_RESPONSE = 2
+};
+
+// 64 byte record, decoded offline by bin/log_decoder.
+struct BinaryRecord {
+    uint64_t timestampNs; // wall clock, nanoseconds since epoch
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t value32;
+    int64_t a;
+    int64_t b;
+    double x;
+    double y;
+    char tag[16];         // truncated, not necessarily NUL terminated
+};
+static_assert(sizeof(BinaryRecord) == 64, "BinaryRecord must stay 64 bytes");
+
+// File header written at the start of every binary log file.
+struct BinaryLogHeader {
+    char magic[8];        // "TBLOG001"
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+// Asynchronous binary event log.
+// Producers copy a record into a preallocated bounded queue (lock-free,
+// multi-producer) and return; a background thread writes batches to a
+// size-rotated file. When the queue is full the record is dropped and counted
+// rather than blocking the caller.
+class BinaryLog {
+public:
+    BinaryLog(const std::string& path, size_t queueCapacity = 65536,
+              size_t maxFileSize = 256 * 1024 * 1024, size_t maxFiles = 4);
+    ~BinaryLog();
+
+    bool log(const BinaryRecord& record);
+
+    void logBookDelta(const char* instrument, size_t instrumentLength, int64_t changeId, int64_t timestamp,
+                      size_t bidCount, size_t askCount, double bestBid, double bestAsk);
+    void logOrderAck(const std::string& orderId, OrderAckStatus status, int64_t roundTripNs, double amount, double price);
+
+    // Flush everything queued so far and stop the writer thread.
+    void stop();
+
+    uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t writtenRecords() const { return written.load(std::memory_order_relaxed); }
+
+    // Human-readable form of a record, used by the decoder.
+    static std::string format(const BinaryRecord& record);
+    static void setTag(BinaryRecord& record, const char* text, size_t length);
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        BinaryRecord record;
+    };
+
+    std::string path;
+    size_t maxFileSize;
+    size_t maxFiles;
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> enqueuePos;
+    alignas(64) uint64_t dequeuePos;
+
+    std::atomic<bool> running;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> written;
+    std::thread writer;
+
+    FILE* file;
+    size_t fileSize;
+
+    bool dequeue(BinaryRecord& record);
+    void writerLoop();
+    void openFile();
+    void rotate();
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef CHANNELDISPATCHER_H
+#define CHANNELDISPATCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "InstrumentRegistry.h"
+#include "OrderBook.h"
+
+// Typed subscription events. String views point into the received frame and
+// are only valid for the duration of the handler call.
+struct BookEvent {
+    InstrumentId instrument;
+    const BookUpdate& update; // the delta or snapshot just applied
+    const OrderBook& book;    // state after the update
+};
+
+// ticker.*, trades.*, user.orders.* and user.trades.* carry their payload as raw JSON.
+struct ChannelDataEvent {
+    ChannelKind kind;
+    InstrumentId instrument;
+    std::string_view data; // raw JSON text of params.data
+};
+using TickerEvent = ChannelDataEvent;
+using TradesEvent = ChannelDataEvent;
+using UserOrdersEvent = ChannelDataEvent;
+using UserTradesEvent = ChannelDataEvent;
+
+// user.portfolio.<currency> is keyed by currency rather than instrument.
+struct PortfolioEvent {
+    std::string_view currency;
+    std::string_view data;
+};
+
+// user.changes.<kind>.<currency>.<interval>: trades, positions and orders of the account.
+struct UserChangesEvent {
+    std::string_view scope; // "<kind>.<currency>.<interval>", e.g. "any.any.raw"
+    std::string_view data;
+};
+
+// Handlers registered for one (kind, instrument) pair. Lists are immutable once
+// published: registration copies the list, appends and swaps the pointer, so
+// dispatch is one array index and one atomic load with no lock.
+template <typename Event>
+class HandlerSlots {
+public:
+    using Handler = std::function<void(const Event&)>;
+    using List = std::vector<Handler>;
+
+    HandlerSlots() : slots(new std::atomic<const List*>[kMaxInstruments + 1]) {
+        for (size_t i = 0; i <= kMaxInstruments; ++i) {
+            slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // kNoInstrument registers for every instrument.
+    void add(InstrumentId instrument, Handler handler) {
+        size_t index = instrument == kNoInstrument ? kMaxInstruments : instrument;
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const List* current = slots[index].load(std::memory_order_relaxed);
+        auto next = std::make_unique<List>(current ? *current : List());
+        next->push_back(std::move(handler));
+        slots[index].store(next.get(), std::memory_order_release);
+        // Replaced lists stay alive: the consumer thread may still be iterating one.
+        lists.push_back(std::move(next));
+    }
+
+    // Returns false if no handler took the event.
+    bool dispatch(InstrumentId instrument, const Event& event) const {
+        bool handled = false;
+        if (instrument < kMaxInstruments) {
+            handled = invoke(slots[instrument].load(std::memory_order_acquire), event);
+        }
+        return invoke(slots[kMaxInstruments].load(std::memory_order_acquire), event) || handled;
+    }
+
+private:
+    std::unique_ptr<std::atomic<const List*>[]> slots; // per instrument, then the wildcard slot
+    std::vector<std::unique_ptr<List>> lists;
+    std::mutex writeMutex;
+
+    static bool invoke(const List* list, const Event& event) {
+        if (!list) {
+            return false;
+        }
+        for (const auto& handler : *list) {
+            handler(event);
+        }
+        return !list->empty();
+    }
+};
+
+// Runtime dispatch of subscription notifications to registered handlers.
+// Registration may happen from any thread at any time; dispatch runs on the
+// consumer thread and costs O(1) per message (plus the handlers themselves).
+class ChannelDispatcher {
+public:
+    using BookHandler = HandlerSlots<BookEvent>::Handler;
+    using DataHandler = HandlerSlots<ChannelDataEvent>::Handler;
+    using PortfolioHandler = HandlerSlots<PortfolioEvent>::Handler;
+    using UserChangesHandler = HandlerSlots<UserChangesEvent>::Handler;
+
+    // Pass kNoInstrument to receive every instrument of that kind.
+    void onBook(InstrumentId instrument, BookHandler handler) { books.add(instrument, std::move(handler)); }
+    void onTicker(InstrumentId instrument, DataHandler handler) { add(ChannelKind::TICKER, instrument, std::move(handler)); }
+    void onTrades(InstrumentId instrument, DataHandler handler) { add(ChannelKind::TRADES, instrument, std::move(handler)); }
+    void onUserOrders(InstrumentId instrument, DataHandler handler) { add(ChannelKind::USER_ORDERS, instrument, std::move(handler)); }
+    void onUserTrades(InstrumentId instrument, DataHandler handler) { add(ChannelKind::USER_TRADES, instrument, std::move(handler)); }
+    // Receives every user.portfolio.* notification; filter on event.currency.
+    void onPortfolio(PortfolioHandler handler) { portfolio.add(kNoInstrument, std::move(handler)); }
+    // Receives every user.changes.* notification.
+    void onUserChanges(UserChangesHandler handler) { userChanges.add(kNoInstrument, std::move(handler)); }
+
+    // Each returns false if no handler was registered for the event.
+    bool dispatch(const BookEvent& event) const { return books.dispatch(event.instrument, event); }
+    bool dispatch(const ChannelDataEvent& event) const {
+        size_t kind = static_cast<size_t>(event.kind);
+        return kind < kChannelKinds && data[kind].dispatch(event.instrument, event);
+    }
+    bool dispatch(const PortfolioEvent& event) const { return portfolio.dispatch(kNoInstrument, event); }
+    bool dispatch(const UserChangesEvent& event) const { return userChanges.dispatch(kNoInstrument, event); }
+
+private:
+    HandlerSlots<BookEvent> books;
+    HandlerSlots<ChannelDataEvent> data[kChannelKinds]; // BOOK slot unused
+    HandlerSlots<PortfolioEvent> portfolio;
+    HandlerSlots<UserChangesEvent> userChanges;
+
+    void add(ChannelKind kind, InstrumentId instrument, DataHandler handler) {
+        data[static_cast<size_t>(kind)].add(instrument, std::move(handler));
+    }
+};
+
+// Compile-time dispatch for consumers that own the loop (bin/replay, bin/bench,
+// embedded strategies). Sink provides onBook(const BookEvent&) and onTicker,
+// onTrades, onUserOrders, onUserTrades(const ChannelDataEvent&); the calls are
+// resolved statically, so a sink's handlers inline into the switch with no
+// std::function or virtual call.
+template <typename Sink>
+inline void dispatchStatic(Sink& sink, const BookEvent& event) {
+    sink.onBook(event);
+}
+
+template <typename Sink>
+inline void dispatchStatic(Sink& sink, const ChannelDataEvent& event) {
+    switch (event.kind) {
+        case ChannelKind::TICKER:
+            sink.onTicker(event);
+            break;
+        case ChannelKind::TRADES:
+            sink.onTrades(event);
+            break;
+        case ChannelKind::USER_ORDERS:
+            sink.onUserOrders(event);
+            break;
+        case ChannelKind::USER_TRADES:
+            sink.onUserTrades(event);
+            break;
+        default:
+            break;
+    }
+}
+
+#endif
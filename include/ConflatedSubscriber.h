@@ -0,0 +1,116 @@
+#ifndef CONFLATEDSUBSCRIBER_H
+#define CONFLATEDSUBSCRIBER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "ChannelDispatcher.h"
+#include "InstrumentRegistry.h"
+#include "OrderBook.h"
+#include "TickerStore.h"
+
+class WebsocketClient;
+class MarketDataManager;
+
+struct ConflationOptions {
+    bool books = true;
+    bool tickers = true;
+    // Ids of the dispatcher the subscriber attaches to; empty watches every instrument.
+    std::vector<InstrumentId> instruments;
+};
+
+// Latest state of one instrument that changed since the previous poll.
+struct ConflatedUpdate {
+    InstrumentId instrument;
+    // Notifications merged into this update, 0 for a kind that did not change.
+    uint32_t bookUpdates;
+    uint32_t tickerUpdates;
+    // Set when bookUpdates > 0. top is read after the flag was taken, so it is
+    // at least as new as every counted update; depth() on the book is too.
+    const OrderBook* book;
+    TopOfBook top;
+    // Set when tickerUpdates > 0.
+    TickerSnapshot ticker;
+};
+
+enum class ConflatedKind : uint8_t {
+    BOOK,
+    TICKER,
+    COUNT
+};
+constexpr size_t kConflatedKinds = static_cast<size_t>(ConflatedKind::COUNT);
+
+struct ConflationStats {
+    uint64_t updates[kConflatedKinds];   // notifications seen
+    uint64_t delivered[kConflatedKinds]; // instrument states handed to the reader
+    uint64_t conflated[kConflatedKinds]; // notifications folded into a later state
+    size_t dirty;                        // instruments waiting for the next poll
+};
+
+// Conflation mode for a consumer that cannot keep up with every book delta or
+// ticker. The book engine still applies every notification; the subscriber's
+// handler only counts it per instrument and flags the instrument dirty (two
+// atomic RMWs, no lock, no copy). The reader polls from its own thread at its
+// own pace and gets one ConflatedUpdate per dirty instrument with the state at
+// the time of the poll, so however far behind it falls, its backlog is bounded
+// by the number of instruments and it always sees the newest state.
+//
+// Each subscriber has its own flags, so readers of different speeds do not
+// affect each other or the regular handlers of the dispatcher. Handlers cannot
+// be removed from a dispatcher: the subscriber must outlive the client or
+// manager it is attached to. One thread polls.
+class ConflatedSubscriber {
+public:
+    using TickerSource = std::function<bool(InstrumentId, TickerSnapshot&)>;
+    using Reader = std::function<void(const ConflatedUpdate&)>;
+
+    // Registers on 'channels'; tickers are read from 'source' when flagged.
+    ConflatedSubscriber(ChannelDispatcher& channels, TickerSource source,
+                        const ConflationOptions& options = ConflationOptions());
+    // Books and tickers of one client, keyed by its instrument ids.
+    explicit ConflatedSubscriber(WebsocketClient& client, const ConflationOptions& options = ConflationOptions());
+    // Every shard of the manager, keyed by the manager's instrument ids.
+    explicit ConflatedSubscriber(MarketDataManager& manager, const ConflationOptions& options = ConflationOptions());
+
+    ConflatedSubscriber(const ConflatedSubscriber&) = delete;
+    ConflatedSubscriber& operator=(const ConflatedSubscriber&) = delete;
+
+    // Hands every dirty instrument to 'reader', in instrument id order, and
+    // clears its flags. Returns the number of updates delivered.
+    size_t poll(const Reader& reader);
+    // True if the next poll would deliver something.
+    bool hasPending() const;
+
+    ConflationStats stats() const;
+
+    // Writer side, called by the registered handlers on the consumer threads.
+    void markBook(InstrumentId instrument, const OrderBook& book);
+    void markTicker(InstrumentId instrument);
+
+private:
+    static constexpr size_t kWordBits = 64;
+    static constexpr size_t kWords = (kMaxInstruments + kWordBits - 1) / kWordBits;
+
+    struct alignas(64) Kind {
+        std::atomic<uint64_t> dirty[kWords];
+        std::atomic<uint64_t> updates{0};
+    };
+
+    TickerSource tickerSource;
+    Kind kinds[kConflatedKinds];
+    // Notifications since the last poll, per kind and instrument.
+    std::unique_ptr<std::atomic<uint32_t>[]> pending;
+    std::unique_ptr<std::atomic<const OrderBook*>[]> books;
+    // Reader side; atomic only so stats() can be called from any thread.
+    std::atomic<uint64_t> delivered[kConflatedKinds];
+    std::atomic<uint64_t> conflated[kConflatedKinds];
+
+    void attach(ChannelDispatcher& channels, const ConflationOptions& options);
+    void mark(ConflatedKind kind, InstrumentId instrument);
+    uint32_t take(ConflatedKind kind, InstrumentId instrument);
+};
+
+#endif // CONFLATEDSUBSCRIBER_H
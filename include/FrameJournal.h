@@ -0,0 +1,161 @@
+#ifndef FRAMEJOURNAL_H
+#define FRAMEJOURNAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Journal file layout:
+//   JournalFileHeader (64 bytes)
+//   FrameRecordHeader + payload, padded to 8 bytes, repeated
+//   a zero length marks the end of a file that was not closed cleanly
+// Each closed file gets a sidecar .idx with one JournalIndexEntry per
+// indexInterval of receive time, for seeking by time.
+struct JournalFileHeader {
+    char magic[8];         // "TFJRNL01"
+    uint32_t version;
+    uint32_t connectionId;
+    uint64_t sequence;     // file number within the capture
+    uint64_t createdNs;
+    uint64_t firstNs;      // receive time of the first/last frame, 0 until closed
+    uint64_t lastNs;
+    uint64_t dataEnd;      // offset past the last record, 0 until closed
+    uint64_t frameCount;
+};
+static_assert(sizeof(JournalFileHeader) == 64, "JournalFileHeader must stay 64 bytes");
+
+struct FrameRecordHeader {
+    uint32_t length;       // payload bytes, not including padding
+    uint32_t connectionId;
+    uint64_t receivedNs;   // wall clock, nanoseconds since epoch
+};
+static_assert(sizeof(FrameRecordHeader) == 16, "FrameRecordHeader must stay 16 bytes");
+
+struct JournalIndexEntry {
+    uint64_t receivedNs;
+    uint64_t offset;       // of the FrameRecordHeader in the journal file
+};
+
+struct FrameJournalOptions {
+    std::string directory = "captures";
+    uint32_t connectionId = 0;
+    size_t fileSize = 64 * 1024 * 1024;      // files roll over when the next frame does not fit
+    uint64_t indexIntervalNs = 10000000;     // one index entry per 10ms of traffic
+    bool prefault = true;                    // touch the next file's pages before it is needed
+};
+
+struct FrameJournalStats {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t files;
+    uint64_t dropped;      // frames larger than a whole file
+};
+
+// Append-only capture of raw WebSocket frames to memory-mapped files.
+// append() is called from a single thread (the I/O thread) and only copies
+// into the current mapping. Creating and prefaulting the next file, and
+// truncating, indexing and unmapping finished ones, happens on a background
+// thread, so rolling over is a pointer swap.
+class FrameJournal {
+public:
+    explicit FrameJournal(const FrameJournalOptions& options = FrameJournalOptions());
+    ~FrameJournal();
+
+    FrameJournal(const FrameJournal&) = delete;
+    FrameJournal& operator=(const FrameJournal&) = delete;
+
+    void append(uint64_t receivedNs, const char* data, size_t length);
+
+    // Finish the current file and stop the background thread.
+    void close();
+
+    FrameJournalStats stats() const;
+
+    // Journal files in a capture directory, ordered by connection id then sequence.
+    static std::vector<std::string> listFiles(const std::string& directory);
+    static std::string indexPathFor(const std::string& journalPath);
+
+private:
+    struct MappedFile {
+        int fd = -1;
+        char* base = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+        uint64_t sequence = 0;
+        uint64_t firstNs = 0;
+        uint64_t lastNs = 0;
+        uint64_t frames = 0;
+        std::string path;
+        std::vector<JournalIndexEntry> index;
+    };
+
+    FrameJournalOptions options;
+    MappedFile current;
+    uint64_t nextIndexNs;
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> files;
+    std::atomic<uint64_t> dropped;
+
+    // Shared with the background thread.
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool running;
+    bool closed;
+    bool spareReady;
+    MappedFile spare;
+    std::deque<MappedFile> finished;
+    uint64_t nextSequence;
+    std::thread background;
+
+    MappedFile createFile(uint64_t sequence);
+    void finishFile(MappedFile& file);
+    void rollover();
+    void backgroundLoop();
+};
+
+// A decoded frame pointing into a mapped journal file.
+struct JournalFrame {
+    uint64_t receivedNs;
+    uint32_t connectionId;
+    const char* data;
+    uint32_t length;
+};
+
+// Sequential reader over one journal file.
+class FrameJournalReader {
+public:
+    explicit FrameJournalReader(const std::string& path);
+    ~FrameJournalReader();
+
+    FrameJournalReader(const FrameJournalReader&) = delete;
+    FrameJournalReader& operator=(const FrameJournalReader&) = delete;
+
+    bool isOpen() const { return base != nullptr; }
+    const JournalFileHeader& header() const { return *reinterpret_cast<const JournalFileHeader*>(base); }
+
+    // Next frame, false at the end of the file.
+    bool next(JournalFrame& frame);
+
+    // Position before the first frame received at or after timestampNs. Uses
+    // the .idx file when there is one, otherwise scans from the start.
+    void seek(uint64_t timestampNs);
+    void rewind();
+
+private:
+    std::string path;
+    int fd;
+    const char* base;
+    size_t size;
+    size_t end;
+    size_t offset;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef HTTPCONNECTIONPOOL_H
+#define HTTPCONNECTIONPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+struct HttpPoolOptions {
+    std::string baseUrl = "https://test.deribit.com";
+    std::string warmPath = "/api/v2/public/test"; // cheap GET used to open/keep connections
+    size_t size = 8;             // also how many batch requests are in flight at once
+    bool http2 = false;          // negotiate HTTP/2 and wait to multiplex on an existing connection
+    bool verifyPeer = true;      // disable only for a local stand-in with a self-signed cert
+    bool warmOnStart = true;
+    std::chrono::seconds warmInterval{30}; // 0 disables background warming
+    std::vector<std::string> headers = {"Content-Type: application/json", "Accept: application/json"};
+};
+
+// A pooled curl easy handle with its prebuilt header list.
+struct PooledHandle {
+    CURL* curl = nullptr;
+    curl_slist* headers = nullptr;
+    std::string authHeader; // header list is rebuilt only when this changes
+    std::string response;
+};
+
+// Fixed set of warmed curl easy handles that keep their connections alive
+// between requests. DNS and TLS session caches are shared between handles, so
+// even a handle that has to reconnect skips the full handshake. Connections stay
+// with their handle; sharing them would put every transfer behind one lock.
+class HttpConnectionPool {
+public:
+    explicit HttpConnectionPool(const HttpPoolOptions& options = HttpPoolOptions());
+    ~HttpConnectionPool();
+
+    HttpConnectionPool(const HttpConnectionPool&) = delete;
+    HttpConnectionPool& operator=(const HttpConnectionPool&) = delete;
+
+    // Blocking POST on a pooled handle. Returns the HTTP status (0 on transport error)
+    // and fills response. authHeader, if not empty, is sent as an extra header line.
+    long post(const std::string& url, const std::string& body, std::string& response,
+              const std::string& authHeader = "");
+
+    // Borrow a handle with the POST body/headers already applied, for callers that
+    // drive it themselves (e.g. a curl multi handle). Must be given back with release().
+    PooledHandle* acquire();
+    PooledHandle* tryAcquire();
+    void release(PooledHandle* handle);
+    void preparePost(PooledHandle* handle, const std::string& url, const std::string& body,
+                     const std::string& authHeader);
+
+    // Send the warm-up request on every idle handle, opening or refreshing the
+    // cached connections.
+    void warm();
+
+    const HttpPoolOptions& getOptions() const { return options; }
+    uint64_t requestCount() const { return requests.load(std::memory_order_relaxed); }
+    uint64_t connectCount() const { return connects.load(std::memory_order_relaxed); }
+    void noteCompleted(PooledHandle* handle);
+
+private:
+    HttpPoolOptions options;
+    std::vector<PooledHandle> handles;
+    std::vector<PooledHandle*> idle;
+    std::mutex poolMutex;
+    std::condition_variable poolCv;
+
+    CURLSH* share;
+    std::mutex shareMutex[CURL_LOCK_DATA_LAST];
+
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> connects;
+
+    std::atomic<bool> running;
+    std::thread warmer;
+    std::mutex warmMutex;
+    std::condition_variable warmCv;
+
+    void configure(PooledHandle& handle);
+    void setAuthHeader(PooledHandle& handle, const std::string& authHeader);
+    void warmLoop();
+
+    static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp);
+    static void unlockShare(CURL* handle, curl_lock_data data, void* userp);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef INSTRUMENTREGISTRY_H
+#define INSTRUMENTREGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compact id handed out per instrument at subscription time. Per-instrument
+// state (books, tickers, ...) lives in flat arrays indexed by it.
+using InstrumentId = uint16_t;
+constexpr InstrumentId kNoInstrument = 0xFFFF;
+constexpr size_t kMaxInstruments = 1024;
+
+// Per-instrument subscription channels. Each one is named "<prefix><instrument>.raw".
+enum class ChannelKind : uint8_t {
+    BOOK,        // book.<instrument>.raw
+    TICKER,      // ticker.<instrument>.raw
+    TRADES,      // trades.<instrument>.raw
+    USER_ORDERS, // user.orders.<instrument>.raw
+    USER_TRADES, // user.trades.<instrument>.raw
+    COUNT,
+    UNKNOWN = COUNT
+};
+constexpr size_t kChannelKinds = static_cast<size_t>(ChannelKind::COUNT);
+
+struct ChannelKey {
+    ChannelKind kind;
+    InstrumentId instrument;
+};
+
+// Interns instrument names and the channel names derived from them.
+// intern() takes a lock and inserts into the lookup tables; it runs at
+// subscription time. The tables are open-addressing arrays sized once for
+// kMaxInstruments at no more than half load, so they never grow, rebuild or
+// get replaced. Lookups are lock-free and allocation-free: one hash, a short
+// linear probe compared by hash tag, and one string compare, so they are
+// safe on the receive path while another thread interns.
+class InstrumentRegistry {
+public:
+    InstrumentRegistry();
+    ~InstrumentRegistry();
+
+    // Returns the id of 'instrument', assigning the next one if it is new.
+    // kNoInstrument once kMaxInstruments are registered.
+    InstrumentId intern(std::string_view instrument);
+    // Interns several at once under one lock.
+    std::vector<InstrumentId> intern(const std::vector<std::string>& instruments);
+
+    // kNoInstrument if the instrument was never interned.
+    InstrumentId find(std::string_view instrument) const;
+    // {UNKNOWN, kNoInstrument} for channels of instruments that were never interned.
+    ChannelKey resolveChannel(std::string_view channel) const;
+
+    // Only valid for ids returned by intern().
+    const std::string& name(InstrumentId id) const { return entries[id].name; }
+    const std::string& channelName(ChannelKind kind, InstrumentId id) const {
+        return entries[id].channels[static_cast<size_t>(kind)];
+    }
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string channels[kChannelKinds];
+    };
+
+    // Insert-only linear-probing table. A slot is 0 while empty, otherwise
+    // the key's upper hash bits, kind and id packed into one word, written
+    // once by the writer after the entry it points at is complete.
+    class Table {
+    public:
+        explicit Table(size_t capacity);
+        // Writer only; the key must not be present yet.
+        void insert(uint64_t hash, ChannelKey value);
+        template <typename KeyOf>
+        ChannelKey lookup(std::string_view key, uint64_t hash, const KeyOf& keyOf) const;
+
+    private:
+        size_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    };
+
+    std::unique_ptr<Entry[]> entries; // fixed capacity, so name() references stay valid
+    std::atomic<size_t> count;
+    Table instrumentTable;
+    Table channelTable;
+    std::mutex writeMutex;
+
+    InstrumentId add(std::string_view instrument);
+    static uint64_t hash(std::string_view key);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+// Named latency probes. Every probe gets its own histogram per thread.
+enum class LatencyProbe : uint32_t {
+    FRAME_PROCESSING = 0, // receive to fully processed, including queueing
+    PARSE,                // MessageParser::parse
+    DISPATCH,             // routing a parsed frame to books/loggers
+    ORDER_RTT,            // RestClient::placeOrder round trip
+    CANCEL_RTT,           // RestClient::cancelOrder round trip
+    EDIT_RTT,             // RestClient::modifyOrder round trip
+    SUBSCRIBE,            // sending a subscribe request
+    POSITIONS_REQUEST,    // sending a positions request
+    WS_ORDER_RTT,         // private/buy|sell over the WebSocket, request to response
+    WS_CANCEL_RTT,        // private/cancel over the WebSocket
+    WS_EDIT_RTT,          // private/edit over the WebSocket
+    QUEUE_WAIT,           // time a frame spent in the receive ring
+    TOKEN_REFRESH,        // background access token refresh, request to published
+    RECONNECT_TO_BOOK,    // WebSocket reconnected to the first fresh book snapshot applied
+    THROTTLE_WAIT,        // outbound request held back by the client-side rate limiter
+    COUNT
+};
+
+inline const char* latencyProbeName(LatencyProbe probe) {
+    static const char* const names[] = {
+        "frame_processing", "parse", "dispatch", "order_rtt",
+        "cancel_rtt", "edit_rtt", "subscribe", "positions_request",
+        "ws_order_rtt", "ws_cancel_rtt", "ws_edit_rtt", "queue_wait",
+        "token_refresh", "reconnect_to_book", "throttle_wait"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(LatencyProbe::COUNT),
+                  "every probe needs a name");
+    uint32_t i = static_cast<uint32_t>(probe);
+    return i < static_cast<uint32_t>(LatencyProbe::COUNT) ? names[i] : "unknown";
+}
+
+// Log-linear (HDR style) histogram of nanosecond values.
+// Values below 64ns are exact, above that every power of two is split into
+// 32 sub-buckets, giving ~3% relative precision up to ~2^63 ns.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kLinearBuckets = kSubBuckets * 2;
+    static constexpr size_t kBucketCount = kLinearBuckets + (63 - kSubBucketBits) * kSubBuckets;
+
+    static size_t bucketFor(uint64_t value) {
+        if (value < kLinearBuckets) {
+            return static_cast<size_t>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - kSubBucketBits;
+        return kLinearBuckets + static_cast<size_t>(shift - 1) * kSubBuckets +
+               static_cast<size_t>((value >> shift) - kSubBuckets);
+    }
+
+    // Highest value that maps to the bucket.
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void add(const LatencyHistogram& other);
+    void subtract(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t valueAtPercentile(double percentile) const;
+
+    uint64_t counts[kBucketCount];
+
+private:
+    uint64_t total;
+    uint64_t maxValue;
+
+    friend class LatencyRegistry;
+};
+
+// Record one sample. Lock-free: each thread writes its own histograms and
+// only registers them (under a mutex) the first time it records. A thread's
+// histograms are handed to the next new thread once it exits.
+void recordLatency(LatencyProbe probe, int64_t nanoseconds);
+
+// Merged view of all threads since startup.
+LatencyHistogram latencySnapshot(LatencyProbe probe);
+
+// Periodically merge the per-thread histograms and write p50/p90/p99/p99.9/max
+// for the last interval to the latency logger. stop writes a cumulative summary.
+void startLatencyReporter(std::chrono::seconds interval);
+void stopLatencyReporter();
+
+// Adds lines of its own to every interval report, e.g. queue depths next to
+// the wait times. Runs on the reporter thread until the hook is destroyed.
+class LatencyReportHook {
+public:
+    explicit LatencyReportHook(std::function<void(const char* label)> report);
+    ~LatencyReportHook();
+
+    LatencyReportHook(const LatencyReportHook&) = delete;
+    LatencyReportHook& operator=(const LatencyReportHook&) = delete;
+
+private:
+    uint64_t id;
+};
+
+// Records the time between construction and destruction into a probe.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyProbe probe)
+        : probe(probe), start(std::chrono::high_resolution_clock::now()) {}
+    ~ScopedLatency() {
+        auto end = std::chrono::high_resolution_clock::now();
+        recordLatency(probe, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+private:
+    LatencyProbe probe;
+    std::chrono::high_resolution_clock::time_point start;
+};
+
+#endif
@@ -1,10 +1,14 @@
+
 #ifndef LOGGER_H
 #define LOGGER_H
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/rotating_file_sink.h>
 #include <memory>
 #include <chrono>
+#include "BinaryLog.h"
 
 extern std::shared_ptr<spdlog::logger> systemLogger;
 extern std::shared_ptr<spdlog::logger> orderLogger;
@@ -14,8 +18,15 @@ extern std::shared_ptr<spdlog::logger> markettrade;
 extern std::shared_ptr<spdlog::logger> positions;
 extern std::shared_ptr<spdlog::logger> dump;
 
+// Compact binary records for hot-path events (book deltas, order acks). Decode with bin/log_decoder logs/events.bin
+extern std::shared_ptr<BinaryLog> binaryLogger;
+
 
+// All text loggers are asynchronous: callers format into a preallocated
+// queue and a single background thread writes to size-rotated files.
 void initLogger();
+// Flush and stop the background writers. Call once before exiting.
+void shutdownLogger();
 
 
 #endif
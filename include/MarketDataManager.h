@@ -0,0 +1,101 @@
+#ifndef MARKETDATAMANAGER_H
+#define MARKETDATAMANAGER_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Authorisation.h"
+#include "ChannelDispatcher.h"
+#include "InstrumentRegistry.h"
+#include "WebsocketClient.h"
+
+enum class ShardPolicy {
+    HASH, // instrument name hash modulo the connection count
+    RATE  // the connection with the lowest measured message rate
+};
+
+struct MarketDataOptions {
+    size_t connections = 2;
+    ShardPolicy policy = ShardPolicy::HASH;
+    // Shard i connects to urls[i % urls.size()]. Production uses one URL; a
+    // list lets a local scaling test give every shard its own mock exchange.
+    std::vector<std::string> urls = {"wss://test.deribit.com/ws/api/v2"};
+    // CPU per shard for its I/O and consumer threads; missing entries stay unpinned.
+    std::vector<int> ioCpus;
+    std::vector<int> consumerCpus;
+    // Settings shared by every shard (url and CPUs are set per shard).
+    WebsocketClientOptions client;
+    // How often the per-shard message rates used by ShardPolicy::RATE are re-measured.
+    std::chrono::milliseconds rateWindow{1000};
+};
+
+struct ShardStats {
+    size_t instruments;
+    uint64_t frames;         // received since start
+    double framesPerSecond;  // over the last rate window
+    RingStats ring;
+};
+
+// Market data spread over several WebSocket connections, each a WebsocketClient
+// with its own I/O and consumer thread. Every instrument lives on exactly one
+// shard, so its events keep their order: handlers registered on channels() see
+// one instrument's stream in sequence on its shard's consumer thread, while
+// different instruments may be handled concurrently on different threads.
+// Handlers receive the manager's instrument ids (instruments()).
+class MarketDataManager {
+public:
+    explicit MarketDataManager(Authorization* auth, const MarketDataOptions& options = MarketDataOptions());
+
+    MarketDataManager(const MarketDataManager&) = delete;
+    MarketDataManager& operator=(const MarketDataManager&) = delete;
+
+    void start();
+    void stop();
+
+    // Assigns new instruments to shards and subscribes them on their shard.
+    void subscribe(ChannelKind kind, const std::vector<std::string>& instruments);
+    void subscribeToOrderBook(const std::vector<std::string>& instruments) { subscribe(ChannelKind::BOOK, instruments); }
+
+    ChannelDispatcher& channels() { return dispatcher; }
+    InstrumentRegistry& instruments() { return registry; }
+    // The live book of a subscribed instrument, or null.
+    OrderBook* book(InstrumentId instrument) const;
+    // Latest ticker of a subscribed instrument; false if none received yet.
+    bool ticker(InstrumentId instrument, TickerSnapshot& out) const;
+    // Shard owning the instrument, or shardCount() if it has none yet.
+    size_t shardOf(InstrumentId instrument) const;
+    size_t shardCount() const { return shards.size(); }
+    WebsocketClient& shard(size_t index) { return *shards[index].client; }
+    std::vector<ShardStats> stats();
+
+private:
+    struct Shard {
+        std::unique_ptr<WebsocketClient> client;
+        // Shard-local instrument id -> manager id, read by the shard's forwarding handlers.
+        std::unique_ptr<std::atomic<InstrumentId>[]> toGlobal;
+        size_t instruments = 0;
+        size_t assignedSinceSample = 0;
+        uint64_t sampledFrames = 0;
+        double rate = 0.0;
+    };
+
+    static constexpr uint16_t kNoShard = 0xFFFF;
+
+    MarketDataOptions options;
+    InstrumentRegistry registry;
+    ChannelDispatcher dispatcher;
+    std::vector<Shard> shards;
+    std::unique_ptr<std::atomic<uint16_t>[]> owners; // manager id -> shard index
+    std::mutex assignMutex;
+    std::chrono::steady_clock::time_point lastSample;
+
+    size_t assign(InstrumentId instrument, const std::string& name);
+    size_t leastLoadedShard() const;
+    void sampleRates();
+    void forwardEvents(Shard& shard);
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef MESSAGEPARSER_H
+#define MESSAGEPARSER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "OrderBook.h"
+#include "TickerStore.h"
+
+struct OrderUpdate;
+
+// Max levels per side decoded from one book notification. Larger frames
+// (only very deep snapshots) are left to the nlohmann fallback.
+constexpr size_t kMaxParsedLevels = 2048;
+
+enum class MessageKind {
+    NOTIFICATION,   // {"method":"subscription","params":{"channel":...,"data":...}}
+    RESPONSE,       // {"id":...,"result":...}
+    ERROR_RESPONSE, // {"id":...,"error":...}
+    UNKNOWN
+};
+
+// Typed view of one Deribit JSON-RPC frame.
+// All string views point into the payload buffer that was parsed and are only
+// valid while that buffer is alive and unmodified.
+struct ParsedMessage {
+    MessageKind kind;
+    bool hasId;
+    int64_t id;
+    std::string_view method;
+    std::string_view channel;
+    std::string_view data;   // raw JSON text of params.data
+    std::string_view result; // raw JSON text of result
+    std::string_view error;  // raw JSON text of error
+
+    // Filled for book.* channels only.
+    bool hasBook;
+    bool isSnapshot;
+    int64_t changeId;
+    int64_t prevChangeId;
+    int64_t timestamp;
+    std::string_view instrument;
+    size_t bidCount;
+    size_t askCount;
+    BookLevelUpdate bids[kMaxParsedLevels];
+    BookLevelUpdate asks[kMaxParsedLevels];
+
+    BookUpdate bookUpdate() const;
+};
+
+// Allocation-free parser for the JSON-RPC shapes the client receives.
+// It scans the payload once, reading only the fields we route on, and skips
+// everything else. parse() returns false for anything it does not recognise
+// (escaped strings in routed fields, unknown frame shapes, oversized books),
+// in which case the caller should fall back to nlohmann::json.
+class MessageParser {
+public:
+    bool parse(const char* payload, size_t length, ParsedMessage& out);
+    bool parse(const std::string& payload, ParsedMessage& out) {
+        return parse(payload.data(), payload.size(), out);
+    }
+
+    // Decode the data object of a ticker.* notification. Fields not present
+    // (or null) are NaN. Returns false on malformed input.
+    bool parseTicker(std::string_view data, TickerSnapshot& out);
+
+    // Decode one order object (order responses, user.orders, user.changes,
+    // get_open_orders). Views point into 'object'; missing or null fields
+    // stay empty / 0. Returns false on malformed input or escaped strings.
+    bool parseOrder(std::string_view object, OrderUpdate& out);
+
+    // Raw JSON text of member 'key' of an object. False if it is absent.
+    bool findMember(std::string_view object, std::string_view key, std::string_view& out);
+
+    // Calls visit(element) with the raw JSON text of each element of an
+    // array; visit may use this parser. False if 'array' is not an array.
+    template <typename Visit>
+    bool forEachElement(std::string_view array, Visit&& visit);
+
+private:
+    const char* pos = nullptr;
+    const char* end = nullptr;
+
+    void skipWhitespace();
+    bool consume(char ch);
+    bool peek(char ch);
+    bool readString(std::string_view& out);
+    bool skipString();
+    bool skipValue(std::string_view* raw = nullptr);
+    bool readInt(int64_t& out);
+    bool readDouble(double& out);
+    // Anything but a string or number (null, a market order's "market_price") is skipped.
+    bool readOptionalString(std::string_view& out);
+    bool readOptionalDouble(double& out);
+    bool readOptionalInt(int64_t& out);
+
+    bool parseParams(ParsedMessage& out);
+    bool parseBook(std::string_view data, ParsedMessage& out);
+    bool parseLevels(BookLevelUpdate* levels, size_t& count);
+};
+
+template <typename Visit>
+bool MessageParser::forEachElement(std::string_view array, Visit&& visit) {
+    pos = array.data();
+    end = array.data() + array.size();
+    if (!consume('[')) {
+        return false;
+    }
+    if (consume(']')) {
+        return true;
+    }
+    do {
+        std::string_view element;
+        if (!skipValue(&element)) {
+            return false;
+        }
+        const char* savedPos = pos;
+        const char* savedEnd = end;
+        visit(element);
+        pos = savedPos;
+        end = savedEnd;
+    } while (consume(','));
+    return consume(']');
+}
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef MOCKMATCHINGENGINE_H
+#define MOCKMATCHINGENGINE_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Matching engine behind bin/mock_exchange. Every book is seeded with
+// synthetic liquidity that random-walks on tick(); incoming orders match
+// against that liquidity and limit remainders rest in the book. Resting
+// orders fill when the synthetic market trades through their price.
+// Not thread safe: the mock server drives it from its single I/O thread.
+
+struct MockOrder {
+    std::string orderId;
+    std::string instrument;
+    std::string direction;   // "buy" / "sell"
+    std::string orderType;   // "limit" / "market"
+    std::string orderState;  // "open", "filled", "cancelled"
+    std::string label;
+    double price = 0.0;
+    double amount = 0.0;
+    double filledAmount = 0.0;
+    double averagePrice = 0.0;
+    int64_t creationTimestamp = 0;
+    int64_t lastUpdateTimestamp = 0;
+};
+
+struct MockTrade {
+    std::string tradeId;
+    std::string orderId;
+    std::string instrument;
+    std::string direction;
+    double price;
+    double amount;
+    int64_t timestamp;
+    int64_t tradeSeq;        // per instrument, as on Deribit
+};
+
+struct MockPosition {
+    std::string instrument;
+    double size = 0.0;          // signed, positive is long
+    double averagePrice = 0.0;
+    double realizedPnl = 0.0;
+};
+
+// One side entry of a book notification: ["new"|"change"|"delete", price, amount].
+struct MockLevelChange {
+    const char* action;
+    double price;
+    double amount;
+};
+
+struct MockBookDelta {
+    std::string instrument;
+    bool isSnapshot = false;
+    int64_t changeId = 0;
+    int64_t prevChangeId = 0;
+    int64_t timestamp = 0;
+    std::vector<MockLevelChange> bids;
+    std::vector<MockLevelChange> asks;
+};
+
+struct MockTicker {
+    std::string instrument;
+    int64_t timestamp;
+    double bestBidPrice;
+    double bestBidAmount;
+    double bestAskPrice;
+    double bestAskAmount;
+    double lastPrice;
+    double markPrice;
+};
+
+// Result of an order operation. 'error' is empty on success.
+struct MockOrderResult {
+    MockOrder order;
+    std::vector<MockTrade> trades;
+    int errorCode = 0;
+    std::string error;
+};
+
+class MockMatchingEngine {
+public:
+    explicit MockMatchingEngine(uint64_t seed = 1, size_t depth = 20);
+
+    MockOrderResult placeOrder(const std::string& instrument, const std::string& direction,
+                               const std::string& orderType, double amount, double price,
+                               const std::string& label = "");
+    MockOrderResult editOrder(const std::string& orderId, double amount, double price);
+    MockOrderResult cancelOrder(const std::string& orderId);
+
+    std::vector<MockPosition> positions(const std::string& currency) const;
+    MockPosition position(const std::string& instrument) const;
+
+    // Open orders whose instrument starts with "<currency>-"; every one if empty.
+    std::vector<MockOrder> openOrders(const std::string& currency) const;
+    bool findOrder(const std::string& orderId, MockOrder& out) const;
+
+    // Random walk of the synthetic liquidity for one instrument.
+    void tick(const std::string& instrument);
+
+    MockBookDelta snapshot(const std::string& instrument);
+    MockTicker ticker(const std::string& instrument);
+
+    // Changes made to a book since the last call. Empty deltas are skipped by
+    // the caller; every non-empty one gets the next change id.
+    bool takeDelta(const std::string& instrument, MockBookDelta& out);
+
+    // Fills of resting orders caused by tick(), since the last call.
+    std::vector<MockTrade> takeRestingFills();
+
+private:
+    struct Level {
+        double synthetic = 0.0;
+        double user = 0.0;
+        double total() const { return synthetic + user; }
+    };
+
+    struct Book {
+        std::string instrument;
+        double tickSize;
+        double lastPrice;
+        int64_t changeId = 0;
+        int64_t tradeSeq = 0;
+        std::map<double, Level, std::greater<double>> bids;
+        std::map<double, Level> asks;
+        std::vector<MockLevelChange> pendingBids;
+        std::vector<MockLevelChange> pendingAsks;
+        std::vector<std::string> openOrders;
+    };
+
+    std::mt19937_64 rng;
+    size_t depth;
+    uint64_t nextOrderId;
+    uint64_t nextTradeId;
+    std::unordered_map<std::string, std::unique_ptr<Book>> books;
+    std::unordered_map<std::string, MockOrder> orders;
+    std::map<std::string, MockPosition> positionsByInstrument;
+    std::vector<MockTrade> restingFills;
+
+    Book& bookFor(const std::string& instrument);
+    void adjust(Book& book, bool bid, double price, double syntheticDelta, double userDelta);
+    MockOrderResult match(Book& book, MockOrder& order);
+    void rest(Book& book, const MockOrder& order);
+    void unrest(Book& book, const MockOrder& order);
+    void fill(Book& book, MockOrder& order, double price, double amount, std::vector<MockTrade>& trades);
+    void crossRestingOrders(Book& book);
+    void replenish(Book& book);
+    double randomAmount();
+};
+
+#endif
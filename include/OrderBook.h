@@ -0,0 +1,141 @@
+#ifndef ORDERBOOK_H
+#define ORDERBOOK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include "Seqlock.h"
+#include "InstrumentRegistry.h"
+
+// Action carried by a single level in a book.*.raw notification.
+enum class BookAction : uint8_t {
+    NEW,
+    CHANGE,
+    DELETE
+};
+
+struct BookLevelUpdate {
+    BookAction action;
+    double price;
+    double amount;
+};
+
+// One decoded book.*.raw notification.
+// The level arrays are owned by the caller and only need to live for the apply() call.
+struct BookUpdate {
+    bool isSnapshot;
+    int64_t changeId;
+    int64_t prevChangeId;
+    int64_t timestamp;
+    const BookLevelUpdate* bids;
+    size_t bidCount;
+    const BookLevelUpdate* asks;
+    size_t askCount;
+};
+
+struct PriceLevel {
+    double price;
+    double amount;
+};
+
+struct TopOfBook {
+    double bidPrice;
+    double bidAmount;
+    double askPrice;
+    double askAmount;
+    int64_t changeId;
+    int64_t timestamp;
+    bool valid; // false until a snapshot arrives, and again after a sequence gap
+};
+
+// Number of levels per side published for lock-free readers.
+constexpr size_t kPublishedDepth = 10;
+
+struct BookDepth {
+    PriceLevel bids[kPublishedDepth]; // best first
+    PriceLevel asks[kPublishedDepth]; // best first
+    size_t bidCount;
+    size_t askCount;
+    int64_t changeId;
+    int64_t timestamp;
+    bool valid;
+};
+
+enum class BookApplyResult {
+    APPLIED,
+    SEQUENCE_GAP,     // prev_change_id did not match, book is now invalid until the next snapshot
+    AWAITING_SNAPSHOT // delta received before any snapshot
+};
+
+// L2 order book for a single instrument.
+// Each side is a flat array sorted so that the best price sits at the back,
+// which keeps the frequent near-touch inserts and deletes to a short memmove.
+// apply() must be called from a single thread; topOfBook()/depth() may be
+// called from any thread and never block.
+class OrderBook {
+public:
+    explicit OrderBook(const std::string& instrument, size_t levelCapacity = 2048);
+
+    BookApplyResult apply(const BookUpdate& update);
+
+    // Mark the book unusable until the next snapshot (e.g. after a disconnect).
+    void invalidate();
+
+    // Lock-free snapshots published after every applied update.
+    TopOfBook topOfBook() const { return top.load(); }
+    BookDepth depth() const { return published.load(); }
+
+    // Full ladder access, only safe on the thread calling apply().
+    const std::vector<PriceLevel>& bidLevels() const { return bids; }
+    const std::vector<PriceLevel>& askLevels() const { return asks; }
+    bool isValid() const { return valid; }
+    int64_t lastChangeId() const { return changeId; }
+    const std::string& getInstrument() const { return instrument; }
+
+private:
+    std::string instrument;
+    std::vector<PriceLevel> bids; // ascending, best bid at back
+    std::vector<PriceLevel> asks; // descending, best ask at back
+    int64_t changeId;
+    int64_t timestamp;
+    bool valid;
+
+    Seqlock<TopOfBook> top;
+    Seqlock<BookDepth> published;
+
+    void applySide(std::vector<PriceLevel>& side, const BookLevelUpdate* levels, size_t count, bool isBid);
+    void publish();
+};
+
+// Owns one OrderBook per instrument, indexed by InstrumentId.
+// Books are created at subscription time so the receive path never allocates;
+// returned pointers stay valid for the lifetime of the manager. get() is a
+// lock-free array load for the receive path.
+class OrderBookManager {
+public:
+    explicit OrderBookManager(InstrumentRegistry& registry);
+
+    OrderBook* addBook(const std::string& instrument);
+    OrderBook* get(InstrumentId id) const {
+        return id < kMaxInstruments ? byId[id].load(std::memory_order_acquire) : nullptr;
+    }
+    OrderBook* find(const std::string& instrument) const;
+    OrderBook* find(const char* instrument, size_t length) const;
+
+    // Must be called from the thread that applies updates.
+    void invalidateAll();
+    void forEach(const std::function<void(OrderBook&)>& fn) const;
+
+private:
+    InstrumentRegistry& registry;
+    mutable std::mutex booksMutex;
+    std::vector<std::unique_ptr<OrderBook>> books; // creation order
+    std::unique_ptr<std::atomic<OrderBook*>[]> byId;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef ORDERMANAGER_H
+#define ORDERMANAGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "InstrumentRegistry.h"
+#include "OrderTemplates.h"
+
+class WebsocketClient;
+
+enum class OrderState : uint8_t {
+    PENDING_NEW,      // sent, not acknowledged yet
+    OPEN,
+    PARTIALLY_FILLED,
+    PENDING_EDIT,     // edit sent while the order rests
+    PENDING_CANCEL,   // cancel sent while the order rests
+    UNKNOWN,          // sent, but the session was lost before the answer; held until reconciled
+    FILLED,
+    CANCELLED,
+    REJECTED
+};
+
+// Slot index in the low 32 bits, the slot's generation in the high 32, so a
+// handle kept past the order's end never resolves to the order that reuses the slot.
+using OrderHandle = uint64_t;
+constexpr OrderHandle kNoOrder = ~OrderHandle(0);
+
+constexpr size_t kOrderIdCapacity = 48;  // e.g. "ETH-584849853", "USDC-123456789"
+constexpr size_t kLabelCapacity = 65;    // exchange labels are at most 64 characters
+
+struct ManagedOrder {
+    char orderId[kOrderIdCapacity]; // empty until the exchange assigns one
+    char label[kLabelCapacity];
+    InstrumentId instrument;
+    OrderState state;
+    OrderState restingState;        // what a rejected edit or cancel falls back to
+    bool buy;
+    bool limit;
+    double amount;
+    double price;
+    double filledAmount;
+    double averagePrice;
+    double pendingAmount;           // requested by an edit in flight
+    double pendingPrice;
+    int64_t createdAt;              // exchange timestamps (ms); 0 until acknowledged
+    int64_t updatedAt;
+    // Counted by the exposure listener, and the notional it counted for the
+    // unfilled amount; released pro rata as that amount shrinks.
+    bool reserved;
+    double reservedNotional;
+    uint32_t generation;
+};
+
+// One order object as the exchange reports it (responses, user.orders,
+// user.changes, get_open_orders). Views into the caller's buffers.
+struct OrderUpdate {
+    std::string_view orderId;
+    std::string_view label;
+    std::string_view instrument;
+    std::string_view orderState;    // "open", "untriggered", "filled", "cancelled", "rejected"
+    std::string_view direction;     // "buy" / "sell"
+    std::string_view orderType;     // "limit", "market", ...
+    double amount;
+    double price;
+    double filledAmount;
+    double averagePrice;
+    int64_t createdAt;
+    int64_t updatedAt;
+};
+
+// A change in the unfilled amount of the live orders of one instrument and side.
+struct ExposureChange {
+    InstrumentId instrument;
+    bool buy;
+    int orders;       // +1 for an order that became live, -1 for one that ended
+    double amount;    // change of the unfilled amount
+    double price;     // limit price, or the average fill price when there is none
+    double notional;  // for a decrease, the share of the order's reserved notional released (<= 0)
+};
+// Returns, for an increase, the notional the listener counted for it; the
+// manager records it on the order and hands exactly that back as it is released.
+using ExposureListener = std::function<double(const ExposureChange&)>;
+
+struct OrderManagerStats {
+    size_t live;
+    size_t capacity;
+    uint64_t submitted;
+    uint64_t filled;
+    uint64_t cancelled;
+    uint64_t rejected;
+    uint64_t untracked;     // not tracked because the table was full or a key too long
+};
+
+// Every live order of the account, keyed by order id and by client label.
+// Orders live in a fixed arena of slots allocated up front; a free list hands
+// out slots and two open-addressing tables map ids and labels to them, so
+// lookups and state transitions are O(1) and the table never allocates.
+// Orders that reach a final state (filled, cancelled, rejected) give their
+// slot back. Order objects are decoded from the raw JSON text by the
+// streaming MessageParser (nlohmann only for what it rejects) and generated
+// labels are formatted in the slot; what still allocates around the table is
+// the caller's: the request's label string when it outgrows its buffer, and
+// the clients' response bodies.
+//
+// The REST and WebSocket clients call submit() before sending and
+// onResponse() with the result; user.orders and user.changes notifications
+// and a get_open_orders snapshot arrive through the WebSocket client. New
+// orders without a label get a generated one, so a notification that beats
+// the response still finds its order, and so does a reconcile when the
+// response was lost with the session. Thread safe: one mutex, held only for
+// the table update.
+class OrderManager {
+public:
+    explicit OrderManager(InstrumentRegistry& registry, size_t capacity = 16384);
+    // Also takes the client's order notifications and its order entry path.
+    explicit OrderManager(WebsocketClient& client, size_t capacity = 16384);
+    ~OrderManager();
+
+    OrderManager(const OrderManager&) = delete;
+    OrderManager& operator=(const OrderManager&) = delete;
+
+    // Subscribes user.changes and reconciles after every login of the
+    // client's session, the first included. Needs the client constructor.
+    void start();
+    // Loads private/get_open_orders and settles the table against it: orders
+    // found (by id, or by label for ones never acknowledged) take the
+    // exchange's state; live orders it no longer lists ended unobserved and
+    // are closed, UNKNOWN ones as rejected and the rest as cancelled. Orders
+    // sent after the request are left alone.
+    void reconcile();
+    // The halves of reconcile() around the request, for a caller that loads
+    // the open orders itself. beginReconcile() marks the orders the snapshot
+    // must list and returns its round, or 0 while one is in flight (that one
+    // then asks for another); finishReconcile() applies the get_open_orders
+    // result and returns whether another round was asked for meanwhile.
+    uint32_t beginReconcile();
+    bool finishReconcile(uint32_t round, bool ok, std::string_view openOrders);
+
+    // Called by the clients before a request is written. A new order gets a
+    // PENDING_NEW slot (and a label if it has none); an edit or cancel moves a
+    // known order to PENDING_EDIT / PENDING_CANCEL. kNoOrder if not tracked.
+    OrderHandle submit(OrderRequest& request);
+    // 'result' is the raw JSON text of the JSON-RPC result (ignored unless ok).
+    // A transport failure is not a rejection: a new order turns UNKNOWN, an
+    // edit or cancel falls back to the resting order, both keep their risk
+    // reservation, and the next reconcile settles them.
+    void onResponse(OrderHandle handle, OrderAction action, bool ok, std::string_view result,
+                    bool transportFailure);
+    // Raw JSON text of one order object or an array of them, from any source;
+    // orders not seen before are adopted. Returns how many were decoded.
+    size_t applyOrders(std::string_view data);
+    void apply(const OrderUpdate& update);
+
+    // Copies of live orders. False if the order is unknown or already final.
+    bool get(OrderHandle handle, ManagedOrder& out) const;
+    bool find(std::string_view orderId, ManagedOrder& out) const;
+    bool findByLabel(std::string_view label, ManagedOrder& out) const;
+    std::vector<ManagedOrder> liveOrders() const;
+    OrderManagerStats stats() const;
+
+    // Called with the manager's lock held on every change of an order's
+    // unfilled amount; must not call back into the manager. Set before use.
+    void setExposureListener(ExposureListener listener) { exposureListener = std::move(listener); }
+
+    static const char* stateName(OrderState state);
+    static bool isFinal(OrderState state) {
+        return state == OrderState::FILLED || state == OrderState::CANCELLED || state == OrderState::REJECTED;
+    }
+
+private:
+    static constexpr uint32_t kEmpty = 0xFFFFFFFF;
+
+    // Linear probing over slot indices; the key is read from the slot itself.
+    // Deletion shifts the following entries back, so there are no tombstones.
+    struct Index {
+        std::unique_ptr<uint32_t[]> buckets;
+        size_t mask = 0;
+        std::string_view (*key)(const ManagedOrder&) = nullptr;
+    };
+
+    InstrumentRegistry& registry;
+    WebsocketClient* client = nullptr;
+    size_t capacity;
+    std::unique_ptr<ManagedOrder[]> orders;
+    std::unique_ptr<bool[]> inUse;
+    std::unique_ptr<uint32_t[]> freeList;
+    size_t freeCount;
+    Index byId;
+    Index byLabel;
+    // Hashes of order ids that reached a final state, direct-mapped (a newer id
+    // may evict an older one), so a late report of one is not adopted as a new order.
+    static constexpr size_t kFinishedHistory = 4096;
+    std::unique_ptr<uint64_t[]> finished;
+    // Per slot, the reconcile round whose snapshot must list the order; 0 once
+    // any exchange report has been applied to it.
+    std::unique_ptr<uint32_t[]> expectedIn;
+    uint32_t reconcileRound = 0;
+    bool reconciling = false;     // a get_open_orders request is in flight
+    bool reconcileAgain = false;  // another is needed once it is answered
+    char labelPrefix[24];                // "oms-<start time in base 36>-"
+    size_t labelPrefixLength = 0;
+    uint64_t nextLabel = 1;
+    OrderManagerStats counters{};
+    ExposureListener exposureListener;
+    mutable std::mutex mutex;
+
+    // All below with the mutex held.
+    uint32_t allocate();
+    void retire(uint32_t slot);
+    uint32_t resolve(OrderHandle handle) const;
+    uint32_t lookup(const Index& index, std::string_view key) const;
+    void insert(Index& index, uint32_t slot);
+    void erase(Index& index, uint32_t slot);
+    void applyLocked(const OrderUpdate& update);
+    // Reports the difference to what the order had open before the change.
+    void reportExposure(ManagedOrder& order, double openBefore, int liveBefore);
+    void initIndex(Index& index, std::string_view (*key)(const ManagedOrder&));
+    bool recentlyFinished(std::string_view orderId) const;
+    // Closes the orders the snapshot of 'round' did not list. Returns how many.
+    size_t settleMissing(uint32_t round);
+    static bool copyKey(char* out, size_t capacity, std::string_view value);
+    static uint64_t hash(std::string_view key);
+};
+
+#endif
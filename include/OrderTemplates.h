@@ -0,0 +1,111 @@
+#ifndef ORDERTEMPLATES_H
+#define ORDERTEMPLATES_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "RateLimiter.h"
+
+enum class OrderAction {
+    PLACE,
+    CANCEL,
+    EDIT
+};
+
+inline RequestPriority requestPriority(OrderAction action) {
+    switch (action) {
+        case OrderAction::CANCEL: return RequestPriority::CANCEL;
+        case OrderAction::EDIT: return RequestPriority::EDIT;
+        default: return RequestPriority::ORDER;
+    }
+}
+
+// One order, cancel or edit. Use the factories rather than filling it by hand.
+struct OrderRequest {
+    OrderAction action = OrderAction::PLACE;
+    std::string instrument;
+    std::string side;       // "buy" or "sell"
+    std::string orderType;  // "market" or "limit"
+    double amount = 0.0;
+    double price = 0.0;
+    std::string expiryDate;
+    double strikePrice = 0.0;
+    std::string optionType;
+    std::string orderId;    // cancel / edit
+    std::string label;      // client label of a new order; the OrderManager fills it in when empty
+    // Set by a passing RiskGate::checkOrder(): the order's open-order slot,
+    // amount and this notional are already counted, and the OrderManager
+    // releases exactly them as the order fills or ends.
+    bool riskReserved = false;
+    double reservedNotional = 0.0;
+
+    static OrderRequest place(const std::string& instrument, double amount, const std::string& side,
+                              const std::string& orderType, double price, const std::string& expiryDate = "",
+                              double strikePrice = 0.0, const std::string& optionType = "",
+                              const std::string& label = "");
+    static OrderRequest cancel(const std::string& orderId);
+    static OrderRequest edit(const std::string& orderId, double newAmount, double newPrice);
+};
+
+// Renders JSON-RPC order messages from pre-serialized templates.
+// A template is the nlohmann::json rendering of a message with placeholders
+// for the per-order fields, split into literal segments; rendering copies the
+// segments and writes the fields in between. Place templates are compiled
+// once per instrument and message shape (side, limit or not, which optional
+// fields are present). Output is byte-identical to renderJson(): same key
+// order, same number formatting. Rendering into a reused buffer does not
+// allocate once the buffer and the template exist. Thread safe.
+class OrderMessageBuilder {
+public:
+    OrderMessageBuilder();
+
+    // Clears 'out' and writes the whole message {"id":..,"jsonrpc":"2.0","method":..,"params":{..}}.
+    void render(std::string& out, uint64_t id, const OrderRequest& request) const;
+
+    // The same message built through nlohmann::json, as the clients used to.
+    // Reference for verification, and the path for strings that need escaping.
+    static std::string renderJson(uint64_t id, const OrderRequest& request);
+
+private:
+    enum class Field : uint8_t {
+        NONE,
+        ID,
+        AMOUNT,
+        PRICE,
+        STRIKE,
+        TYPE,
+        EXPIRY,
+        OPTION_TYPE,
+        ORDER_ID,
+        LABEL
+    };
+
+    // Literal text followed by one field (NONE for the trailing literal).
+    struct Segment {
+        std::string literal;
+        Field field;
+    };
+    using MessageTemplate = std::vector<Segment>;
+
+    // buy/sell x limit/other x expiry x strike x option type x label
+    static constexpr size_t kPlaceVariants = 64;
+    struct InstrumentTemplates {
+        std::unique_ptr<MessageTemplate> variants[kPlaceVariants];
+    };
+
+    MessageTemplate cancelTemplate;
+    MessageTemplate editTemplate;
+    mutable std::mutex cacheMutex;
+    mutable std::map<std::string, std::unique_ptr<InstrumentTemplates>, std::less<>> placeTemplates;
+
+    const MessageTemplate& placeTemplate(const OrderRequest& request) const;
+    static MessageTemplate compile(const OrderRequest& request);
+    static bool needsEscape(const std::string& value);
+    static void appendDouble(std::string& out, double value);
+    static void appendUnsigned(std::string& out, uint64_t value);
+};
+
+#endif
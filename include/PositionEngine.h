@@ -0,0 +1,157 @@
+#ifndef POSITIONENGINE_H
+#define POSITIONENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "InstrumentRegistry.h"
+#include "Seqlock.h"
+#include "WebsocketClient.h"
+
+constexpr size_t kMaxCurrencies = 16;
+constexpr uint8_t kNoCurrency = 0xFF;
+
+// Inverse contracts (BTC-PERPETUAL, ETH-27DEC24) are sized in USD and settle
+// in the coin; linear ones (options, *_USDC) are sized in the base and settle
+// in the quote, so the PnL formulas differ.
+enum class ContractType : uint8_t {
+    LINEAR,
+    INVERSE
+};
+
+// Stored position of one instrument, published per instrument through a seqlock.
+struct PositionState {
+    double size;            // signed: USD for inverse futures, base currency otherwise
+    double averagePrice;
+    double realizedPnl;     // settlement currency, after fees
+    double fees;
+    double lastMarkPrice;   // from the exchange, used when no ticker is subscribed
+    int64_t lastTradeSeq;   // per-instrument trade sequence already applied
+    int64_t updatedAt;      // exchange timestamp (ms) of the last change
+    ContractType contract;
+    uint8_t currency;       // settlement currency slot
+};
+
+// A position valued against the current mark price.
+struct PositionView {
+    InstrumentId instrument;
+    double size;
+    double averagePrice;
+    double markPrice;
+    double realizedPnl;
+    double unrealizedPnl;
+    double fees;
+    ContractType contract;
+    uint8_t currency;
+};
+
+// Latest user.portfolio.<currency> values.
+struct AccountState {
+    double equity;
+    double balance;
+    double availableFunds;
+    double initialMargin;
+    double maintenanceMargin;
+    double totalPnl;
+    bool valid;
+};
+
+struct CurrencyTotals {
+    double realizedPnl;
+    double unrealizedPnl;
+    size_t openPositions;
+    AccountState account;
+};
+
+// Keeps the account's positions current from a get_positions snapshot per
+// currency, taken again after every login since a lost session's changes are
+// never resent, followed by the user.changes stream (trades and the exchange's
+// own position records) and user.portfolio. Realized PnL is accumulated per trade
+// with average-cost accounting; unrealized PnL is computed on query against
+// the live ticker mark (the client's TickerStore), so reads never wait for a
+// round trip. Updates are applied on the client's consumer thread; queries are
+// lock-free seqlock reads from any thread.
+class PositionEngine {
+public:
+    explicit PositionEngine(WebsocketClient& client);
+
+    // Subscribes user.changes and user.portfolio for each currency and
+    // requests the positions of every known currency after each login of the
+    // client's session, the first included. Call once the client is started.
+    void start(const std::vector<std::string>& currencies);
+
+    // Registers an instrument before its first update and posts its ticker
+    // subscription to the I/O thread. Trade calls it for every order that
+    // passes risk, so the consumer normally finds each instrument already
+    // interned. Cheap once registered; safe from any thread.
+    void track(std::string_view instrument);
+
+    // False if the engine has never seen the instrument.
+    bool position(InstrumentId instrument, PositionView& out) const;
+    bool position(const std::string& instrument, PositionView& out) const;
+    // Every instrument with a non-zero position.
+    std::vector<PositionView> openPositions() const;
+    // Sum over the positions settling in 'currency', plus its portfolio values.
+    CurrencyTotals totals(const std::string& currency) const;
+    // Signed size only, without valuing it; 0 for unknown instruments.
+    double positionSize(InstrumentId instrument) const;
+    // Sum of |size| over every position, in USD for inverse contracts and in
+    // the quote at the average price for linear ones. Maintained per update.
+    double grossNotional() const { return gross.load(std::memory_order_acquire); }
+    // Currencies in slot order; PositionView::currency indexes this list.
+    std::vector<std::string> currencies() const;
+
+    static ContractType contractTypeFor(std::string_view instrument);
+    // BTC-PERPETUAL -> BTC, BTC_USDC-PERPETUAL -> USDC, ETH-27DEC24-3000-C -> ETH
+    static std::string_view settlementCurrency(std::string_view instrument);
+
+    // Consumer thread (or the single thread feeding the engine).
+    void applyTrade(const nlohmann::json& trade);
+    void applyPosition(const nlohmann::json& position);
+    void applyChanges(std::string_view data);
+    void applyPortfolio(std::string_view currency, std::string_view data);
+
+private:
+    WebsocketClient& client;
+    InstrumentRegistry& registry;
+
+    std::unique_ptr<Seqlock<PositionState>[]> states;
+    std::unique_ptr<PositionState[]> working;      // writer's copy of every slot
+    std::unique_ptr<bool[]> known;                 // writer only
+    std::unique_ptr<std::atomic<bool>[]> tickerRequested;
+    InstrumentId tracked[kMaxInstruments];         // every instrument seen, in order
+    std::atomic<size_t> trackedCount;
+    std::unique_ptr<double[]> grossPerInstrument;  // writer only
+    double grossTotal = 0.0;                       // writer only
+    std::atomic<double> gross;
+
+    // Slots are only appended; names are written before the count is published.
+    std::string currencyNames[kMaxCurrencies];
+    std::atomic<size_t> currencyCount;
+    Seqlock<AccountState> accounts[kMaxCurrencies];
+
+    // user.changes that arrive while snapshots are outstanding are held and
+    // applied after them, so a snapshot never overwrites a newer change.
+    // Consumer thread, except the counter, which start() may raise.
+    std::atomic<int> snapshotsPending{0};
+    std::vector<std::string> heldChanges;
+    void requestSnapshots();
+    void applySnapshot(const std::string& currency, const std::string& body);
+    void releaseHeldChanges();
+
+    uint8_t currencySlot(std::string_view currency);
+    uint8_t findCurrency(std::string_view currency) const;
+    // Writer: the working state of an instrument. Lock-free for known ones;
+    // only an instrument nobody registered is interned here.
+    PositionState* stateFor(std::string_view instrument, InstrumentId& id);
+    PositionState* firstSight(std::string_view instrument, InstrumentId& id);
+    void publish(InstrumentId instrument);
+    double markPrice(InstrumentId instrument, const PositionState& state) const;
+    PositionView value(InstrumentId instrument, const PositionState& state) const;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Outbound request classes, highest priority first. When credits run short the
+// queue drains in this order, so a burst of new orders never delays a cancel.
+enum class RequestPriority : uint8_t {
+    CANCEL,
+    EDIT,
+    ORDER,
+    QUERY,  // subscriptions, positions, open orders, auth, ...
+    COUNT
+};
+constexpr size_t kRequestPriorities = static_cast<size_t>(RequestPriority::COUNT);
+
+// Deribit meters orders, edits and cancels (matching engine) separately from
+// everything else (non-matching engine). Each is a token bucket refilled at
+// 'rate' requests per second up to 'burst'. The defaults are the exchange's
+// default account tier; set them to the limits private/get_account_summary reports.
+struct CreditBucketOptions {
+    double rate;
+    double burst;
+};
+
+struct RateLimitOptions {
+    CreditBucketOptions matchingEngine{5.0, 20.0};
+    CreditBucketOptions nonMatchingEngine{20.0, 100.0};
+    // A "too_many_requests" error empties the bucket and pauses it this long on top.
+    std::chrono::milliseconds throttledBackoff{100};
+};
+
+struct RateLimiterStats {
+    size_t queued[kRequestPriorities];      // waiting right now
+    uint64_t sent[kRequestPriorities];      // let through, at once or after waiting
+    uint64_t delayed[kRequestPriorities];   // of those, how many had to wait
+    int64_t totalWaitNs[kRequestPriorities];
+    int64_t maxWaitNs[kRequestPriorities];
+    uint64_t throttled;                     // rate limit errors reported by the exchange
+    uint64_t cancelled;                     // queued sends dropped by cancel()
+    double credits[2];                      // matching, non-matching
+};
+
+// Client-side credit scheduler shared by every session of one account. A
+// request goes out at once while its bucket has a credit and nothing of the
+// same or higher priority is waiting for that bucket; otherwise it queues.
+//
+// Synchronous callers (REST) block in acquire(). Asynchronous ones (the
+// WebSocket) hand their send to submit(), which runs it inline when it may
+// go now and otherwise queues it; queued sends run from whichever thread
+// calls drain() next: a blocked acquire() or the owner's timer, armed for
+// the time submit() returns. A session that ends drops its queued sends
+// with cancel(), so they neither run on the next session nor use credits.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateLimiter(const RateLimitOptions& options = RateLimitOptions());
+
+    // Blocks until the request may go, then takes its credit.
+    void acquire(RequestPriority priority);
+    // Takes a credit if the request may go now; never queues.
+    bool tryAcquire(RequestPriority priority);
+    // Runs 'send' inline and returns Clock::time_point() if it may go now;
+    // otherwise queues it and returns when the next queued send can run.
+    Clock::time_point submit(RequestPriority priority, std::function<void()> send, const void* owner = nullptr);
+    // Removes the queued sends submitted by 'owner' without running them.
+    // Returns how many were dropped.
+    size_t cancel(const void* owner);
+    // Runs every queued send whose credit is available. Returns when the next
+    // remaining one can run, or Clock::time_point() if nothing is queued.
+    Clock::time_point drain();
+    // The exchange rejected a request of this class for exceeding its limits.
+    void onThrottled(RequestPriority priority);
+
+    // Time until a request of this class could take a credit; zero if now.
+    std::chrono::nanoseconds waitEstimate(RequestPriority priority);
+    RateLimiterStats stats() const;
+    // Queue depth, sends, delays and wait per priority to the latency log.
+    void logStats(const char* label) const;
+    static const char* priorityName(RequestPriority priority);
+
+private:
+    struct Bucket {
+        double rate;
+        double burst;
+        double credits;
+        Clock::time_point refilledAt;
+        Clock::time_point pausedUntil;
+    };
+    struct Waiter {
+        Clock::time_point enqueuedAt;
+        std::function<void()> send; // empty for a blocked acquire()
+        bool* granted;              // set for a blocked acquire()
+        const void* owner;          // submit() caller, for cancel()
+    };
+
+    RateLimitOptions options;
+    Bucket buckets[2];
+    std::deque<Waiter> queues[kRequestPriorities];
+    RateLimiterStats counters{};
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+
+    static size_t bucketFor(RequestPriority priority) { return priority == RequestPriority::QUERY ? 1 : 0; }
+    void refill(Bucket& bucket, Clock::time_point now);
+    bool mayGo(RequestPriority priority, Clock::time_point now);
+    void recordSent(RequestPriority priority, int64_t waitNs);
+    // Grants queued waiters in priority order; sends to run are moved to 'ready'.
+    Clock::time_point grantLocked(Clock::time_point now, std::vector<std::function<void()>>& ready);
+    Clock::time_point readyAt(const Bucket& bucket, Clock::time_point now) const;
+};
+
+#endif // RATELIMITER_H
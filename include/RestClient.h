@@ -2,14 +2,28 @@
 #define RESTCLIENT_H
 
 #include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
 #include "Logger.h"
 #include "spdlog/spdlog.h"
 #include "Authorisation.h"
+#include "HttpConnectionPool.h"
+#include "OrderTemplates.h"
+#include "OrderManager.h"
+
+// Outcome of one batch entry. 'result' holds what the single-request call
+// would have returned (order id, "ORDER_CANCELED", "ORDER_FAILED", ...).
+struct OrderResult {
+    std::string result;
+    bool ok = false;
+    int64_t latencyNs = 0; // request sent to response received
+};
 
 class RestClient {
 public:
     // Constructor: receives a pointer to the shared Authorization instance.
-    explicit RestClient(Authorization* auth);
+    explicit RestClient(Authorization* auth, const HttpPoolOptions& poolOptions = HttpPoolOptions());
     ~RestClient();
 
     // Place an order.
@@ -28,14 +42,51 @@ public:
 
     // Modify an existing order.
     std::string modifyOrder(const std::string& orderId, double newAmount, double newPrice);
-    
-    
+
+    // Any of the three from a prepared request, keeping its risk reservation.
+    std::string sendOrder(OrderRequest request);
+
+    // Send every request at once on pooled handles driven by a curl multi handle
+    // and wait for all of them. Results are in request order. At most pool-size
+    // requests are in flight; the rest start as handles free up.
+    std::vector<OrderResult> executeBatch(const std::vector<OrderRequest>& batch);
+
+    // JSON-RPC body for a request, as sent by the single and batch paths.
+    std::string payloadFor(const OrderRequest& request) const;
+    // Same, rendered into a reused buffer without allocating.
+    void payloadFor(const OrderRequest& request, std::string& out) const;
+
+    // Orders, edits and cancels are registered with it before sending and
+    // their responses applied to it. Set before any order is sent.
+    void setOrderManager(OrderManager* manager) { orders = manager; }
+    // Every request takes a credit from it first, blocking while the account's
+    // limits are used up; batches start cancels, then edits, then new orders.
+    void setRateLimiter(RateLimiter* limiter) { rateLimiter = limiter; }
+
 
 private:
     Authorization* auth;  // Shared authorization object.
+    HttpConnectionPool pool; // Warmed keep-alive connections reused by every request.
+
+    // Endpoint URLs, built once from the pool's base URL.
+    std::string buyUrl;
+    std::string sellUrl;
+    std::string cancelUrl;
+    std::string editUrl;
+
+    OrderMessageBuilder messages; // per-instrument order message templates
+    OrderManager* orders = nullptr;
+    RateLimiter* rateLimiter = nullptr;
+    CURLM* multi;          // drives batches; one batch at a time
+    std::mutex batchMutex;
     
     // Helper function: perform a POST request.
     std::string httpPost(const std::string& url, const std::string& jsonPayload);
+
+    // Shared by the single and batch paths.
+    const std::string& urlFor(const OrderRequest& request) const;
+    OrderResult handleResponse(const OrderRequest& request, OrderHandle handle, const std::string& response,
+                               int64_t duration);
   
     
 };
@@ -0,0 +1,146 @@
+#ifndef RISKGATE_H
+#define RISKGATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "InstrumentRegistry.h"
+#include "OrderManager.h"
+#include "OrderTemplates.h"
+#include "Seqlock.h"
+
+class OrderBookManager;
+class TickerStore;
+class PositionEngine;
+class WebsocketClient;
+
+// Per-instrument limits. 0 disables a limit. Sizes are in the instrument's
+// amount unit (USD for inverse futures, base currency otherwise); notional is
+// USD for inverse contracts and amount * price for linear ones.
+struct RiskLimits {
+    double maxOrderSize = 0.0;
+    double maxNotional = 0.0;
+    // Fraction of the reference price a limit order may cross it by: a buy
+    // above ask * (1 + collar) or a sell below bid * (1 - collar) is rejected.
+    double priceCollar = 0.0;
+    // |position + everything working on one side| if all of it filled.
+    double maxPosition = 0.0;
+};
+
+struct RiskConfig {
+    RiskLimits defaults;           // preloaded by setLimits(instrument); edits of unknown orders
+    double maxGrossNotional = 0.0; // positions plus working orders, all instruments
+    int maxOpenOrders = 0;
+    // Reject orders that need a reference price (collar, market notional) when
+    // neither a valid book nor a ticker mark is available.
+    bool requireReferencePrice = false;
+};
+
+enum class RiskReject : uint8_t {
+    NONE,
+    INVALID,             // non-positive amount, negative price, instrument without preloaded limits
+    ORDER_SIZE,
+    NOTIONAL,
+    PRICE_COLLAR,
+    NO_REFERENCE_PRICE,
+    POSITION,
+    GROSS_NOTIONAL,
+    OPEN_ORDERS,
+    COUNT
+};
+constexpr size_t kRiskRejects = static_cast<size_t>(RiskReject::COUNT);
+
+struct RiskStats {
+    uint64_t checked;
+    uint64_t passed;
+    uint64_t rejected[kRiskRejects]; // indexed by RiskReject; NONE stays 0
+    int openOrders;
+    double workingNotional;
+};
+
+// Pre-trade checks in front of every order and edit. Limits are preloaded
+// (setLimits is the cold path) and orders for any other instrument are
+// rejected; a check reads them through per-instrument seqlocks, the book and
+// ticker through their own lock-free stores, and updates the working-order
+// counters with atomics, so it never takes a lock.
+//
+// A passing checkOrder() reserves the order's open-order slot and working
+// amount at once, so concurrent checks cannot both use the last of a limit.
+// Reservations are released from the order manager's exposure feed as orders
+// fill, are cancelled or are rejected, each by exactly the notional reserved
+// for it (recorded per order); without an attached manager only the
+// stateless limits (size, notional, collar) are enforced.
+class RiskGate {
+public:
+    RiskGate(InstrumentRegistry& registry, const OrderBookManager* books, const TickerStore* tickers,
+             const PositionEngine* positions, const RiskConfig& config = RiskConfig());
+    // Reference prices from the client's books and tickers.
+    explicit RiskGate(WebsocketClient& client, const PositionEngine* positions = nullptr,
+                      const RiskConfig& config = RiskConfig());
+
+    // Cold path: interns the instrument and records whether it is inverse.
+    // Call before trading it; the second form loads config.defaults.
+    void setLimits(const std::string& instrument, const RiskLimits& limits);
+    void setLimits(const std::string& instrument);
+    RiskLimits limits(InstrumentId instrument) const;
+
+    // Subscribes to the manager's exposure feed; replaces its previous listener.
+    void attach(OrderManager& manager);
+
+    // PLACE requests are checked and, on success, reserved; the reservation is
+    // recorded on the request for the order manager to release. Cancels always
+    // pass; edits should go through checkEdit.
+    RiskReject checkOrder(OrderRequest& request);
+    // An edit of a tracked order: size, notional and collar of the new terms,
+    // and the position limit for any increase of its unfilled amount.
+    RiskReject checkEdit(const ManagedOrder& order, double newAmount, double newPrice);
+
+    // Exposure feed of the order manager. Returns the notional counted for an increase.
+    double onExposure(const ExposureChange& change);
+
+    RiskStats stats() const;
+    // Checks, passes, rejects by reason and working totals to the latency log.
+    void logStats(const char* label) const;
+    static const char* rejectName(RiskReject reason);
+
+private:
+    // Published per instrument id; 'loaded' is false until setLimits().
+    struct InstrumentRisk {
+        RiskLimits limits;
+        bool inverse;
+        bool loaded;
+    };
+
+    struct Working {
+        std::atomic<double> buy{0.0};
+        std::atomic<double> sell{0.0};
+    };
+
+    InstrumentRegistry& registry;
+    const OrderBookManager* books;
+    const TickerStore* tickers;
+    const PositionEngine* positions;
+    RiskConfig config;
+    bool tracking = false;
+
+    std::unique_ptr<Seqlock<InstrumentRisk>[]> instrumentLimits;
+    std::unique_ptr<Working[]> working;
+    std::mutex limitsMutex; // serializes the seqlock writers
+
+    std::atomic<int> openOrders{0};
+    std::atomic<double> workingNotional{0.0};
+    std::atomic<uint64_t> checked{0};
+    std::atomic<uint64_t> passed{0};
+    std::atomic<uint64_t> rejected[kRiskRejects];
+
+    // Best price on the side an order of 'buy' would trade against, else the ticker mark.
+    bool referencePrice(InstrumentId instrument, bool buy, double& out) const;
+    RiskReject checkTerms(InstrumentId instrument, const RiskLimits& limits, bool inverse, bool buy,
+                          bool limitOrder, double amount, double price, double& notional) const;
+    RiskReject reject(RiskReject reason);
+};
+
+#endif // RISKGATE_H
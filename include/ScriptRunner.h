@@ -0,0 +1,80 @@
+#ifndef SCRIPTRUNNER_H
+#define SCRIPTRUNNER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include "trade.h"
+
+struct ScriptOptions {
+    // WebSocket orders sent but not answered before reading the next command blocks.
+    size_t maxInFlight = 256;
+    // Consecutive REST orders sent together as one concurrent batch.
+    size_t restWindow = 32;
+    // How long the end of the script, "wait" and a full in-flight window wait
+    // for responses; orders still unanswered then are reported as TIMEOUT.
+    std::chrono::milliseconds drainTimeout{10000};
+};
+
+struct ScriptSummary {
+    size_t commands = 0;
+    size_t ok = 0;
+    size_t failed = 0;   // including parse errors and timeouts
+    int64_t wallNs = 0;
+};
+
+// Headless driver for Trade. Reads one JSON command per line:
+//   {"cmd":"place","instrument":"BTC-PERPETUAL","side":"buy","type":"limit","amount":10,"price":60000,
+//    "label":"a1","expiry":"","strike":0,"option_type":""}
+//   {"cmd":"cancel","order_id":"BTC-123"}            or {"cmd":"cancel","label":"a1"}
+//   {"cmd":"modify","order_id":"BTC-123","amount":20,"price":60010}   (or "label")
+//   {"cmd":"subscribe","channel":"book"|"trades","instruments":["BTC-PERPETUAL"]}
+//   {"cmd":"positions"}
+//   {"cmd":"transport","value":"rest"|"websocket"}
+//   {"cmd":"wait"}                                   until every outstanding order is answered
+//   {"cmd":"sleep","ms":100}
+// An optional "id" is echoed back. Orders are pipelined: over the WebSocket
+// each one is sent as soon as it is read, over REST consecutive ones go out
+// as concurrent batches. One result line is written per command as it
+// completes (so not necessarily in input order):
+//   {"line":3,"id":"x","cmd":"place","ok":true,"result":"BTC-123","latency_ns":...,"rtt_ns":...}
+// latency_ns runs from reading the command to its response, rtt_ns is the
+// exchange round trip. A final {"summary":{...}} line carries counts,
+// throughput and latency percentiles. Labels resolve to order ids through the
+// order manager, so cancel or modify by label after a "wait" for the place.
+class ScriptRunner {
+public:
+    ScriptRunner(Trade& trade, std::ostream& out, const ScriptOptions& options = ScriptOptions());
+    ~ScriptRunner();
+
+    ScriptSummary run(std::istream& in);
+
+private:
+    struct State;
+    struct Pending {
+        size_t line;
+        json id;
+        std::string cmd;
+        OrderRequest request;
+        std::chrono::steady_clock::time_point readAt;
+    };
+
+    Trade& trade;
+    ScriptOptions options;
+    // Shared with response callbacks, which can outlive the runner after a timeout.
+    std::shared_ptr<State> state;
+    std::vector<Pending> restWindow;
+
+    void execute(size_t line, const json& command, std::chrono::steady_clock::time_point readAt);
+    bool buildOrder(const std::string& cmd, const json& command, OrderRequest& out, std::string& error);
+    void submitOrder(Pending pending);
+    void flushRestWindow();
+    bool waitForResponses();
+    void failOutstanding();
+};
+
+#endif // SCRIPTRUNNER_H
@@ -0,0 +1,53 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer / multi-reader sequence lock.
+// The writer never blocks, readers retry while a write is in progress.
+// T must be trivially copyable since readers copy it while it may be written.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+public:
+    Seqlock() : seq(0) {
+        std::memset(static_cast<void*>(&data), 0, sizeof(T));
+    }
+
+    // Publish a new value. Only one thread may call store() for a given instance.
+    void store(const T& value) {
+        uint64_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(static_cast<void*>(&data), &value, sizeof(T));
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Read a consistent copy of the latest value. Safe from any thread.
+    T load() const {
+        T out;
+        uint64_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            std::memcpy(static_cast<void*>(&out), &data, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return out;
+    }
+
+    // Number of completed writes so far.
+    uint64_t version() const {
+        return seq.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    std::atomic<uint64_t> seq;
+    T data;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// How a consumer waits for the next item.
+enum class WaitStrategy {
+    BUSY_SPIN, // lowest latency, burns a core
+    YIELD,     // spin with sched_yield between polls
+    BLOCK      // sleep on a condition variable, producer wakes it
+};
+
+struct RingStats {
+    size_t capacity;
+    size_t occupancy;
+    uint64_t published;
+    uint64_t dropped;       // claims rejected because the ring was full
+    size_t highWatermark;   // max occupancy seen by the producer at publish time
+};
+
+// Bounded single-producer / single-consumer ring of preallocated slots.
+// Slots are constructed once and reused, so the producer fills them in place
+// (claim() -> write -> publish()) and the consumer reads them in place
+// (front() -> read -> pop()). Head and tail live on separate cache lines and
+// each side caches the other's index to avoid touching the shared line on
+// every operation.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t requestedCapacity)
+        : cap(roundUp(requestedCapacity)), mask(cap - 1), slots(new Slot[cap]),
+          tail(0), cachedHead(0), publishedCount(0), droppedCount(0), highWater(0),
+          head(0), cachedTail(0), consumerWaiting(false) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Visit every slot, e.g. to reserve buffers up front.
+    template <typename F>
+    void forEachSlot(F fn) {
+        for (size_t i = 0; i < cap; ++i) {
+            fn(slots[i].value);
+        }
+    }
+
+    // ------------------ Producer side ------------------ //
+
+    // Returns the next free slot, or nullptr (and counts a drop) if the ring is full.
+    T* claim() {
+        T* slot = tryClaim();
+        if (!slot) {
+            recordDrop();
+        }
+        return slot;
+    }
+
+    // Like claim(), but a full ring is not counted; for producers that hold
+    // the item back and retry instead of dropping it.
+    T* tryClaim() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead >= cap) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead >= cap) {
+                return nullptr;
+            }
+        }
+        return &slots[t & mask].value;
+    }
+
+    void recordDrop() {
+        droppedCount.store(droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void publish() {
+        size_t t = tail.load(std::memory_order_relaxed) + 1;
+        tail.store(t, std::memory_order_release);
+        publishedCount.store(publishedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // Against the consumer's current head: the cached one only refreshes
+        // when the ring looks full and would make every burst read as full.
+        cachedHead = head.load(std::memory_order_acquire);
+        size_t occupancy = t - cachedHead;
+        if (occupancy > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(occupancy, std::memory_order_relaxed);
+        }
+        if (consumerWaiting.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            waitCv.notify_one();
+        }
+    }
+
+    // ------------------ Consumer side ------------------ //
+
+    // Oldest published slot, or nullptr if empty.
+    T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &slots[h & mask].value;
+    }
+
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Wait for the next slot using the given strategy. Returns nullptr once
+    // running becomes false.
+    T* wait(WaitStrategy strategy, const std::atomic<bool>& running) {
+        for (;;) {
+            if (T* item = front()) {
+                return item;
+            }
+            if (!running.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            switch (strategy) {
+                case WaitStrategy::BUSY_SPIN:
+                    break;
+                case WaitStrategy::YIELD:
+                    std::this_thread::yield();
+                    break;
+                case WaitStrategy::BLOCK: {
+                    // The timeout bounds the cost of a wakeup lost between the
+                    // producer's tail store and its consumerWaiting check.
+                    std::unique_lock<std::mutex> lock(waitMutex);
+                    consumerWaiting.store(true, std::memory_order_release);
+                    if (empty() && running.load(std::memory_order_acquire)) {
+                        waitCv.wait_for(lock, std::chrono::milliseconds(1));
+                    }
+                    consumerWaiting.store(false, std::memory_order_release);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Wake a consumer blocked in wait(), e.g. when shutting down.
+    void wakeConsumer() {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        waitCv.notify_all();
+    }
+
+    // ------------------ Observability ------------------ //
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return cap; }
+    size_t occupancy() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    RingStats stats() const {
+        RingStats s;
+        s.capacity = cap;
+        s.occupancy = occupancy();
+        s.published = publishedCount.load(std::memory_order_relaxed);
+        s.dropped = dropped();
+        s.highWatermark = highWater.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    static size_t roundUp(size_t n) {
+        size_t p = 2;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    const size_t cap;
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    // Written by the producer.
+    alignas(64) std::atomic<size_t> tail;
+    size_t cachedHead;
+    std::atomic<uint64_t> publishedCount;
+    std::atomic<uint64_t> droppedCount;
+    std::atomic<size_t> highWater;
+
+    // Written by the consumer.
+    alignas(64) std::atomic<size_t> head;
+    size_t cachedTail;
+
+    alignas(64) std::atomic<bool> consumerWaiting;
+    std::mutex waitMutex;
+    std::condition_variable waitCv;
+};
+
+#endif
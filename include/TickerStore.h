@@ -0,0 +1,91 @@
+#ifndef TICKERSTORE_H
+#define TICKERSTORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "InstrumentRegistry.h"
+
+// Latest ticker.* values of one instrument. Fields a ticker does not carry
+// (funding for options, IVs for futures) or sends as null are NaN.
+struct TickerSnapshot {
+    double bestBidPrice;
+    double bestBidAmount;
+    double bestAskPrice;
+    double bestAskAmount;
+    double markPrice;
+    double indexPrice;
+    double lastPrice;
+    double currentFunding;
+    double funding8h;
+    double openInterest;
+    double markIv;
+    double bidIv;
+    double askIv;
+    double underlyingPrice;
+    int64_t timestamp;  // exchange timestamp in ms, 0 if never updated
+};
+
+// Numeric fields of TickerSnapshot, in declaration order.
+enum class TickerField : uint8_t {
+    BEST_BID_PRICE,
+    BEST_BID_AMOUNT,
+    BEST_ASK_PRICE,
+    BEST_ASK_AMOUNT,
+    MARK_PRICE,
+    INDEX_PRICE,
+    LAST_PRICE,
+    CURRENT_FUNDING,
+    FUNDING_8H,
+    OPEN_INTEREST,
+    MARK_IV,
+    BID_IV,
+    ASK_IV,
+    UNDERLYING_PRICE,
+    COUNT
+};
+constexpr size_t kTickerFields = static_cast<size_t>(TickerField::COUNT);
+
+// Latest ticker per instrument id, stored structure-of-arrays (one array per
+// field, so scanning one field across an option chain stays in cache) and
+// published through a seqlock per instrument slot. One thread writes (the
+// client's consumer thread); any number of threads read without locking or
+// allocating. tryLoad() is a single bounded attempt; load() retries only while
+// a write to that same slot is in flight.
+class TickerStore {
+public:
+    TickerStore();
+
+    // Writer only.
+    void store(InstrumentId instrument, const TickerSnapshot& ticker);
+
+    // False if the instrument has never been written.
+    bool load(InstrumentId instrument, TickerSnapshot& out) const;
+    // Also false if a write was in progress.
+    bool tryLoad(InstrumentId instrument, TickerSnapshot& out) const;
+    bool loadField(InstrumentId instrument, TickerField field, double& out) const;
+
+    // Number of updates stored for the instrument.
+    uint64_t version(InstrumentId instrument) const {
+        return instrument < kMaxInstruments ? sequences[instrument].value.load(std::memory_order_acquire) >> 1 : 0;
+    }
+
+private:
+    // Each slot's sequence on its own cache line, so a writer on one
+    // instrument does not disturb readers of its neighbours.
+    struct alignas(64) Sequence {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::unique_ptr<Sequence[]> sequences;
+    std::unique_ptr<double[]> values;     // [field * kMaxInstruments + instrument]
+    std::unique_ptr<int64_t[]> timestamps;
+
+    double* column(TickerField field) const {
+        return values.get() + static_cast<size_t>(field) * kMaxInstruments;
+    }
+    void read(InstrumentId instrument, TickerSnapshot& out) const;
+};
+
+#endif
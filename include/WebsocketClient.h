@@ -7,28 +7,94 @@
 #include <sstream>
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <string>
 #include <thread>
 #include <chrono>
 #include <atomic>
-#include <set>
+#include <deque>
+#include <bitset>
 #include <vector>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <random>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include "Authorisation.h" 
 #include "Logger.h"
+#include "ChannelDispatcher.h"
+#include "InstrumentRegistry.h"
+#include "LatencyHistogram.h"
+#include "OrderBook.h"
+#include "OrderTemplates.h"
+#include "MessageParser.h"
+#include "SpscRing.h"
+#include "TickerStore.h"
+#include "FrameJournal.h"
 
 
 // Use nlohmann::json for JSON handling.
 using json = nlohmann::json;
 using websocketpp::connection_hdl;
 
+class OrderManager;
+
 typedef websocketpp::client<websocketpp::config::asio_tls_client> WebsocketppClient;
 
+// Response to a JSON-RPC request sent over the WebSocket session.
+struct RpcResponse {
+    uint64_t id;
+    bool ok;             // false for an error response or when the connection dropped
+    std::string body;    // raw JSON text of "result" (ok) or "error"
+    int64_t roundTripNs;
+    // Not ok because the session was lost before an answer came: the request
+    // may or may not have taken effect. False for an exchange error, and for
+    // a request that was never written.
+    bool transportFailure = false;
+};
+using RpcCallback = std::function<void(const RpcResponse&)>;
+
+struct WebsocketClientOptions {
+    // Point at a local mock exchange (bin/mock_exchange) for offline testing.
+    std::string url = "wss://test.deribit.com/ws/api/v2";
+    // Frames buffered between the I/O thread and the consumer thread.
+    size_t ringCapacity = 4096;
+    // Bytes reserved per slot up front; bigger frames grow their slot once.
+    size_t frameReserve = 4096;
+    WaitStrategy waitStrategy = WaitStrategy::YIELD;
+    // Identifies this connection in captures.
+    uint32_t connectionId = 0;
+    // When set, every received frame is appended to a frame journal in this directory.
+    std::string captureDirectory;
+    size_t captureFileSize = 64 * 1024 * 1024;
+    // Reconnect backoff: doubles per failed attempt up to the max, with jitter.
+    std::chrono::milliseconds reconnectBaseDelay{500};
+    std::chrono::milliseconds reconnectMaxDelay{30000};
+    // Pin the I/O and consumer threads to these CPUs; -1 leaves them to the scheduler.
+    int ioCpu = -1;
+    int consumerCpu = -1;
+};
+
+// One received frame, copied out of websocketpp by the I/O thread.
+// Markers order session changes with the frames around them.
+enum class FrameKind : uint8_t {
+    DATA,
+    DISCONNECTED, // the session closed or a connection attempt failed; payload is the reason
+    RECONNECTED   // a new session opened
+};
+
+struct ReceivedFrame {
+    std::chrono::high_resolution_clock::time_point receivedAt;
+    std::string payload;
+    FrameKind kind = FrameKind::DATA;
+    uint64_t lastRequestId = 0; // DISCONNECTED: requests up to this id belonged to the lost session
+};
+
 class WebsocketClient {
 public:
     // Pass an Authorization pointer so the client can fetch a valid token.
-    explicit WebsocketClient(Authorization* auth);
+    explicit WebsocketClient(Authorization* auth, const WebsocketClientOptions& options = WebsocketClientOptions());
     ~WebsocketClient();
 
     // Start and stop the client event loop.
@@ -38,10 +104,81 @@ public:
     // Methods to send requests.
     void subscribeToOrderBook(const std::vector<std::string>& instruments);
     void subscribeToMarketTrades(const std::vector<std::string>& instruments);
-    void requestCurrentPositions(const std::string& currency);
+    // Any per-instrument channel kind; user.* channels go through private/subscribe.
+    void subscribe(ChannelKind kind, const std::vector<std::string>& instruments);
+    void subscribeToPortfolio(const std::string& currency);
+    // user.changes.<kind>.<currency>.raw: the account's trades, positions and orders as they change.
+    void subscribeToUserChanges(const std::string& kind = "any", const std::string& currency = "any");
+    // Future positions, logged to the positions log; with a callback, positions
+    // of every kind are handed to it instead (on the consumer thread).
+    void requestCurrentPositions(const std::string& currency, RpcCallback callback = nullptr);
+    // private/get_open_orders across every currency and kind.
+    void requestOpenOrders(RpcCallback callback);
+
+    // JSON-RPC over the WebSocket session. Every request gets a unique,
+    // monotonically increasing id. The callback runs on the consumer thread
+    // when the matching response arrives, or when the session is lost first
+    // (after every frame received before the loss). A request that cannot be
+    // written at all completes on the thread that tried to send it: the
+    // caller's, before this returns 0, or the I/O thread for one that waited
+    // for a rate limit credit. Returns the request id, or 0 if it could not be sent.
+    uint64_t sendRequest(const std::string& method, const json& params, RpcCallback callback,
+                         LatencyProbe probe = LatencyProbe::COUNT);
+    std::future<RpcResponse> request(const std::string& method, const json& params,
+                                     LatencyProbe probe = LatencyProbe::COUNT);
+
+    // Order entry over the WebSocket: private/buy, private/sell, private/edit, private/cancel.
+    uint64_t placeOrder(const std::string& instrument, double amount, const std::string& side,
+                        const std::string& orderType, double price, RpcCallback callback,
+                        const std::string& expiryDate = "", double strikePrice = 0.0,
+                        const std::string& optionType = "");
+    uint64_t modifyOrder(const std::string& orderId, double newAmount, double newPrice, RpcCallback callback);
+    uint64_t cancelOrder(const std::string& orderId, RpcCallback callback);
+    // Any of the three from a prepared request, keeping its label.
+    uint64_t sendOrder(const OrderRequest& request, RpcCallback callback);
+    // Runs 'task' on the I/O thread; for control requests (subscriptions)
+    // raised on the consumer thread, which must not wait on them.
+    void post(std::function<void()> task);
+    // Orders, edits and cancels are registered with it before sending and
+    // their responses applied to it. Set before any order is sent.
+    void setOrderManager(OrderManager* manager) { orderManager = manager; }
+    // Every request takes a credit from it. Requests that find the account's
+    // limits used up are queued in priority order and sent from the I/O thread
+    // as credits come back; their round trip starts when they are sent.
+    void setRateLimiter(RateLimiter* limiter) { rateLimiter = limiter; }
+
+    size_t pendingRequestCount() const;
+    uint64_t reconnectCount() const { return reconnects.load(std::memory_order_relaxed); }
+    // True from a successful public/auth until the session closes.
+    bool isAuthenticated() const { return authenticated.load(std::memory_order_acquire); }
+    // Runs on the consumer thread after every successful public/auth, once the
+    // session's subscriptions are replayed: the place to re-read state the
+    // lost session may have changed. Listeners are never removed.
+    void onAuthenticated(std::function<void()> listener);
+
+    // Occupancy and drop counters of the receive ring.
+    RingStats inboundStats() const { return inbound->stats(); }
+
+    // Live order books fed by the book.*.raw subscriptions.
+    OrderBookManager& orderBooks() { return books; }
+    // Ids of every subscribed instrument; also resolves incoming channel names.
+    InstrumentRegistry& instruments() { return registry; }
+    // Typed handlers for subscription notifications, called on the consumer thread.
+    ChannelDispatcher& channels() { return dispatcher; }
+    // Latest decoded ticker.* values per instrument id; readable from any thread.
+    const TickerStore& tickers() const { return tickerStore; }
+
+    // Parse and dispatch one received frame. Called by the consumer thread, and
+    // by bin/replay on a client that is never started.
+    void processFrame(const std::string& payload, std::chrono::high_resolution_clock::time_point receivedAt);
 
 private:
-    std::set<std::string> subscribedChannels;
+    WebsocketClientOptions options;
+    // Channels already subscribed, per kind and instrument id, and account-wide
+    // private channels by name. Replayed on every new session.
+    std::bitset<kMaxInstruments> subscribedChannels[kChannelKinds];
+    std::vector<std::string> accountChannels;
+    std::mutex subscriptionMutex;
     std::atomic<bool> running;
     std::unique_ptr<std::thread> wsThread;
     WebsocketppClient wsClient;
@@ -52,16 +189,95 @@ private:
 
     // Internal methods.
     void websocketLoop();
-    void sendMessage(const json& message);
-    void attemptReconnect();
+    bool sendText(const std::string& message);
 
-    int reconnectAttempts=0;
-    const int maxReconnectAttempts = 5;
-    const int maxReconnectDelay = 30; // seconds
+    // Reconnects are driven by this timer on the I/O thread; the state below is I/O thread only.
+    std::unique_ptr<boost::asio::steady_timer> reconnectTimer;
+    std::mt19937 reconnectRng;
+    unsigned reconnectAttempts = 0;
+    uint64_t sessions = 0;
+    std::atomic<uint64_t> reconnects;
+    std::atomic<bool> authenticated{false};
+    std::mutex authListenerMutex;
+    std::vector<std::function<void()>> authListeners;
+    void connect();
+    void scheduleReconnect();
+    void resubscribeAll(bool privateChannels);
+    void subscribeAccountChannel(const std::string& channel);
 
     // TLS initialization callback.
     static std::shared_ptr<boost::asio::ssl::context> on_tls_init();
     void wsAuthenticate();
+
+    InstrumentRegistry registry;
+    OrderBookManager books;
+    ChannelDispatcher dispatcher;
+    TickerStore tickerStore;
+    // Reused per frame so the receive path does not allocate.
+    MessageParser parser;
+    std::unique_ptr<ParsedMessage> parsed;
+    std::vector<BookLevelUpdate> bidScratch;
+    std::vector<BookLevelUpdate> askScratch;
+
+    // The I/O thread only timestamps and enqueues frames; the consumer thread
+    // parses and applies them.
+    std::unique_ptr<SpscRing<ReceivedFrame>> inbound;
+    // Frames that must not be lost (RPC responses, user.* notifications,
+    // heartbeats, session markers) but found the ring full. They are moved into the ring, oldest
+    // first, ahead of any later frame. I/O thread only.
+    std::deque<ReceivedFrame> overflow;
+    std::unique_ptr<boost::asio::steady_timer> overflowTimer;
+    bool overflowArmed = false;
+    std::atomic<uint64_t> overflowed{0};
+    void enqueueFrame(const std::string& payload, FrameKind kind, uint64_t lastRequestId = 0);
+    bool flushOverflow();
+    void scheduleOverflowFlush();
+    std::unique_ptr<FrameJournal> journal; // null unless capturing
+    std::atomic<bool> consumerRunning;
+    std::unique_ptr<std::thread> consumerThread;
+    uint64_t handledDrops = 0;
+    void consumerLoop();
+    void resyncAllBooks();
+    // Consumer thread: set when a new session opened, cleared by its first book snapshot.
+    bool reconnectPending = false;
+    std::chrono::high_resolution_clock::time_point reconnectedAt;
+    void handleDisconnected(const std::string& reason, uint64_t lastRequestId);
+    void handleReconnected(std::chrono::high_resolution_clock::time_point openedAt);
+
+    void handleParsedMessage(const ParsedMessage& message, const std::string& payload);
+    void handleJsonMessage(const std::string& payload);
+    void handleBookUpdate(InstrumentId instrument, const std::string& channel, const json& data);
+    void applyBookUpdate(OrderBook& book, InstrumentId instrument, const BookUpdate& update, std::string_view channel);
+    bool dispatchChannelData(const ChannelKey& key, std::string_view channel, std::string_view data);
+    void storeTicker(InstrumentId instrument, std::string_view data);
+    void resyncBook(const std::string& channel);
+
+    struct PendingRequest {
+        RpcCallback callback;
+        std::chrono::high_resolution_clock::time_point sentAt;
+        LatencyProbe probe;
+        RequestPriority priority;
+    };
+    std::atomic<uint64_t> nextRequestId;
+    mutable std::mutex pendingMutex;
+    std::unordered_map<uint64_t, PendingRequest> pending;
+    OrderMessageBuilder messages;
+    OrderManager* orderManager = nullptr;
+    RateLimiter* rateLimiter = nullptr;
+    uint64_t sendPrepared(uint64_t id, const std::string& message, RpcCallback callback, LatencyProbe probe,
+                          RequestPriority priority = RequestPriority::QUERY);
+    uint64_t sendNow(uint64_t id, const std::string& message, RpcCallback callback, LatencyProbe probe,
+                     RequestPriority priority);
+    uint64_t sendSessionRequest(const std::string& method, const json& params, RpcCallback callback);
+    void sendQueued(uint64_t id, const std::string& message);
+    void dropQueuedSends();
+    // Queued sends are drained by this timer on the I/O thread; the state below is I/O thread only.
+    std::unique_ptr<boost::asio::steady_timer> drainTimer;
+    bool drainArmed = false;
+    void scheduleDrain(std::chrono::steady_clock::time_point at);
+    uint64_t sendOrderRequest(OrderRequest request, RpcCallback callback, LatencyProbe probe);
+    void completeRequest(uint64_t id, bool ok, std::string_view body, bool transportFailure = false);
+    void failPendingRequests(const std::string& reason, uint64_t lastRequestId);
     
 };
 
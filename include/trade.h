@@ -4,9 +4,15 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <chrono>
+#include <functional>
 #include "RestClient.h"
 #include "WebsocketClient.h"
 
+class PositionEngine;
+class OrderManager;
+class RiskGate;
+
 // Enums for instruments for different products.
 enum class SpotInstrument {
     BTC_SPOT,
@@ -43,6 +49,12 @@ enum class OptionType {
     PUT
 };
 
+// Which session orders, edits and cancels are sent over.
+enum class OrderTransport {
+    REST,      // blocking HTTPS request per order
+    WEBSOCKET  // JSON-RPC over the authenticated WebSocket, many orders in flight
+};
+
 // Order structures for each trading product.
 
 // Spot Order structure.
@@ -90,19 +102,51 @@ public:
     void cancelOrder(const std::string& orderId);
     void modifyOrder(const std::string& orderId, double newAmount, double newPrice);
 
+    // Dispatch a batch of orders, cancels and edits concurrently over the
+    // configured transport and wait for every response. Results are in request
+    // order; over the WebSocket, entries still unanswered after 'timeout' fail.
+    std::vector<OrderResult> executeBatch(const std::vector<OrderRequest>& batch,
+                                          std::chrono::milliseconds timeout = std::chrono::milliseconds(10000));
+
+    // One order, cancel or edit without waiting for it. Over the WebSocket this
+    // returns once the request is written (or queued by the rate limiter) and
+    // 'done' runs on the consumer thread with the response; over REST it blocks
+    // and runs 'done' before returning. Risk rejections complete at once.
+    void submitAsync(const OrderRequest& request, std::function<void(const OrderResult&)> done);
+
+    void setOrderTransport(OrderTransport transport) { orderTransport = transport; }
+    OrderTransport getOrderTransport() const { return orderTransport; }
+
     // WebSocket market data functions.
     // getOrderBook subscribes to order book updates for a given symbol.
     void getOrderBook(const std::string& instrument);
-    // viewCurrentPositions requests current positions (assumes a currency, e.g., "BTC").
+    // viewCurrentPositions prints the live positions and PnL per currency from
+    // the position engine; without one it requests BTC future positions.
     void viewCurrentPositions();
+    void setPositionEngine(PositionEngine* engine) { positionEngine = engine; }
+    // viewOpenOrders prints every live order the order manager tracks.
+    void viewOpenOrders();
+    void setOrderManager(OrderManager* manager) { orderManager = manager; }
+    // Exchange order id of a live order placed with 'label'; needs the order manager.
+    bool orderIdForLabel(const std::string& label, std::string& orderId) const;
+    // Open positions and per-currency totals as JSON; empty without the position engine.
+    json positionsReport() const;
+    // Every order, edit and batch entry is checked by it before sending; a
+    // rejected one is logged and never sent (batch entries get "RISK_REJECTED").
+    void setRiskGate(RiskGate* gate) { riskGate = gate; }
     // Subscription functions.
     void subscribeToOrderBook(const std::vector<std::string>& instruments);
     void subscribeToMarketTrades(const std::vector<std::string>& instruments);
 
-    // Utility conversion functions.
-    static std::string spotInstrumentToString(SpotInstrument instrument);
-    static std::string futuresInstrumentToString(FuturesInstrument instrument);
-    static std::string optionsInstrumentToString(OptionsInstrument instrument);
+    // Order book queries against the live books. Return false if the
+    // instrument is not subscribed or its book is not currently valid.
+    bool getTopOfBook(const std::string& instrument, TopOfBook& out) const;
+    bool getBookDepth(const std::string& instrument, BookDepth& out) const;
+
+    // Utility conversion functions. Instrument names are static, so no string is built per call.
+    static const std::string& spotInstrumentToString(SpotInstrument instrument);
+    static const std::string& futuresInstrumentToString(FuturesInstrument instrument);
+    static const std::string& optionsInstrumentToString(OptionsInstrument instrument);
     static std::string orderSideToString(OrderSide side);
     static std::string orderTypeToString(OrderType type);
     static std::string optionTypeToString(OptionType type);
@@ -110,6 +154,19 @@ public:
 private:
     RestClient* restClient;
     WebsocketClient* wsClient;
+    OrderTransport orderTransport = OrderTransport::REST;
+    PositionEngine* positionEngine = nullptr;
+    OrderManager* orderManager = nullptr;
+    RiskGate* riskGate = nullptr;
+
+    // True if the risk gate (when there is one) lets the request through.
+    // May record a risk reservation on the request, so send that same request.
+    bool passesRisk(OrderRequest& request);
+    std::vector<OrderResult> sendBatch(const std::vector<OrderRequest>& batch, std::chrono::milliseconds timeout);
+
+    void placeOrder(const char* product, const std::string& instrument, double amount,
+                    OrderSide side, OrderType type, double price, const std::string& expiryDate = "",
+                    double strikePrice = 0.0, const std::string& optionType = "");
 };
 
 #endif // TRADE_H
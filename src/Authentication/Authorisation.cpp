@@ -1,71 +1,67 @@
 #include "Authorisation.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
 #include <iostream>
-#include <curl/curl.h>
 #include <thread>
 #include <chrono>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
-// Callback for libcurl to write response data into a std::string.
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    std::string* response = reinterpret_cast<std::string*>(userp);
-    size_t totalSize = size * nmemb;
-    response->append(reinterpret_cast<char*>(contents), totalSize);
-    return totalSize;
+// Auth traffic is rare, so one handle without background warming is enough.
+static HttpPoolOptions authPoolOptions(const HttpPoolOptions& base) {
+    HttpPoolOptions options = base;
+    options.size = 1;
+    options.warmOnStart = false;
+    options.warmInterval = std::chrono::seconds(0);
+    return options;
 }
 
-Authorization::Authorization(const std::string& clientId, const std::string& clientSecret)
-    : clientId(clientId), clientSecret(clientSecret), expiryTime(0) 
+Authorization::Authorization(const std::string& clientId, const std::string& clientSecret,
+                             const HttpPoolOptions& poolOptions)
+    : clientId(clientId), clientSecret(clientSecret), pool(authPoolOptions(poolOptions)),
+      authUrl(pool.getOptions().baseUrl + "/api/v2/public/auth"),
+      current(nullptr),
+      refreshes(0), failures(0), lastRefreshNs(0), running(true)
 {
 	initLogger();
-    std::lock_guard<std::mutex> lock(tokenMutex);
+    publish(std::make_unique<const AuthToken>());
     systemLogger->info("[Auth] performing authentication");
     if (!performAuthentication()) {
+        // The refresher keeps retrying; until then requests go out without a valid token.
         systemLogger->error("[Auth] Initial authentication failed.");
     }
+    refresher = std::thread(&Authorization::refreshLoop, this);
+}
+
+Authorization::~Authorization() {
+    {
+        std::lock_guard<std::mutex> lock(refreshMutex);
+        running.store(false);
+    }
+    refreshCv.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
 }
 
 std::string Authorization::httpPost(const std::string& url, const std::string& jsonPayload) {
-    CURL* curl = curl_easy_init();
     std::string response;
-    if(curl) {
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        headers = curl_slist_append(headers, "Accept: application/json");
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, jsonPayload.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-        
-        CURLcode res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            systemLogger->error("[Auth] curl_easy_perform() failed: {}", curl_easy_strerror(res));
-        } else {
-            long http_code = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-            systemLogger->info("[Auth] HTTP response code: {}", http_code);
-
-            // Handle non-200 status codes explicitly
-            if (http_code != 200) {
-                systemLogger->error("[Auth] HTTP error: {} | Response: {}", http_code, response);
-            }
-        }
+    long http_code = pool.post(url, jsonPayload, response);
+    if (http_code != 0) {
+        systemLogger->info("[Auth] HTTP response code: {}", http_code);
 
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        // Handle non-200 status codes explicitly
+        if (http_code != 200) {
+            systemLogger->error("[Auth] HTTP error: {} | Response: {}", http_code, response);
+        }
     }
-
-    
     return response;
 }
 
 
 bool Authorization::performAuthentication() {
-    std::string url = "https://test.deribit.com/api/v2/public/auth";
+    const std::string& url = authUrl;
     json payload = {
     {"jsonrpc", "2.0"},
     {"id", 1},
@@ -101,7 +97,7 @@ bool Authorization::performAuthentication() {
 
 bool Authorization::performTokenRefresh() {
 
-    std::string url = "https://test.deribit.com/api/v2/public/auth";
+    const std::string& url = authUrl;
     // Build the JSON payload for refresh_token grant.
     json payload = {
   	{"jsonrpc", "2.0"},
@@ -132,32 +128,77 @@ bool Authorization::performTokenRefresh() {
 }
 
 void Authorization::updateToken(const std::string& newToken, const std::string& newRefreshToken, int expiresIn) {
-    accessToken = newToken;
+    auto token = std::make_unique<AuthToken>();
+    token->accessToken = newToken;
+    token->bearerHeader = "Authorization: Bearer " + newToken;
+    token->expiryTime = std::time(nullptr) + expiresIn;
     refreshToken = newRefreshToken;
-    expiryTime = std::time(nullptr) + expiresIn;
+    // Renew 60 seconds ahead of expiry, or halfway through very short lifetimes.
+    refreshAt = std::chrono::system_clock::now() + std::chrono::seconds(expiresIn - std::min(60, expiresIn / 2));
+    publish(std::move(token));
 }
 
-std::string Authorization::getAccessToken() {
-    std::lock_guard<std::mutex> lock(tokenMutex);
-    time_t currentTime = std::time(nullptr);
-
-    // Refresh token proactively if it expires in less than 60 seconds.
-    if (currentTime >= (expiryTime - 60)) {
-        systemLogger->info("[Auth] Token nearing expiry or expired. Refreshing token...");
-        // Retry mechanism: try up to 3 times if refresh fails.
-        const int maxRetries = 3;
-        for (int attempt = 1; attempt <= maxRetries; ++attempt) {
-            if (performTokenRefresh()) {
-                break; 
-            } else {
-                systemLogger->info("[Auth] Token refresh attempt {}" ,attempt, " failed. Retrying in 5 seconds..." );
-                std::this_thread::sleep_for(std::chrono::seconds(5));
-            }
-        }
+// The oldest retired snapshot is freed once more than kRetainedTokens are kept.
+void Authorization::publish(std::unique_ptr<const AuthToken> token) {
+    current.store(token.get(), std::memory_order_release);
+    published.push_back(std::move(token));
+    if (published.size() > kRetainedTokens) {
+        published.pop_front();
     }
-    return accessToken;
 }
 
+std::string Authorization::getAccessToken() const {
+    return currentToken().accessToken;
+}
 
+AuthStats Authorization::stats() const {
+    AuthStats result;
+    result.refreshes = refreshes.load(std::memory_order_relaxed);
+    result.failures = failures.load(std::memory_order_relaxed);
+    result.lastRefreshNs = lastRefreshNs.load(std::memory_order_relaxed);
+    result.expiryTime = currentToken().expiryTime;
+    return result;
+}
 
+// ------------------ Background refresh ------------------ //
 
+bool Authorization::waitUntil(std::chrono::system_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(refreshMutex);
+    refreshCv.wait_until(lock, deadline, [this]() { return !running.load(); });
+    return running.load();
+}
+
+void Authorization::refreshLoop() {
+    const std::chrono::seconds maxRetryDelay(30);
+    std::chrono::seconds retryDelay(1);
+    int consecutiveFailures = 0;
+    while (waitUntil(refreshAt)) {
+        auto start = std::chrono::high_resolution_clock::now();
+        // A refresh token the server keeps rejecting will not start working; log in again instead.
+        bool refreshed = !refreshToken.empty() && consecutiveFailures < 2 ? performTokenRefresh()
+                                                                          : performAuthentication();
+        int64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        if (refreshed) {
+            recordLatency(LatencyProbe::TOKEN_REFRESH, elapsedNs);
+            lastRefreshNs.store(elapsedNs, std::memory_order_relaxed);
+            refreshes.fetch_add(1, std::memory_order_relaxed);
+            consecutiveFailures = 0;
+            retryDelay = std::chrono::seconds(1);
+            systemLogger->info("[Auth] Token refreshed in {} us, expires at {}", elapsedNs / 1000,
+                               currentToken().expiryTime);
+            continue;
+        }
+        failures.fetch_add(1, std::memory_order_relaxed);
+        ++consecutiveFailures;
+        if (std::time(nullptr) >= currentToken().expiryTime) {
+            systemLogger->error("[Auth] Access token expired and refresh attempt {} failed, retrying in {} s",
+                                consecutiveFailures, retryDelay.count());
+        } else {
+            systemLogger->warn("[Auth] Token refresh attempt {} failed, retrying in {} s",
+                               consecutiveFailures, retryDelay.count());
+        }
+        refreshAt = std::chrono::system_clock::now() + retryDelay;
+        retryDelay = std::min(retryDelay * 2, maxRetryDelay);
+    }
+}
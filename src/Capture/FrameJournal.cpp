@@ -0,0 +1,378 @@
+#include "FrameJournal.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kJournalMagic[8] = {'T', 'F', 'J', 'R', 'N', 'L', '0', '1'};
+static const char kIndexMagic[8] = {'T', 'F', 'J', 'I', 'D', 'X', '0', '1'};
+static const uint32_t kJournalVersion = 1;
+static const size_t kPageSize = 4096;
+
+// Header of a .idx file, followed by 'count' JournalIndexEntry records.
+struct JournalIndexHeader {
+    char magic[8];
+    uint64_t count;
+};
+
+static size_t paddedLength(size_t length) {
+    return (length + 7) & ~static_cast<size_t>(7);
+}
+
+static uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// ------------------ FrameJournal ------------------ //
+
+FrameJournal::FrameJournal(const FrameJournalOptions& options)
+    : options(options), nextIndexNs(0), frames(0), bytes(0), files(0), dropped(0),
+      running(true), closed(false), spareReady(false), nextSequence(1)
+{
+    initLogger();
+    if (mkdir(options.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        systemLogger->error("[FrameJournal] Cannot create {}: {}", options.directory, strerror(errno));
+    }
+    current = createFile(0);
+    files.store(1, std::memory_order_relaxed);
+    background = std::thread(&FrameJournal::backgroundLoop, this);
+    systemLogger->info("[FrameJournal] Capturing connection {} to {} ({} byte files)",
+                       options.connectionId, options.directory, options.fileSize);
+}
+
+FrameJournal::~FrameJournal() {
+    close();
+}
+
+FrameJournal::MappedFile FrameJournal::createFile(uint64_t sequence) {
+    MappedFile file;
+    char name[64];
+    snprintf(name, sizeof(name), "/frames-%04u.%06llu.jrn", options.connectionId,
+             static_cast<unsigned long long>(sequence));
+    file.path = options.directory + name;
+    file.sequence = sequence;
+
+    file.fd = open(file.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file.fd < 0) {
+        systemLogger->error("[FrameJournal] Cannot open {}: {}", file.path, strerror(errno));
+        return file;
+    }
+    if (ftruncate(file.fd, static_cast<off_t>(options.fileSize)) != 0) {
+        systemLogger->error("[FrameJournal] Cannot size {}: {}", file.path, strerror(errno));
+        ::close(file.fd);
+        file.fd = -1;
+        return file;
+    }
+    void* base = mmap(nullptr, options.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+    if (base == MAP_FAILED) {
+        systemLogger->error("[FrameJournal] Cannot map {}: {}", file.path, strerror(errno));
+        ::close(file.fd);
+        file.fd = -1;
+        return file;
+    }
+    file.base = static_cast<char*>(base);
+    file.size = options.fileSize;
+
+    // Take the page faults here rather than on the I/O thread.
+    if (options.prefault) {
+        for (size_t offset = 0; offset < file.size; offset += kPageSize) {
+            static_cast<volatile char*>(file.base)[offset] = 0;
+        }
+    }
+
+    JournalFileHeader header{};
+    std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    header.connectionId = options.connectionId;
+    header.sequence = sequence;
+    header.createdNs = wallClockNs();
+    std::memcpy(file.base, &header, sizeof(header));
+    file.used = sizeof(header);
+    file.index.reserve(4096);
+    return file;
+}
+
+void FrameJournal::append(uint64_t receivedNs, const char* data, size_t length) {
+    size_t needed = sizeof(FrameRecordHeader) + paddedLength(length);
+    if (sizeof(JournalFileHeader) + needed > options.fileSize) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    if (current.used + needed > current.size) {
+        rollover();
+    }
+    if (!current.base) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    FrameRecordHeader record;
+    record.length = static_cast<uint32_t>(length);
+    record.connectionId = options.connectionId;
+    record.receivedNs = receivedNs;
+    char* out = current.base + current.used;
+    std::memcpy(out, &record, sizeof(record));
+    std::memcpy(out + sizeof(record), data, length);
+
+    if (receivedNs >= nextIndexNs) {
+        current.index.push_back(JournalIndexEntry{receivedNs, current.used});
+        nextIndexNs = receivedNs + options.indexIntervalNs;
+    }
+    if (current.frames == 0) {
+        current.firstNs = receivedNs;
+    }
+    current.lastNs = receivedNs;
+    ++current.frames;
+    current.used += needed;
+
+    frames.store(frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    bytes.store(bytes.load(std::memory_order_relaxed) + needed, std::memory_order_relaxed);
+}
+
+// Swap in the file the background thread has prepared. Only waits if files
+// are filling faster than they can be created.
+void FrameJournal::rollover() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.push_back(std::move(current));
+        cv.notify_all();
+        cv.wait(lock, [this]() { return spareReady; });
+        current = std::move(spare);
+        spare = MappedFile();
+        spareReady = false;
+    }
+    cv.notify_all();
+    nextIndexNs = 0;
+    files.store(files.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Record the final extent in the header, trim the file and write its index.
+void FrameJournal::finishFile(MappedFile& file) {
+    if (!file.base) {
+        return;
+    }
+    JournalFileHeader* header = reinterpret_cast<JournalFileHeader*>(file.base);
+    header->firstNs = file.firstNs;
+    header->lastNs = file.lastNs;
+    header->dataEnd = file.used;
+    header->frameCount = file.frames;
+    munmap(file.base, file.size);
+    if (ftruncate(file.fd, static_cast<off_t>(file.used)) != 0) {
+        systemLogger->error("[FrameJournal] Cannot trim {}: {}", file.path, strerror(errno));
+    }
+    ::close(file.fd);
+    file.base = nullptr;
+    file.fd = -1;
+
+    std::string indexPath = indexPathFor(file.path);
+    FILE* out = fopen(indexPath.c_str(), "wb");
+    if (!out) {
+        systemLogger->error("[FrameJournal] Cannot write index {}", indexPath);
+        return;
+    }
+    JournalIndexHeader indexHeader;
+    std::memcpy(indexHeader.magic, kIndexMagic, sizeof(indexHeader.magic));
+    indexHeader.count = file.index.size();
+    fwrite(&indexHeader, sizeof(indexHeader), 1, out);
+    if (!file.index.empty()) {
+        fwrite(file.index.data(), sizeof(JournalIndexEntry), file.index.size(), out);
+    }
+    fclose(out);
+    systemLogger->info("[FrameJournal] Closed {} ({} frames, {} bytes)", file.path, file.frames, file.used);
+}
+
+void FrameJournal::backgroundLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running || !finished.empty()) {
+        if (!finished.empty()) {
+            MappedFile file = std::move(finished.front());
+            finished.pop_front();
+            lock.unlock();
+            finishFile(file);
+            lock.lock();
+            continue;
+        }
+        if (running && !spareReady) {
+            uint64_t sequence = nextSequence++;
+            lock.unlock();
+            MappedFile file = createFile(sequence);
+            lock.lock();
+            spare = std::move(file);
+            spareReady = true;
+            cv.notify_all();
+            continue;
+        }
+        cv.wait(lock);
+    }
+}
+
+void FrameJournal::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) {
+            return;
+        }
+        closed = true;
+        running = false;
+        finished.push_back(std::move(current));
+        current = MappedFile();
+    }
+    cv.notify_all();
+    if (background.joinable()) {
+        background.join();
+    }
+    // The prepared spare never received a frame.
+    if (spareReady && spare.base) {
+        munmap(spare.base, spare.size);
+        ::close(spare.fd);
+        unlink(spare.path.c_str());
+        spareReady = false;
+    }
+    FrameJournalStats s = stats();
+    systemLogger->info("[FrameJournal] Stopped: {} frames, {} bytes, {} files, {} dropped",
+                       s.frames, s.bytes, s.files, s.dropped);
+}
+
+FrameJournalStats FrameJournal::stats() const {
+    FrameJournalStats s;
+    s.frames = frames.load(std::memory_order_relaxed);
+    s.bytes = bytes.load(std::memory_order_relaxed);
+    s.files = files.load(std::memory_order_relaxed);
+    s.dropped = dropped.load(std::memory_order_relaxed);
+    return s;
+}
+
+std::vector<std::string> FrameJournal::listFiles(const std::string& directory) {
+    std::vector<std::string> paths;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return paths;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 7, "frames-") == 0 &&
+            name.compare(name.size() - 4, 4, ".jrn") == 0) {
+            paths.push_back(directory + "/" + name);
+        }
+    }
+    closedir(dir);
+    // Names are zero padded, so lexical order is connection id then sequence.
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+std::string FrameJournal::indexPathFor(const std::string& journalPath) {
+    std::string path = journalPath;
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".jrn") == 0) {
+        path.resize(path.size() - 4);
+    }
+    return path + ".idx";
+}
+
+// ------------------ FrameJournalReader ------------------ //
+
+FrameJournalReader::FrameJournalReader(const std::string& path)
+    : path(path), fd(-1), base(nullptr), size(0), end(0), offset(sizeof(JournalFileHeader))
+{
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(JournalFileHeader)) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    base = static_cast<const char*>(mapped);
+    if (std::memcmp(header().magic, kJournalMagic, sizeof(kJournalMagic)) != 0) {
+        munmap(const_cast<char*>(base), size);
+        ::close(fd);
+        fd = -1;
+        base = nullptr;
+        return;
+    }
+    // Files that were not closed cleanly have no dataEnd; read up to the first empty record.
+    end = header().dataEnd != 0 && header().dataEnd <= size ? header().dataEnd : size;
+}
+
+FrameJournalReader::~FrameJournalReader() {
+    if (base) {
+        munmap(const_cast<char*>(base), size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool FrameJournalReader::next(JournalFrame& frame) {
+    if (!base || offset + sizeof(FrameRecordHeader) > end) {
+        return false;
+    }
+    FrameRecordHeader record;
+    std::memcpy(&record, base + offset, sizeof(record));
+    if (record.length == 0 || offset + sizeof(record) + record.length > end) {
+        return false;
+    }
+    frame.receivedNs = record.receivedNs;
+    frame.connectionId = record.connectionId;
+    frame.data = base + offset + sizeof(record);
+    frame.length = record.length;
+    offset += sizeof(record) + paddedLength(record.length);
+    return true;
+}
+
+void FrameJournalReader::rewind() {
+    offset = sizeof(JournalFileHeader);
+}
+
+void FrameJournalReader::seek(uint64_t timestampNs) {
+    rewind();
+    if (!base) {
+        return;
+    }
+    // Jump to the last indexed frame at or before the target.
+    FILE* in = fopen(FrameJournal::indexPathFor(path).c_str(), "rb");
+    if (in) {
+        JournalIndexHeader indexHeader;
+        if (fread(&indexHeader, sizeof(indexHeader), 1, in) == 1 &&
+            std::memcmp(indexHeader.magic, kIndexMagic, sizeof(kIndexMagic)) == 0) {
+            std::vector<JournalIndexEntry> entries(indexHeader.count);
+            if (!entries.empty() &&
+                fread(entries.data(), sizeof(JournalIndexEntry), entries.size(), in) == entries.size()) {
+                auto it = std::upper_bound(entries.begin(), entries.end(), timestampNs,
+                                           [](uint64_t ts, const JournalIndexEntry& e) { return ts < e.receivedNs; });
+                if (it != entries.begin() && std::prev(it)->offset < end) {
+                    offset = std::prev(it)->offset;
+                }
+            }
+        }
+        fclose(in);
+    }
+    // Then walk forward to the first frame at or after it.
+    JournalFrame frame;
+    size_t position = offset;
+    while (next(frame)) {
+        if (frame.receivedNs >= timestampNs) {
+            offset = position;
+            return;
+        }
+        position = offset;
+    }
+}
@@ -0,0 +1,131 @@
+#include "InstrumentRegistry.h"
+
+static const char* kChannelPrefixes[kChannelKinds] = {
+    "book.",
+    "ticker.",
+    "trades.",
+    "user.orders.",
+    "user.trades."
+};
+
+// Slot words: id in bits 0-15, kind in 16-23, an occupied bit, and the
+// upper half of the key's hash so most mismatches skip the string compare.
+static const uint64_t kOccupied = uint64_t(1) << 24;
+
+static size_t tableSize(size_t keys) {
+    size_t size = 16;
+    while (size < keys * 2) {
+        size *= 2;
+    }
+    return size;
+}
+
+InstrumentRegistry::Table::Table(size_t capacity) : mask(capacity - 1), slots(new std::atomic<uint64_t>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void InstrumentRegistry::Table::insert(uint64_t hash, ChannelKey value) {
+    size_t index = hash & mask;
+    while (slots[index].load(std::memory_order_relaxed) != 0) {
+        index = (index + 1) & mask;
+    }
+    uint64_t word = (hash & 0xFFFFFFFF00000000ull) | kOccupied |
+                    (static_cast<uint64_t>(value.kind) << 16) | value.instrument;
+    slots[index].store(word, std::memory_order_release);
+}
+
+// Probes until the key or an empty slot. Slots are only ever filled, so a
+// concurrent insert can at worst make a lookup miss a key still being added.
+template <typename KeyOf>
+ChannelKey InstrumentRegistry::Table::lookup(std::string_view key, uint64_t hash, const KeyOf& keyOf) const {
+    uint64_t tag = hash & 0xFFFFFFFF00000000ull;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        uint64_t word = slots[index].load(std::memory_order_acquire);
+        if (word == 0) {
+            return ChannelKey{ChannelKind::UNKNOWN, kNoInstrument};
+        }
+        if ((word & 0xFFFFFFFF00000000ull) != tag) {
+            continue;
+        }
+        ChannelKey value{static_cast<ChannelKind>((word >> 16) & 0xFF), static_cast<InstrumentId>(word & 0xFFFF)};
+        if (keyOf(value) == key) {
+            return value;
+        }
+    }
+}
+
+InstrumentRegistry::InstrumentRegistry()
+    : entries(new Entry[kMaxInstruments]), count(0), instrumentTable(tableSize(kMaxInstruments)),
+      channelTable(tableSize(kMaxInstruments * kChannelKinds))
+{
+}
+
+InstrumentRegistry::~InstrumentRegistry() = default;
+
+InstrumentId InstrumentRegistry::intern(std::string_view instrument) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return add(instrument);
+}
+
+std::vector<InstrumentId> InstrumentRegistry::intern(const std::vector<std::string>& instruments) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::vector<InstrumentId> ids;
+    ids.reserve(instruments.size());
+    for (const auto& instrument : instruments) {
+        ids.push_back(add(instrument));
+    }
+    return ids;
+}
+
+InstrumentId InstrumentRegistry::find(std::string_view instrument) const {
+    return instrumentTable.lookup(instrument, hash(instrument), [this](ChannelKey key) -> const std::string& {
+        return entries[key.instrument].name;
+    }).instrument;
+}
+
+ChannelKey InstrumentRegistry::resolveChannel(std::string_view channel) const {
+    return channelTable.lookup(channel, hash(channel), [this](ChannelKey key) -> const std::string& {
+        return entries[key.instrument].channels[static_cast<size_t>(key.kind)];
+    });
+}
+
+// Caller holds writeMutex. Fills the entry before inserting its keys and
+// publishing the new count.
+InstrumentId InstrumentRegistry::add(std::string_view instrument) {
+    uint64_t h = hash(instrument);
+    InstrumentId existing = instrumentTable.lookup(instrument, h, [this](ChannelKey key) -> const std::string& {
+        return entries[key.instrument].name;
+    }).instrument;
+    if (existing != kNoInstrument) {
+        return existing;
+    }
+    size_t n = count.load(std::memory_order_relaxed);
+    if (n == kMaxInstruments) {
+        return kNoInstrument;
+    }
+    InstrumentId id = static_cast<InstrumentId>(n);
+    Entry& entry = entries[n];
+    entry.name.assign(instrument.data(), instrument.size());
+    for (size_t kind = 0; kind < kChannelKinds; ++kind) {
+        entry.channels[kind] = kChannelPrefixes[kind] + entry.name + ".raw";
+        channelTable.insert(hash(entry.channels[kind]), ChannelKey{static_cast<ChannelKind>(kind), id});
+    }
+    instrumentTable.insert(h, ChannelKey{ChannelKind::UNKNOWN, id});
+    count.store(n + 1, std::memory_order_release);
+    return id;
+}
+
+// FNV-1a with a final avalanche so both the low (slot) and high (tag) bits mix well.
+uint64_t InstrumentRegistry::hash(std::string_view key) {
+    uint64_t h = 14695981039346656037ull;
+    for (char ch : key) {
+        h ^= static_cast<unsigned char>(ch);
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,265 @@
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ------------------ LatencyHistogram ------------------ //
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < kLinearBuckets) {
+        return bucket;
+    }
+    size_t k = bucket - kLinearBuckets;
+    int shift = static_cast<int>(k / kSubBuckets) + 1;
+    uint64_t sub = k % kSubBuckets + kSubBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    ++counts[bucketFor(value)];
+    ++total;
+    if (value > maxValue) {
+        maxValue = value;
+    }
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    if (other.maxValue > maxValue) {
+        maxValue = other.maxValue;
+    }
+}
+
+// Removes an earlier snapshot of the same histogram. The max can not be
+// un-merged, so it is recomputed from the highest remaining bucket.
+void LatencyHistogram::subtract(const LatencyHistogram& other) {
+    total = 0;
+    size_t highest = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] -= other.counts[i];
+        total += counts[i];
+        if (counts[i]) {
+            highest = i;
+        }
+    }
+    if (total == 0) {
+        maxValue = 0;
+    } else if (bucketUpperBound(highest) < maxValue) {
+        maxValue = bucketUpperBound(highest);
+    }
+}
+
+void LatencyHistogram::reset() {
+    std::memset(counts, 0, sizeof(counts));
+    total = 0;
+    maxValue = 0;
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            uint64_t upper = bucketUpperBound(i);
+            return upper < maxValue ? upper : maxValue;
+        }
+    }
+    return maxValue;
+}
+
+// ------------------ Per-thread recording ------------------ //
+
+// Histograms owned by one recording thread. Only that thread writes, so
+// updates are plain relaxed load/store pairs without any read-modify-write.
+struct ThreadLatency {
+    std::atomic<uint64_t> counts[static_cast<size_t>(LatencyProbe::COUNT)][LatencyHistogram::kBucketCount];
+    std::atomic<uint64_t> maxValue[static_cast<size_t>(LatencyProbe::COUNT)];
+
+    ThreadLatency() {
+        for (auto& probe : counts) {
+            for (auto& c : probe) {
+                c.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (auto& m : maxValue) {
+            m.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+class LatencyRegistry {
+public:
+    static LatencyRegistry& instance() {
+        static LatencyRegistry registry;
+        return registry;
+    }
+
+    // Entries of exited threads are reused before new ones are made, so
+    // short-lived threads do not grow the registry. A reused entry keeps its
+    // counts; merge() cannot tell which thread recorded them.
+    ThreadLatency* registerThread() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (!released.empty()) {
+            ThreadLatency* reused = released.back();
+            released.pop_back();
+            return reused;
+        }
+        threads.push_back(std::make_unique<ThreadLatency>());
+        return threads.back().get();
+    }
+
+    void releaseThread(ThreadLatency* latency) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        released.push_back(latency);
+    }
+
+    LatencyHistogram merge(LatencyProbe probe) {
+        size_t p = static_cast<size_t>(probe);
+        LatencyHistogram merged;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& t : threads) {
+            for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+                uint64_t c = t->counts[p][i].load(std::memory_order_relaxed);
+                merged.counts[i] += c;
+                merged.total += c;
+            }
+            uint64_t m = t->maxValue[p].load(std::memory_order_relaxed);
+            if (m > merged.maxValue) {
+                merged.maxValue = m;
+            }
+        }
+        return merged;
+    }
+
+    std::mutex reporterMutex;
+    std::condition_variable reporterCv;
+    bool reporterRunning = false;
+    std::thread reporter;
+    // Guarded by reporterMutex, which the reporter holds while it reports.
+    std::vector<std::pair<uint64_t, std::function<void(const char*)>>> reportHooks;
+    uint64_t nextHookId = 1;
+
+private:
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadLatency>> threads;
+    std::vector<ThreadLatency*> released; // owned by 'threads', no recording thread
+};
+
+// A recording thread's entry, handed back to the registry when the thread exits.
+struct ThreadLatencyLease {
+    ThreadLatency* latency = LatencyRegistry::instance().registerThread();
+    ~ThreadLatencyLease() { LatencyRegistry::instance().releaseThread(latency); }
+};
+
+void recordLatency(LatencyProbe probe, int64_t nanoseconds) {
+    thread_local ThreadLatencyLease lease;
+    ThreadLatency* local = lease.latency;
+    uint64_t value = nanoseconds < 0 ? 0 : static_cast<uint64_t>(nanoseconds);
+    size_t p = static_cast<size_t>(probe);
+    std::atomic<uint64_t>& bucket = local->counts[p][LatencyHistogram::bucketFor(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (value > local->maxValue[p].load(std::memory_order_relaxed)) {
+        local->maxValue[p].store(value, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram latencySnapshot(LatencyProbe probe) {
+    return LatencyRegistry::instance().merge(probe);
+}
+
+// ------------------ Reporting ------------------ //
+
+static void reportHistogram(const char* label, LatencyProbe probe, const LatencyHistogram& h) {
+    if (h.count() == 0) {
+        return;
+    }
+    latencyLogger->info("[Latency] {} {} count={} p50={:.2f}us p90={:.2f}us p99={:.2f}us p99.9={:.2f}us max={:.2f}us",
+                        label, latencyProbeName(probe), h.count(),
+                        h.valueAtPercentile(50.0) / 1000.0,
+                        h.valueAtPercentile(90.0) / 1000.0,
+                        h.valueAtPercentile(99.0) / 1000.0,
+                        h.valueAtPercentile(99.9) / 1000.0,
+                        h.max() / 1000.0);
+}
+
+void startLatencyReporter(std::chrono::seconds interval) {
+    LatencyRegistry& registry = LatencyRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.reporterMutex);
+    if (registry.reporterRunning) {
+        return;
+    }
+    registry.reporterRunning = true;
+    registry.reporter = std::thread([interval, &registry]() {
+        constexpr size_t probeCount = static_cast<size_t>(LatencyProbe::COUNT);
+        std::vector<LatencyHistogram> previous(probeCount);
+        std::unique_lock<std::mutex> lock(registry.reporterMutex);
+        while (registry.reporterRunning) {
+            registry.reporterCv.wait_for(lock, interval, [&registry]() { return !registry.reporterRunning; });
+            for (size_t p = 0; p < probeCount; ++p) {
+                LatencyProbe probe = static_cast<LatencyProbe>(p);
+                LatencyHistogram current = registry.merge(probe);
+                LatencyHistogram window = current;
+                window.subtract(previous[p]);
+                previous[p] = current;
+                reportHistogram(registry.reporterRunning ? "interval" : "final-interval", probe, window);
+            }
+            for (const auto& hook : registry.reportHooks) {
+                hook.second(registry.reporterRunning ? "interval" : "final-interval");
+            }
+        }
+    });
+}
+
+void stopLatencyReporter() {
+    LatencyRegistry& registry = LatencyRegistry::instance();
+    {
+        std::lock_guard<std::mutex> lock(registry.reporterMutex);
+        if (!registry.reporterRunning) {
+            return;
+        }
+        registry.reporterRunning = false;
+    }
+    registry.reporterCv.notify_all();
+    if (registry.reporter.joinable()) {
+        registry.reporter.join();
+    }
+    for (size_t p = 0; p < static_cast<size_t>(LatencyProbe::COUNT); ++p) {
+        LatencyProbe probe = static_cast<LatencyProbe>(p);
+        reportHistogram("session", probe, registry.merge(probe));
+    }
+}
+
+LatencyReportHook::LatencyReportHook(std::function<void(const char* label)> report) {
+    LatencyRegistry& registry = LatencyRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.reporterMutex);
+    id = registry.nextHookId++;
+    registry.reportHooks.emplace_back(id, std::move(report));
+}
+
+// Waits out a report in progress, so the hook never runs after this returns.
+LatencyReportHook::~LatencyReportHook() {
+    LatencyRegistry& registry = LatencyRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.reporterMutex);
+    auto& hooks = registry.reportHooks;
+    hooks.erase(std::remove_if(hooks.begin(), hooks.end(), [this](const auto& hook) { return hook.first == id; }),
+                hooks.end());
+}
@@ -0,0 +1,205 @@
+#include "BinaryLog.h"
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+static uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static size_t roundUpPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+BinaryLog::BinaryLog(const std::string& path, size_t queueCapacity, size_t maxFileSize, size_t maxFiles)
+    : path(path), maxFileSize(maxFileSize), maxFiles(maxFiles), enqueuePos(0), dequeuePos(0),
+      running(true), dropped(0), written(0), file(nullptr), fileSize(0)
+{
+    size_t capacity = roundUpPowerOfTwo(queueCapacity);
+    cells.reset(new Cell[capacity]);
+    mask = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    openFile();
+    writer = std::thread(&BinaryLog::writerLoop, this);
+}
+
+BinaryLog::~BinaryLog() {
+    stop();
+}
+
+void BinaryLog::setTag(BinaryRecord& record, const char* text, size_t length) {
+    size_t n = length < sizeof(record.tag) ? length : sizeof(record.tag);
+    std::memcpy(record.tag, text, n);
+    if (n < sizeof(record.tag)) {
+        std::memset(record.tag + n, 0, sizeof(record.tag) - n);
+    }
+}
+
+// ------------------ Producer side ------------------ //
+
+bool BinaryLog::log(const BinaryRecord& record) {
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells[pos & mask];
+        uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->record = record;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void BinaryLog::logBookDelta(const char* instrument, size_t instrumentLength, int64_t changeId, int64_t timestamp,
+                             size_t bidCount, size_t askCount, double bestBid, double bestAsk) {
+    BinaryRecord r{};
+    r.timestampNs = wallClockNs();
+    r.type = static_cast<uint16_t>(BinaryRecordType::BOOK_DELTA);
+    r.value32 = static_cast<uint32_t>((bidCount & 0xFFFF) << 16 | (askCount & 0xFFFF));
+    r.a = changeId;
+    r.b = timestamp;
+    r.x = bestBid;
+    r.y = bestAsk;
+    setTag(r, instrument, instrumentLength);
+    log(r);
+}
+
+void BinaryLog::logOrderAck(const std::string& orderId, OrderAckStatus status, int64_t roundTripNs, double amount, double price) {
+    BinaryRecord r{};
+    r.timestampNs = wallClockNs();
+    r.type = static_cast<uint16_t>(BinaryRecordType::ORDER_ACK);
+    r.value32 = static_cast<uint32_t>(status);
+    r.a = roundTripNs;
+    r.x = amount;
+    r.y = price;
+    setTag(r, orderId.data(), orderId.size());
+    log(r);
+}
+
+// ------------------ Writer side ------------------ //
+
+bool BinaryLog::dequeue(BinaryRecord& record) {
+    Cell* cell = &cells[dequeuePos & mask];
+    uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (seq != dequeuePos + 1) {
+        return false;
+    }
+    record = cell->record;
+    cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    ++dequeuePos;
+    return true;
+}
+
+void BinaryLog::writerLoop() {
+    std::vector<BinaryRecord> batch(1024);
+    for (;;) {
+        bool stopping = !running.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (n < batch.size() && dequeue(batch[n])) {
+            ++n;
+        }
+        if (n > 0 && file) {
+            size_t bytes = n * sizeof(BinaryRecord);
+            if (fileSize + bytes > maxFileSize) {
+                rotate();
+            }
+            if (file) {
+                fwrite(batch.data(), sizeof(BinaryRecord), n, file);
+                fileSize += bytes;
+                written.fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+        if (n == batch.size()) {
+            continue;
+        }
+        if (file) {
+            fflush(file);
+        }
+        if (stopping) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void BinaryLog::openFile() {
+    file = fopen(path.c_str(), "wb");
+    fileSize = 0;
+    if (!file) {
+        return;
+    }
+    BinaryLogHeader header{};
+    std::memcpy(header.magic, "TBLOG001", sizeof(header.magic));
+    header.recordSize = sizeof(BinaryRecord);
+    fwrite(&header, sizeof(header), 1, file);
+    fileSize = sizeof(header);
+}
+
+// Same scheme as spdlog's rotating sink: file -> file.1 -> file.2 ... up to maxFiles.
+void BinaryLog::rotate() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    for (size_t i = maxFiles; i > 0; --i) {
+        std::string src = (i == 1) ? path : path + "." + std::to_string(i - 1);
+        std::string dst = path + "." + std::to_string(i);
+        std::remove(dst.c_str());
+        std::rename(src.c_str(), dst.c_str());
+    }
+    openFile();
+}
+
+void BinaryLog::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+// ------------------ Decoding ------------------ //
+
+std::string BinaryLog::format(const BinaryRecord& record) {
+    std::ostringstream out;
+    std::string tag(record.tag, strnlen(record.tag, sizeof(record.tag)));
+    out << record.timestampNs << ' ';
+    switch (static_cast<BinaryRecordType>(record.type)) {
+        case BinaryRecordType::BOOK_DELTA:
+            out << "BOOK " << tag << " change_id=" << record.a << " ts=" << record.b
+                << " bids=" << (record.value32 >> 16) << " asks=" << (record.value32 & 0xFFFF)
+                << std::setprecision(10) << " best_bid=" << record.x << " best_ask=" << record.y;
+            break;
+        case BinaryRecordType::ORDER_ACK:
+            out << "ORDER_ACK " << tag << " status=" << record.value32 << " rtt_ns=" << record.a
+                << std::setprecision(10) << " amount=" << record.x << " price=" << record.y;
+            break;
+        default:
+            out << "UNKNOWN type=" << record.type;
+            break;
+    }
+    return out.str();
+}
@@ -8,45 +8,51 @@ std::shared_ptr<spdlog::logger> orderbook;
 std::shared_ptr<spdlog::logger> markettrade;
 std::shared_ptr<spdlog::logger> positions;
 std::shared_ptr<spdlog::logger> dump;
+std::shared_ptr<BinaryLog> binaryLogger;
+
+// Async queue shared by all text loggers (entries, preallocated by spdlog).
+static const size_t kLogQueueSize = 32768;
+// Rotation limits for each text log file.
+static const size_t kMaxLogFileSize = 50 * 1024 * 1024;
+static const size_t kMaxLogFiles = 3;
+
+// Market data and latency loggers sit on the receive path, so they drop the
+// oldest queued entry instead of blocking when the queue is full.
+static std::shared_ptr<spdlog::logger> hotPathLogger(const std::string& name, const std::string& file) {
+	auto logger = spdlog::get(name);
+	if (!logger) {
+		logger = spdlog::rotating_logger_mt<spdlog::async_factory_nonblock>(name, file, kMaxLogFileSize, kMaxLogFiles, true);
+	}
+	return logger;
+}
+
+static std::shared_ptr<spdlog::logger> eventLogger(const std::string& name, const std::string& file) {
+	auto logger = spdlog::get(name);
+	if (!logger) {
+		logger = spdlog::rotating_logger_mt<spdlog::async_factory>(name, file, kMaxLogFileSize, kMaxLogFiles, true);
+	}
+	return logger;
+}
 
 
 void initLogger(){
 //initialise all the loggers.
 	try{
-		systemLogger=spdlog::get("system_logger");
-		if(!systemLogger){
-			systemLogger=spdlog::basic_logger_mt("system_logger","logs/system.log",true);
-			
-		}
-		
-		orderLogger=spdlog::get("order_logger");
-		if(!orderLogger){
-			orderLogger=spdlog::basic_logger_mt("order_logger","logs/orders.log",true);
-		}
-		
-		latencyLogger=spdlog::get("latency_logger");
-		if(!latencyLogger){
-			latencyLogger=spdlog::basic_logger_mt("latency_logger","logs/latency.log",true);
-		}
-			
-		orderbook=spdlog::get("orderbook");
-		if(!orderbook){
-			orderbook=spdlog::basic_logger_mt("orderbook","logs/orderbook.log",true);
+		if(!spdlog::thread_pool()){
+			spdlog::init_thread_pool(kLogQueueSize, 1);
 		}
-		
-		markettrade=spdlog::get("market_trade");
-		if(!markettrade){
-			markettrade=spdlog::basic_logger_mt("market_trade","logs/markettrade.log",true);
-		}
-		
-		positions=spdlog::get("positions");
-		if(!positions){
-			positions=spdlog::basic_logger_mt("positions","logs/positions.log",true);
-		}
-		
-		dump=spdlog::get("dump");
-		if(!dump){
-			dump=spdlog::basic_logger_mt("dump","logs/dump.log",true);
+
+		systemLogger=eventLogger("system_logger","logs/system.log");
+		orderLogger=eventLogger("order_logger","logs/orders.log");
+		positions=eventLogger("positions","logs/positions.log");
+
+		latencyLogger=hotPathLogger("latency_logger","logs/latency.log");
+		orderbook=hotPathLogger("orderbook","logs/orderbook.log");
+		markettrade=hotPathLogger("market_trade","logs/markettrade.log");
+		dump=hotPathLogger("dump","logs/dump.log");
+
+		if(!binaryLogger){
+			binaryLogger=std::make_shared<BinaryLog>("logs/events.bin");
 		}
 		
 		spdlog::flush_every(std::chrono::seconds(1));
@@ -59,3 +65,13 @@ void initLogger(){
 
 
 }
+
+void shutdownLogger(){
+	if(binaryLogger){
+		binaryLogger->stop();
+		if(binaryLogger->droppedRecords() > 0 && systemLogger){
+			systemLogger->warn("Binary log dropped {} records (queue full)", binaryLogger->droppedRecords());
+		}
+	}
+	spdlog::shutdown();
+}
@@ -0,0 +1,166 @@
+#include "ConflatedSubscriber.h"
+#include "MarketDataManager.h"
+#include "WebsocketClient.h"
+
+ConflatedSubscriber::ConflatedSubscriber(ChannelDispatcher& channels, TickerSource source,
+                                         const ConflationOptions& options)
+    : tickerSource(std::move(source)),
+      pending(new std::atomic<uint32_t>[kConflatedKinds * kMaxInstruments]),
+      books(new std::atomic<const OrderBook*>[kMaxInstruments]) {
+    for (Kind& kind : kinds) {
+        for (auto& word : kind.dirty) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (size_t i = 0; i < kConflatedKinds * kMaxInstruments; ++i) {
+        pending[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kMaxInstruments; ++i) {
+        books[i].store(nullptr, std::memory_order_relaxed);
+    }
+    for (size_t k = 0; k < kConflatedKinds; ++k) {
+        delivered[k].store(0, std::memory_order_relaxed);
+        conflated[k].store(0, std::memory_order_relaxed);
+    }
+    attach(channels, options);
+}
+
+ConflatedSubscriber::ConflatedSubscriber(WebsocketClient& client, const ConflationOptions& options)
+    : ConflatedSubscriber(client.channels(),
+                          [&client](InstrumentId instrument, TickerSnapshot& out) {
+                              return client.tickers().load(instrument, out);
+                          },
+                          options) {}
+
+ConflatedSubscriber::ConflatedSubscriber(MarketDataManager& manager, const ConflationOptions& options)
+    : ConflatedSubscriber(manager.channels(),
+                          [&manager](InstrumentId instrument, TickerSnapshot& out) {
+                              return manager.ticker(instrument, out);
+                          },
+                          options) {}
+
+void ConflatedSubscriber::attach(ChannelDispatcher& channels, const ConflationOptions& options) {
+    std::vector<InstrumentId> instruments = options.instruments;
+    if (instruments.empty()) {
+        instruments.push_back(kNoInstrument);
+    }
+    for (InstrumentId instrument : instruments) {
+        if (options.books) {
+            channels.onBook(instrument, [this](const BookEvent& event) { markBook(event.instrument, event.book); });
+        }
+        if (options.tickers) {
+            // The client stores a ticker before dispatching it, so the flag never runs ahead of the store.
+            channels.onTicker(instrument, [this](const ChannelDataEvent& event) { markTicker(event.instrument); });
+        }
+    }
+}
+
+// ------------------ Writer ------------------ //
+
+void ConflatedSubscriber::markBook(InstrumentId instrument, const OrderBook& book) {
+    if (instrument >= kMaxInstruments) {
+        return;
+    }
+    if (books[instrument].load(std::memory_order_relaxed) != &book) {
+        books[instrument].store(&book, std::memory_order_release);
+    }
+    mark(ConflatedKind::BOOK, instrument);
+}
+
+void ConflatedSubscriber::markTicker(InstrumentId instrument) {
+    if (instrument < kMaxInstruments) {
+        mark(ConflatedKind::TICKER, instrument);
+    }
+}
+
+// The first notification since the last take() raises the dirty bit; later
+// ones only count. The release pairs with the reader's acquire, so the state
+// it loads afterwards includes this update.
+void ConflatedSubscriber::mark(ConflatedKind kind, InstrumentId instrument) {
+    size_t k = static_cast<size_t>(kind);
+    kinds[k].updates.fetch_add(1, std::memory_order_relaxed);
+    if (pending[k * kMaxInstruments + instrument].fetch_add(1, std::memory_order_acq_rel) == 0) {
+        kinds[k].dirty[instrument / kWordBits].fetch_or(uint64_t(1) << (instrument % kWordBits),
+                                                        std::memory_order_release);
+    }
+}
+
+// ------------------ Reader ------------------ //
+
+// Taken after the dirty bit was cleared: a notification racing with the poll
+// either lands in this count or raises the bit again for the next poll.
+uint32_t ConflatedSubscriber::take(ConflatedKind kind, InstrumentId instrument) {
+    size_t k = static_cast<size_t>(kind);
+    uint32_t count = pending[k * kMaxInstruments + instrument].exchange(0, std::memory_order_acq_rel);
+    if (count > 0) {
+        delivered[k].fetch_add(1, std::memory_order_relaxed);
+        conflated[k].fetch_add(count - 1, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+size_t ConflatedSubscriber::poll(const Reader& reader) {
+    Kind& bookKind = kinds[static_cast<size_t>(ConflatedKind::BOOK)];
+    Kind& tickerKind = kinds[static_cast<size_t>(ConflatedKind::TICKER)];
+    size_t count = 0;
+    ConflatedUpdate update;
+    for (size_t w = 0; w < kWords; ++w) {
+        uint64_t bookBits = bookKind.dirty[w].load(std::memory_order_relaxed) != 0
+                                ? bookKind.dirty[w].exchange(0, std::memory_order_acquire) : 0;
+        uint64_t tickerBits = tickerKind.dirty[w].load(std::memory_order_relaxed) != 0
+                                  ? tickerKind.dirty[w].exchange(0, std::memory_order_acquire) : 0;
+        uint64_t bits = bookBits | tickerBits;
+        while (bits) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctzll(bits));
+            bits &= bits - 1;
+            InstrumentId instrument = static_cast<InstrumentId>(w * kWordBits + bit);
+            update.instrument = instrument;
+            update.bookUpdates = (bookBits >> bit) & 1 ? take(ConflatedKind::BOOK, instrument) : 0;
+            update.tickerUpdates = (tickerBits >> bit) & 1 ? take(ConflatedKind::TICKER, instrument) : 0;
+            update.book = nullptr;
+            if (update.bookUpdates > 0) {
+                update.book = books[instrument].load(std::memory_order_acquire);
+                update.top = update.book->topOfBook();
+            }
+            if (update.tickerUpdates > 0 && !tickerSource(instrument, update.ticker)) {
+                update.tickerUpdates = 0;
+            }
+            if (update.bookUpdates == 0 && update.tickerUpdates == 0) {
+                continue;
+            }
+            reader(update);
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool ConflatedSubscriber::hasPending() const {
+    for (const Kind& kind : kinds) {
+        for (const auto& word : kind.dirty) {
+            if (word.load(std::memory_order_relaxed) != 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+ConflationStats ConflatedSubscriber::stats() const {
+    ConflationStats out{};
+    for (size_t k = 0; k < kConflatedKinds; ++k) {
+        out.updates[k] = kinds[k].updates.load(std::memory_order_relaxed);
+        out.delivered[k] = delivered[k].load(std::memory_order_relaxed);
+        out.conflated[k] = conflated[k].load(std::memory_order_relaxed);
+    }
+    uint64_t dirty[kWords] = {};
+    for (const Kind& kind : kinds) {
+        for (size_t w = 0; w < kWords; ++w) {
+            dirty[w] |= kind.dirty[w].load(std::memory_order_relaxed);
+        }
+    }
+    for (uint64_t word : dirty) {
+        out.dirty += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return out;
+}
@@ -0,0 +1,201 @@
+#include "MarketDataManager.h"
+#include <algorithm>
+#include <limits>
+
+static uint64_t fnv1a(const std::string& text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+MarketDataManager::MarketDataManager(Authorization* auth, const MarketDataOptions& options)
+    : options(options), owners(new std::atomic<uint16_t>[kMaxInstruments]),
+      lastSample(std::chrono::steady_clock::now())
+{
+    initLogger();
+    for (size_t i = 0; i < kMaxInstruments; ++i) {
+        owners[i].store(kNoShard, std::memory_order_relaxed);
+    }
+    size_t count = std::max<size_t>(1, options.connections);
+    shards.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        WebsocketClientOptions clientOptions = options.client;
+        if (!options.urls.empty()) {
+            clientOptions.url = options.urls[i % options.urls.size()];
+        }
+        clientOptions.connectionId = options.client.connectionId + static_cast<uint32_t>(i);
+        clientOptions.ioCpu = i < options.ioCpus.size() ? options.ioCpus[i] : -1;
+        clientOptions.consumerCpu = i < options.consumerCpus.size() ? options.consumerCpus[i] : -1;
+
+        Shard& shard = shards[i];
+        shard.client = std::make_unique<WebsocketClient>(auth, clientOptions);
+        shard.toGlobal.reset(new std::atomic<InstrumentId>[kMaxInstruments]);
+        for (size_t id = 0; id < kMaxInstruments; ++id) {
+            shard.toGlobal[id].store(kNoInstrument, std::memory_order_relaxed);
+        }
+        forwardEvents(shard);
+    }
+    systemLogger->info("[MarketData] {} connection(s), sharded by {}", count,
+                       options.policy == ShardPolicy::RATE ? "message rate" : "hash");
+}
+
+void MarketDataManager::start() {
+    for (auto& shard : shards) {
+        shard.client->start();
+    }
+}
+
+void MarketDataManager::stop() {
+    for (auto& shard : shards) {
+        shard.client->stop();
+    }
+}
+
+// Re-dispatch every shard event through the manager's dispatcher with the
+// manager's instrument id. Runs on the shard's consumer thread.
+void MarketDataManager::forwardEvents(Shard& shard) {
+    std::atomic<InstrumentId>* toGlobal = shard.toGlobal.get();
+    auto globalId = [toGlobal](InstrumentId local) {
+        return local < kMaxInstruments ? toGlobal[local].load(std::memory_order_acquire) : kNoInstrument;
+    };
+    ChannelDispatcher& channels = shard.client->channels();
+    channels.onBook(kNoInstrument, [this, globalId](const BookEvent& event) {
+        dispatcher.dispatch(BookEvent{globalId(event.instrument), event.update, event.book});
+    });
+    auto forwardData = [this, globalId](const ChannelDataEvent& event) {
+        dispatcher.dispatch(ChannelDataEvent{event.kind, globalId(event.instrument), event.data});
+    };
+    channels.onTicker(kNoInstrument, forwardData);
+    channels.onTrades(kNoInstrument, forwardData);
+    channels.onUserOrders(kNoInstrument, forwardData);
+    channels.onUserTrades(kNoInstrument, forwardData);
+    channels.onPortfolio([this](const PortfolioEvent& event) { dispatcher.dispatch(event); });
+    channels.onUserChanges([this](const UserChangesEvent& event) { dispatcher.dispatch(event); });
+}
+
+void MarketDataManager::subscribe(ChannelKind kind, const std::vector<std::string>& instruments) {
+    std::vector<std::vector<std::string>> perShard(shards.size());
+    {
+        std::lock_guard<std::mutex> lock(assignMutex);
+        std::vector<InstrumentId> ids = registry.intern(instruments);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (ids[i] == kNoInstrument) {
+                systemLogger->error("[MarketData] Instrument limit reached, not subscribing {}", instruments[i]);
+                continue;
+            }
+            size_t index = owners[ids[i]].load(std::memory_order_relaxed);
+            if (index == kNoShard) {
+                index = assign(ids[i], instruments[i]);
+            }
+            perShard[index].push_back(instruments[i]);
+        }
+    }
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!perShard[i].empty()) {
+            shards[i].client->subscribe(kind, perShard[i]);
+        }
+    }
+}
+
+// Caller holds assignMutex. The shard learns the id mapping before it can
+// receive anything for the instrument.
+size_t MarketDataManager::assign(InstrumentId instrument, const std::string& name) {
+    size_t index;
+    if (options.policy == ShardPolicy::RATE) {
+        sampleRates();
+        index = leastLoadedShard();
+    } else {
+        index = fnv1a(name) % shards.size();
+    }
+    Shard& shard = shards[index];
+    InstrumentId local = shard.client->instruments().intern(name);
+    if (local != kNoInstrument) {
+        shard.toGlobal[local].store(instrument, std::memory_order_release);
+    }
+    ++shard.instruments;
+    ++shard.assignedSinceSample;
+    owners[instrument].store(static_cast<uint16_t>(index), std::memory_order_release);
+    return index;
+}
+
+// Instruments assigned since the last sample have no measured rate yet; they
+// count at the average per-instrument rate, so a burst of new subscriptions
+// spreads out instead of piling onto the currently quietest shard.
+size_t MarketDataManager::leastLoadedShard() const {
+    double totalRate = 0.0;
+    size_t measured = 0;
+    for (const auto& shard : shards) {
+        totalRate += shard.rate;
+        measured += shard.instruments - shard.assignedSinceSample;
+    }
+    double perInstrument = measured > 0 && totalRate > 0.0 ? totalRate / static_cast<double>(measured) : 1.0;
+
+    size_t best = 0;
+    double bestLoad = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const Shard& shard = shards[i];
+        double load = shard.rate + static_cast<double>(shard.assignedSinceSample) * perInstrument;
+        if (load < bestLoad || (load == bestLoad && shard.instruments < shards[best].instruments)) {
+            best = i;
+            bestLoad = load;
+        }
+    }
+    return best;
+}
+
+// Caller holds assignMutex. Frames received per shard over the last window.
+void MarketDataManager::sampleRates() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - lastSample;
+    if (elapsed < options.rateWindow) {
+        return;
+    }
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    for (auto& shard : shards) {
+        uint64_t frames = shard.client->inboundStats().published;
+        shard.rate = static_cast<double>(frames - shard.sampledFrames) / seconds;
+        shard.sampledFrames = frames;
+        shard.assignedSinceSample = 0;
+    }
+    lastSample = now;
+}
+
+OrderBook* MarketDataManager::book(InstrumentId instrument) const {
+    size_t index = shardOf(instrument);
+    if (index >= shards.size()) {
+        return nullptr;
+    }
+    WebsocketClient& client = *shards[index].client;
+    return client.orderBooks().get(client.instruments().find(registry.name(instrument)));
+}
+
+bool MarketDataManager::ticker(InstrumentId instrument, TickerSnapshot& out) const {
+    size_t index = shardOf(instrument);
+    if (index >= shards.size()) {
+        return false;
+    }
+    WebsocketClient& client = *shards[index].client;
+    return client.tickers().load(client.instruments().find(registry.name(instrument)), out);
+}
+
+size_t MarketDataManager::shardOf(InstrumentId instrument) const {
+    if (instrument >= kMaxInstruments) {
+        return shards.size();
+    }
+    uint16_t index = owners[instrument].load(std::memory_order_acquire);
+    return index == kNoShard ? shards.size() : index;
+}
+
+std::vector<ShardStats> MarketDataManager::stats() {
+    std::lock_guard<std::mutex> lock(assignMutex);
+    sampleRates();
+    std::vector<ShardStats> result;
+    for (const auto& shard : shards) {
+        RingStats ring = shard.client->inboundStats();
+        result.push_back(ShardStats{shard.instruments, ring.published, shard.rate, ring});
+    }
+    return result;
+}
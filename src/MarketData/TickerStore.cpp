@@ -0,0 +1,99 @@
+#include "TickerStore.h"
+
+// TickerSnapshot member for every TickerField.
+static double TickerSnapshot::* const kFieldMembers[kTickerFields] = {
+    &TickerSnapshot::bestBidPrice,
+    &TickerSnapshot::bestBidAmount,
+    &TickerSnapshot::bestAskPrice,
+    &TickerSnapshot::bestAskAmount,
+    &TickerSnapshot::markPrice,
+    &TickerSnapshot::indexPrice,
+    &TickerSnapshot::lastPrice,
+    &TickerSnapshot::currentFunding,
+    &TickerSnapshot::funding8h,
+    &TickerSnapshot::openInterest,
+    &TickerSnapshot::markIv,
+    &TickerSnapshot::bidIv,
+    &TickerSnapshot::askIv,
+    &TickerSnapshot::underlyingPrice,
+};
+
+TickerStore::TickerStore()
+    : sequences(new Sequence[kMaxInstruments]),
+      values(new double[kTickerFields * kMaxInstruments]()),
+      timestamps(new int64_t[kMaxInstruments]())
+{
+}
+
+void TickerStore::store(InstrumentId instrument, const TickerSnapshot& ticker) {
+    if (instrument >= kMaxInstruments) {
+        return;
+    }
+    std::atomic<uint64_t>& seq = sequences[instrument].value;
+    uint64_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t field = 0; field < kTickerFields; ++field) {
+        column(static_cast<TickerField>(field))[instrument] = ticker.*kFieldMembers[field];
+    }
+    timestamps[instrument] = ticker.timestamp;
+    seq.store(s + 2, std::memory_order_release);
+}
+
+void TickerStore::read(InstrumentId instrument, TickerSnapshot& out) const {
+    for (size_t field = 0; field < kTickerFields; ++field) {
+        out.*kFieldMembers[field] = column(static_cast<TickerField>(field))[instrument];
+    }
+    out.timestamp = timestamps[instrument];
+}
+
+bool TickerStore::tryLoad(InstrumentId instrument, TickerSnapshot& out) const {
+    if (instrument >= kMaxInstruments) {
+        return false;
+    }
+    const std::atomic<uint64_t>& seq = sequences[instrument].value;
+    uint64_t before = seq.load(std::memory_order_acquire);
+    if (before == 0 || (before & 1)) {
+        return false;
+    }
+    read(instrument, out);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq.load(std::memory_order_relaxed) == before;
+}
+
+bool TickerStore::load(InstrumentId instrument, TickerSnapshot& out) const {
+    if (instrument >= kMaxInstruments) {
+        return false;
+    }
+    const std::atomic<uint64_t>& seq = sequences[instrument].value;
+    uint64_t before, after;
+    do {
+        before = seq.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        read(instrument, out);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return true;
+}
+
+bool TickerStore::loadField(InstrumentId instrument, TickerField field, double& out) const {
+    if (instrument >= kMaxInstruments || field >= TickerField::COUNT) {
+        return false;
+    }
+    const std::atomic<uint64_t>& seq = sequences[instrument].value;
+    const double* value = column(field) + instrument;
+    uint64_t before, after;
+    do {
+        before = seq.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        out = *value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return true;
+}
@@ -0,0 +1,511 @@
+#include "MessageParser.h"
+#include "OrderManager.h"
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+BookUpdate ParsedMessage::bookUpdate() const {
+    BookUpdate update{};
+    update.isSnapshot = isSnapshot;
+    update.changeId = changeId;
+    update.prevChangeId = prevChangeId;
+    update.timestamp = timestamp;
+    update.bids = bids;
+    update.bidCount = bidCount;
+    update.asks = asks;
+    update.askCount = askCount;
+    return update;
+}
+
+// ------------------ Scanner helpers ------------------ //
+
+void MessageParser::skipWhitespace() {
+    while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+        ++pos;
+    }
+}
+
+bool MessageParser::consume(char ch) {
+    skipWhitespace();
+    if (pos < end && *pos == ch) {
+        ++pos;
+        return true;
+    }
+    return false;
+}
+
+bool MessageParser::peek(char ch) {
+    skipWhitespace();
+    return pos < end && *pos == ch;
+}
+
+// Reads a string that contains no escape sequences. Routed fields (channels,
+// methods, instrument names, book actions) never do; anything else is rejected.
+bool MessageParser::readString(std::string_view& out) {
+    if (!consume('"')) {
+        return false;
+    }
+    const char* start = pos;
+    while (pos < end && *pos != '"') {
+        if (*pos == '\\') {
+            return false;
+        }
+        ++pos;
+    }
+    if (pos >= end) {
+        return false;
+    }
+    out = std::string_view(start, pos - start);
+    ++pos;
+    return true;
+}
+
+bool MessageParser::skipString() {
+    if (!consume('"')) {
+        return false;
+    }
+    while (pos < end) {
+        if (*pos == '\\') {
+            // A backslash needs its escaped character; a trailing one is malformed.
+            if (pos + 1 >= end) {
+                return false;
+            }
+            pos += 2;
+            continue;
+        }
+        if (*pos == '"') {
+            ++pos;
+            return true;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+// Skips any JSON value, optionally returning its raw text.
+bool MessageParser::skipValue(std::string_view* raw) {
+    skipWhitespace();
+    if (pos >= end) {
+        return false;
+    }
+    const char* start = pos;
+    if (*pos == '"') {
+        if (!skipString()) {
+            return false;
+        }
+    } else if (*pos == '{' || *pos == '[') {
+        int depth = 0;
+        while (pos < end) {
+            char c = *pos;
+            if (c == '"') {
+                if (!skipString()) {
+                    return false;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    ++pos;
+                    break;
+                }
+            }
+            ++pos;
+        }
+        if (depth != 0) {
+            return false;
+        }
+    } else {
+        // Number, true, false or null.
+        while (pos < end && *pos != ',' && *pos != '}' && *pos != ']' &&
+               *pos != ' ' && *pos != '\n' && *pos != '\r' && *pos != '\t') {
+            ++pos;
+        }
+    }
+    if (raw) {
+        *raw = std::string_view(start, pos - start);
+    }
+    return true;
+}
+
+bool MessageParser::readInt(int64_t& out) {
+    skipWhitespace();
+    auto res = std::from_chars(pos, end, out);
+    if (res.ec != std::errc()) {
+        return false;
+    }
+    pos = res.ptr;
+    return true;
+}
+
+bool MessageParser::readDouble(double& out) {
+    skipWhitespace();
+    auto res = std::from_chars(pos, end, out);
+    if (res.ec != std::errc()) {
+        return false;
+    }
+    pos = res.ptr;
+    return true;
+}
+
+bool MessageParser::readOptionalString(std::string_view& out) {
+    return peek('"') ? readString(out) : skipValue();
+}
+
+static bool startsNumber(char c) {
+    return c == '-' || (c >= '0' && c <= '9');
+}
+
+bool MessageParser::readOptionalDouble(double& out) {
+    skipWhitespace();
+    return pos < end && startsNumber(*pos) ? readDouble(out) : skipValue();
+}
+
+bool MessageParser::readOptionalInt(int64_t& out) {
+    skipWhitespace();
+    return pos < end && startsNumber(*pos) ? readInt(out) : skipValue();
+}
+
+// ------------------ Frame parsing ------------------ //
+
+bool MessageParser::parse(const char* payload, size_t length, ParsedMessage& out) {
+    pos = payload;
+    end = payload + length;
+
+    out.kind = MessageKind::UNKNOWN;
+    out.hasId = false;
+    out.id = 0;
+    out.method = std::string_view();
+    out.channel = std::string_view();
+    out.data = std::string_view();
+    out.result = std::string_view();
+    out.error = std::string_view();
+    out.hasBook = false;
+
+    if (!consume('{')) {
+        return false;
+    }
+    bool hasResult = false;
+    bool hasError = false;
+    if (!consume('}')) {
+        do {
+            std::string_view key;
+            if (!readString(key) || !consume(':')) {
+                return false;
+            }
+            if (key == "id") {
+                if (peek('n')) {
+                    if (!skipValue()) {
+                        return false;
+                    }
+                } else {
+                    if (!readInt(out.id)) {
+                        return false;
+                    }
+                    out.hasId = true;
+                }
+            } else if (key == "method") {
+                if (!readString(out.method)) {
+                    return false;
+                }
+            } else if (key == "params") {
+                if (!parseParams(out)) {
+                    return false;
+                }
+            } else if (key == "result") {
+                if (!skipValue(&out.result)) {
+                    return false;
+                }
+                hasResult = true;
+            } else if (key == "error") {
+                if (!skipValue(&out.error)) {
+                    return false;
+                }
+                hasError = true;
+            } else if (!skipValue()) {
+                return false;
+            }
+        } while (consume(','));
+        if (!consume('}')) {
+            return false;
+        }
+    }
+
+    if (!out.channel.empty()) {
+        out.kind = MessageKind::NOTIFICATION;
+        if (out.channel.compare(0, 5, "book.") == 0) {
+            return parseBook(out.data, out);
+        }
+        return true;
+    }
+    if (hasError) {
+        out.kind = MessageKind::ERROR_RESPONSE;
+        return true;
+    }
+    if (hasResult) {
+        out.kind = MessageKind::RESPONSE;
+        return true;
+    }
+    return false;
+}
+
+bool MessageParser::parseParams(ParsedMessage& out) {
+    if (!peek('{')) {
+        return skipValue();
+    }
+    consume('{');
+    if (consume('}')) {
+        return true;
+    }
+    do {
+        std::string_view key;
+        if (!readString(key) || !consume(':')) {
+            return false;
+        }
+        if (key == "channel") {
+            if (!readString(out.channel)) {
+                return false;
+            }
+        } else if (key == "data") {
+            if (!skipValue(&out.data)) {
+                return false;
+            }
+        } else if (!skipValue()) {
+            return false;
+        }
+    } while (consume(','));
+    return consume('}');
+}
+
+// Handles both book.*.raw / interval books (["action", price, amount] levels
+// with a snapshot/change type) and grouped books ([price, amount] levels,
+// every notification being a full snapshot).
+bool MessageParser::parseBook(std::string_view data, ParsedMessage& out) {
+    const char* savedEnd = end;
+    pos = data.data();
+    end = data.data() + data.size();
+
+    out.hasBook = true;
+    out.isSnapshot = true;
+    out.changeId = 0;
+    out.prevChangeId = 0;
+    out.timestamp = 0;
+    out.instrument = std::string_view();
+    out.bidCount = 0;
+    out.askCount = 0;
+
+    bool ok = consume('{');
+    if (ok && !consume('}')) {
+        do {
+            std::string_view key;
+            if (!readString(key) || !consume(':')) {
+                ok = false;
+                break;
+            }
+            if (key == "type") {
+                std::string_view type;
+                ok = readString(type);
+                out.isSnapshot = (type == "snapshot");
+            } else if (key == "timestamp") {
+                ok = readInt(out.timestamp);
+            } else if (key == "change_id") {
+                ok = readInt(out.changeId);
+            } else if (key == "prev_change_id") {
+                ok = readInt(out.prevChangeId);
+            } else if (key == "instrument_name") {
+                ok = readString(out.instrument);
+            } else if (key == "bids") {
+                ok = parseLevels(out.bids, out.bidCount);
+            } else if (key == "asks") {
+                ok = parseLevels(out.asks, out.askCount);
+            } else {
+                ok = skipValue();
+            }
+        } while (ok && consume(','));
+        ok = ok && consume('}');
+    }
+
+    end = savedEnd;
+    return ok && !out.instrument.empty();
+}
+
+// Ticker keys decoded into TickerSnapshot; everything else (stats, greeks, ...) is skipped.
+struct TickerKey {
+    std::string_view name;
+    double TickerSnapshot::* member;
+};
+static const TickerKey kTickerKeys[] = {
+    {"best_bid_price", &TickerSnapshot::bestBidPrice},
+    {"best_bid_amount", &TickerSnapshot::bestBidAmount},
+    {"best_ask_price", &TickerSnapshot::bestAskPrice},
+    {"best_ask_amount", &TickerSnapshot::bestAskAmount},
+    {"mark_price", &TickerSnapshot::markPrice},
+    {"index_price", &TickerSnapshot::indexPrice},
+    {"last_price", &TickerSnapshot::lastPrice},
+    {"current_funding", &TickerSnapshot::currentFunding},
+    {"funding_8h", &TickerSnapshot::funding8h},
+    {"open_interest", &TickerSnapshot::openInterest},
+    {"mark_iv", &TickerSnapshot::markIv},
+    {"bid_iv", &TickerSnapshot::bidIv},
+    {"ask_iv", &TickerSnapshot::askIv},
+    {"underlying_price", &TickerSnapshot::underlyingPrice},
+};
+
+bool MessageParser::parseTicker(std::string_view data, TickerSnapshot& out) {
+    const char* savedPos = pos;
+    const char* savedEnd = end;
+    pos = data.data();
+    end = data.data() + data.size();
+
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    for (const auto& key : kTickerKeys) {
+        out.*key.member = missing;
+    }
+    out.timestamp = 0;
+
+    bool ok = consume('{');
+    if (ok && !consume('}')) {
+        do {
+            std::string_view key;
+            if (!readString(key) || !consume(':')) {
+                ok = false;
+                break;
+            }
+            if (key == "timestamp") {
+                ok = readInt(out.timestamp);
+                continue;
+            }
+            const TickerKey* match = nullptr;
+            for (const auto& candidate : kTickerKeys) {
+                if (candidate.name == key) {
+                    match = &candidate;
+                    break;
+                }
+            }
+            if (match && !peek('n')) {
+                ok = readDouble(out.*match->member);
+            } else {
+                ok = skipValue();
+            }
+        } while (ok && consume(','));
+        ok = ok && consume('}');
+    }
+
+    pos = savedPos;
+    end = savedEnd;
+    return ok;
+}
+
+bool MessageParser::parseLevels(BookLevelUpdate* levels, size_t& count) {
+    count = 0;
+    if (!consume('[')) {
+        return false;
+    }
+    if (consume(']')) {
+        return true;
+    }
+    do {
+        if (count >= kMaxParsedLevels || !consume('[')) {
+            return false;
+        }
+        BookLevelUpdate& level = levels[count];
+        level.action = BookAction::CHANGE;
+        if (peek('"')) {
+            std::string_view action;
+            if (!readString(action) || !consume(',')) {
+                return false;
+            }
+            if (action == "new") {
+                level.action = BookAction::NEW;
+            } else if (action == "delete") {
+                level.action = BookAction::DELETE;
+            }
+        }
+        if (!readDouble(level.price) || !consume(',') || !readDouble(level.amount) || !consume(']')) {
+            return false;
+        }
+        ++count;
+    } while (consume(','));
+    return consume(']');
+}
+
+// Same fields as the nlohmann decoding in OrderManager, which remains the
+// fallback for whatever this rejects.
+bool MessageParser::parseOrder(std::string_view object, OrderUpdate& out) {
+    const char* savedPos = pos;
+    const char* savedEnd = end;
+    pos = object.data();
+    end = object.data() + object.size();
+
+    out = OrderUpdate{};
+    bool ok = consume('{');
+    if (ok && !consume('}')) {
+        do {
+            std::string_view key;
+            if (!readString(key) || !consume(':')) {
+                ok = false;
+                break;
+            }
+            if (key == "order_id") {
+                ok = readOptionalString(out.orderId);
+            } else if (key == "label") {
+                ok = readOptionalString(out.label);
+            } else if (key == "instrument_name") {
+                ok = readOptionalString(out.instrument);
+            } else if (key == "order_state") {
+                ok = readOptionalString(out.orderState);
+            } else if (key == "direction") {
+                ok = readOptionalString(out.direction);
+            } else if (key == "order_type") {
+                ok = readOptionalString(out.orderType);
+            } else if (key == "amount") {
+                ok = readOptionalDouble(out.amount);
+            } else if (key == "price") {
+                ok = readOptionalDouble(out.price);
+            } else if (key == "filled_amount") {
+                ok = readOptionalDouble(out.filledAmount);
+            } else if (key == "average_price") {
+                ok = readOptionalDouble(out.averagePrice);
+            } else if (key == "creation_timestamp") {
+                ok = readOptionalInt(out.createdAt);
+            } else if (key == "last_update_timestamp") {
+                ok = readOptionalInt(out.updatedAt);
+            } else {
+                ok = skipValue();
+            }
+        } while (ok && consume(','));
+        ok = ok && consume('}');
+    }
+
+    pos = savedPos;
+    end = savedEnd;
+    return ok;
+}
+
+bool MessageParser::findMember(std::string_view object, std::string_view key, std::string_view& out) {
+    const char* savedPos = pos;
+    const char* savedEnd = end;
+    pos = object.data();
+    end = object.data() + object.size();
+
+    bool found = false;
+    bool ok = consume('{');
+    if (ok && !consume('}')) {
+        do {
+            std::string_view name;
+            if (!readString(name) || !consume(':')) {
+                break;
+            }
+            if (name == key) {
+                found = skipValue(&out);
+                break;
+            }
+            ok = skipValue();
+        } while (ok && consume(','));
+    }
+
+    pos = savedPos;
+    end = savedEnd;
+    return found;
+}
@@ -0,0 +1,749 @@
+#include "MockMatchingEngine.h"
+#include <websocketpp/config/asio.hpp>
+#include <websocketpp/server.hpp>
+#include <nlohmann/json.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Local stand-in for test.deribit.com. Serves the JSON-RPC subset the client
+// uses over HTTPS (POST /api/v2/<method>) and WSS (/ws/api/v2) on one port,
+// backed by MockMatchingEngine, and streams synthetic book.*.raw and
+// ticker.* notifications at fixed rates to subscribers. Authenticated sessions
+// can also subscribe user.orders.*.raw and user.changes.*.raw, which carry
+// every order and fill the engine reports, REST orders included.
+//
+// usage: mock_exchange [--port 8443] [--cert mock_cert.pem] [--key mock_key.pem]
+//                      [--book-rate 100] [--ticker-rate 10] [--depth 20] [--seed 1]
+//                      [--client-id id --client-secret secret]
+// Rates are messages per second per subscribed instrument. Everything runs on
+// one I/O thread. HTTP connections are closed after each response, so REST
+// round trips against the mock include a TLS handshake.
+
+typedef websocketpp::server<websocketpp::config::asio_tls> MockServer;
+using websocketpp::connection_hdl;
+using json = nlohmann::json;
+using ojson = nlohmann::ordered_json;
+
+struct MockOptions {
+    uint16_t port = 8443;
+    std::string cert = "mock_cert.pem";
+    std::string key = "mock_key.pem";
+    double bookRate = 100.0;
+    double tickerRate = 10.0;
+    size_t depth = 20;
+    uint64_t seed = 1;
+    std::string clientId;       // empty accepts any credentials
+    std::string clientSecret;
+};
+
+struct RpcError {
+    int code;
+    std::string message;
+};
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static ojson orderToJson(const MockOrder& order) {
+    return ojson{
+        {"order_id", order.orderId},
+        {"instrument_name", order.instrument},
+        {"direction", order.direction},
+        {"order_type", order.orderType},
+        {"order_state", order.orderState},
+        {"price", order.orderType == "market" ? ojson("market_price") : ojson(order.price)},
+        {"amount", order.amount},
+        {"filled_amount", order.filledAmount},
+        {"average_price", order.averagePrice},
+        {"time_in_force", "good_til_cancelled"},
+        {"post_only", false},
+        {"reduce_only", false},
+        {"label", order.label},
+        {"api", true},
+        {"creation_timestamp", order.creationTimestamp},
+        {"last_update_timestamp", order.lastUpdateTimestamp}
+    };
+}
+
+static ojson tradesToJson(const std::vector<MockTrade>& trades) {
+    ojson out = ojson::array();
+    for (const auto& trade : trades) {
+        out.push_back(ojson{
+            {"trade_id", trade.tradeId},
+            {"order_id", trade.orderId},
+            {"instrument_name", trade.instrument},
+            {"direction", trade.direction},
+            {"price", trade.price},
+            {"amount", trade.amount},
+            {"timestamp", trade.timestamp},
+            {"trade_seq", trade.tradeSeq}
+        });
+    }
+    return out;
+}
+
+static ojson positionToJson(const MockPosition& position, const MockTicker& ticker) {
+    return ojson{
+        {"instrument_name", position.instrument},
+        {"kind", "future"},
+        {"direction", position.size > 0 ? "buy" : position.size < 0 ? "sell" : "zero"},
+        {"size", position.size},
+        {"average_price", position.averagePrice},
+        {"mark_price", ticker.markPrice},
+        {"realized_profit_loss", position.realizedPnl},
+        {"floating_profit_loss", position.size * (ticker.markPrice - position.averagePrice)}
+    };
+}
+
+static ojson levelsToJson(const std::vector<MockLevelChange>& levels) {
+    ojson out = ojson::array();
+    for (const auto& level : levels) {
+        out.push_back(ojson::array({level.action, level.price, level.amount}));
+    }
+    return out;
+}
+
+class MockExchange {
+public:
+    explicit MockExchange(const MockOptions& options)
+        : options(options), engine(options.seed, options.depth), nextToken(1),
+          framesSent(0), ordersHandled(0), httpRequests(0)
+    {
+        server.clear_access_channels(websocketpp::log::alevel::all);
+        server.clear_error_channels(websocketpp::log::elevel::all);
+        server.init_asio();
+        server.set_reuse_addr(true);
+
+        server.set_tls_init_handler([this](connection_hdl) {
+            auto ctx = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tlsv12);
+            ctx->set_options(boost::asio::ssl::context::default_workarounds |
+                             boost::asio::ssl::context::no_sslv2 |
+                             boost::asio::ssl::context::no_sslv3);
+            ctx->use_certificate_chain_file(this->options.cert);
+            ctx->use_private_key_file(this->options.key, boost::asio::ssl::context::pem);
+            return ctx;
+        });
+        server.set_open_handler([this](connection_hdl hdl) {
+            sessions[hdl] = Session();
+        });
+        server.set_close_handler([this](connection_hdl hdl) {
+            dropSession(hdl);
+        });
+        server.set_fail_handler([this](connection_hdl hdl) {
+            dropSession(hdl);
+        });
+        server.set_message_handler([this](connection_hdl hdl, MockServer::message_ptr msg) {
+            onWebsocketMessage(hdl, msg->get_payload());
+        });
+        server.set_http_handler([this](connection_hdl hdl) {
+            onHttpRequest(hdl);
+        });
+    }
+
+    void run() {
+        websocketpp::lib::error_code ec;
+        server.listen(options.port, ec);
+        if (ec) {
+            std::cerr << "cannot listen on port " << options.port << ": " << ec.message() << std::endl;
+            return;
+        }
+        server.start_accept();
+
+        timer = std::make_unique<boost::asio::steady_timer>(server.get_io_service());
+        lastTick = std::chrono::steady_clock::now();
+        lastReport = lastTick;
+        scheduleTick();
+
+        boost::asio::signal_set signals(server.get_io_service(), SIGINT, SIGTERM);
+        signals.async_wait([this](const boost::system::error_code&, int) { shutdown(); });
+
+        std::cout << "mock exchange on https://127.0.0.1:" << options.port
+                  << " and wss://127.0.0.1:" << options.port << "/ws/api/v2"
+                  << " (book " << options.bookRate << "/s, ticker " << options.tickerRate << "/s per instrument)"
+                  << std::endl;
+        server.run();
+    }
+
+private:
+    struct Session {
+        bool authenticated = false;
+        std::set<std::string> channels;
+    };
+
+    // Message credit per subscribed instrument, refilled from the rates on every tick.
+    struct Feed {
+        double bookCredit = 0.0;
+        double tickerCredit = 0.0;
+    };
+
+    MockOptions options;
+    MockServer server;
+    MockMatchingEngine engine;
+    std::map<connection_hdl, Session, std::owner_less<connection_hdl>> sessions;
+    std::map<std::string, std::set<connection_hdl, std::owner_less<connection_hdl>>> subscribers;
+    std::map<std::string, Feed> feeds;
+    std::set<std::string> accessTokens;
+    std::set<std::string> refreshTokens;
+    uint64_t nextToken;
+
+    std::unique_ptr<boost::asio::steady_timer> timer;
+    std::chrono::steady_clock::time_point lastTick;
+    std::chrono::steady_clock::time_point lastReport;
+    uint64_t framesSent;
+    uint64_t ordersHandled;
+    uint64_t httpRequests;
+
+    // ------------------ Transport ------------------ //
+
+    void onHttpRequest(connection_hdl hdl) {
+        MockServer::connection_ptr con = server.get_con_from_hdl(hdl);
+        ++httpRequests;
+        std::string resource = con->get_resource();
+        size_t query = resource.find('?');
+        if (query != std::string::npos) {
+            resource.resize(query);
+        }
+        const std::string prefix = "/api/v2/";
+        con->append_header("Content-Type", "application/json");
+        if (resource.compare(0, prefix.size(), prefix) != 0) {
+            con->set_status(websocketpp::http::status_code::not_found);
+            con->set_body(R"({"error":"not found"})");
+            return;
+        }
+
+        json request = json::object();
+        const std::string& body = con->get_request_body();
+        if (!body.empty()) {
+            request = json::parse(body, nullptr, false);
+            if (request.is_discarded()) {
+                con->set_status(websocketpp::http::status_code::bad_request);
+                con->set_body(errorResponse(json(), RpcError{-32700, "Parse error"}, nowUs()));
+                return;
+            }
+        }
+        std::string bearer = con->get_request_header("Authorization");
+        const std::string scheme = "Bearer ";
+        bool authorized = bearer.compare(0, scheme.size(), scheme) == 0 &&
+                          accessTokens.count(bearer.substr(scheme.size())) > 0;
+
+        std::string method = resource.substr(prefix.size());
+        con->set_status(websocketpp::http::status_code::ok);
+        con->set_body(handleRequest(method, request, authorized, nullptr, hdl));
+    }
+
+    void onWebsocketMessage(connection_hdl hdl, const std::string& payload) {
+        json request = json::parse(payload, nullptr, false);
+        if (request.is_discarded() || !request.is_object()) {
+            send(hdl, errorResponse(json(), RpcError{-32700, "Parse error"}, nowUs()));
+            return;
+        }
+        Session& session = sessions[hdl];
+        std::string method = request.value("method", "");
+        send(hdl, handleRequest(method, request, session.authenticated, &session, hdl));
+        // Book snapshots follow the subscribe response, as on Deribit.
+        if (method == "public/subscribe" || method == "private/subscribe") {
+            sendSnapshots(hdl, request);
+        }
+    }
+
+    void send(connection_hdl hdl, const std::string& payload) {
+        websocketpp::lib::error_code ec;
+        server.send(hdl, payload, websocketpp::frame::opcode::text, ec);
+        if (!ec) {
+            ++framesSent;
+        }
+    }
+
+    void dropSession(connection_hdl hdl) {
+        auto it = sessions.find(hdl);
+        if (it == sessions.end()) {
+            return;
+        }
+        for (const auto& channel : it->second.channels) {
+            subscribers[channel].erase(hdl);
+        }
+        sessions.erase(it);
+    }
+
+    // ------------------ JSON-RPC ------------------ //
+
+    std::string handleRequest(const std::string& method, const json& request, bool authorized,
+                              Session* session, connection_hdl hdl) {
+        int64_t usIn = nowUs();
+        json id = request.contains("id") ? request["id"] : json();
+        json params = request.contains("params") ? request["params"] : json::object();
+        try {
+            ojson result = dispatch(method, params, authorized, session, hdl);
+            int64_t usOut = nowUs();
+            ojson response = {
+                {"jsonrpc", "2.0"},
+                {"id", id},
+                {"result", result},
+                {"usIn", usIn},
+                {"usOut", usOut},
+                {"usDiff", usOut - usIn},
+                {"testnet", true}
+            };
+            return response.dump();
+        } catch (const RpcError& error) {
+            return errorResponse(id, error, usIn);
+        } catch (const json::exception& e) {
+            return errorResponse(id, RpcError{-32602, std::string("Invalid params: ") + e.what()}, usIn);
+        }
+    }
+
+    std::string errorResponse(const json& id, const RpcError& error, int64_t usIn) {
+        int64_t usOut = nowUs();
+        ojson response = {
+            {"jsonrpc", "2.0"},
+            {"id", id},
+            {"error", {{"code", error.code}, {"message", error.message}}},
+            {"usIn", usIn},
+            {"usOut", usOut},
+            {"usDiff", usOut - usIn},
+            {"testnet", true}
+        };
+        return response.dump();
+    }
+
+    ojson dispatch(const std::string& method, const json& params, bool authorized, Session* session,
+                   connection_hdl hdl) {
+        if (method == "public/test") {
+            return ojson{{"version", "mock"}};
+        }
+        if (method == "public/auth") {
+            return authenticate(params, session);
+        }
+        if (method == "public/subscribe" || method == "private/subscribe") {
+            if (!session) {
+                throw RpcError{-32601, "subscriptions need a WebSocket session"};
+            }
+            return subscribe(params, authorized, session, hdl);
+        }
+        if (method == "public/unsubscribe" || method == "private/unsubscribe") {
+            if (!session) {
+                throw RpcError{-32601, "subscriptions need a WebSocket session"};
+            }
+            return unsubscribe(params, session, hdl);
+        }
+        if (method.compare(0, 8, "private/") != 0) {
+            throw RpcError{-32601, "Method not found"};
+        }
+        if (!authorized && !(params.contains("access_token") &&
+                             accessTokens.count(params["access_token"].get<std::string>()))) {
+            throw RpcError{13009, "unauthorized"};
+        }
+
+        if (method == "private/buy" || method == "private/sell") {
+            ++ordersHandled;
+            std::string instrument = params.at("instrument_name").get<std::string>();
+            MockOrderResult result = engine.placeOrder(instrument, method == "private/buy" ? "buy" : "sell",
+                                                       params.value("type", "limit"),
+                                                       params.at("amount").get<double>(),
+                                                       params.value("price", 0.0),
+                                                       params.value("label", ""));
+            return orderResult(result, instrument);
+        }
+        if (method == "private/edit") {
+            ++ordersHandled;
+            MockOrderResult result = engine.editOrder(params.at("order_id").get<std::string>(),
+                                                      params.at("amount").get<double>(),
+                                                      params.at("price").get<double>());
+            return orderResult(result, result.order.instrument);
+        }
+        if (method == "private/cancel") {
+            ++ordersHandled;
+            MockOrderResult result = engine.cancelOrder(params.at("order_id").get<std::string>());
+            if (!result.error.empty()) {
+                throw RpcError{result.errorCode, result.error};
+            }
+            publishBook(result.order.instrument);
+            publishAccount(result.order, result.trades);
+            return orderToJson(result.order);
+        }
+        if (method == "private/get_positions") {
+            ojson out = ojson::array();
+            for (const auto& position : engine.positions(params.value("currency", ""))) {
+                out.push_back(positionToJson(position, engine.ticker(position.instrument)));
+            }
+            return out;
+        }
+        if (method == "private/get_open_orders") {
+            ojson out = ojson::array();
+            for (const auto& order : engine.openOrders(params.value("currency", ""))) {
+                out.push_back(orderToJson(order));
+            }
+            return out;
+        }
+        throw RpcError{-32601, "Method not found"};
+    }
+
+    ojson orderResult(const MockOrderResult& result, const std::string& instrument) {
+        if (!result.error.empty()) {
+            throw RpcError{result.errorCode, result.error};
+        }
+        publishBook(instrument);
+        publishAccount(result.order, result.trades);
+        return ojson{{"order", orderToJson(result.order)}, {"trades", tradesToJson(result.trades)}};
+    }
+
+    ojson authenticate(const json& params, Session* session) {
+        std::string grant = params.value("grant_type", "client_credentials");
+        if (grant == "client_credentials") {
+            if (!options.clientId.empty() && (params.value("client_id", "") != options.clientId ||
+                                              params.value("client_secret", "") != options.clientSecret)) {
+                throw RpcError{13004, "invalid_credentials"};
+            }
+        } else if (grant == "refresh_token") {
+            if (!refreshTokens.count(params.value("refresh_token", ""))) {
+                throw RpcError{13004, "invalid_credentials"};
+            }
+        } else {
+            throw RpcError{-32602, "Invalid params"};
+        }
+        std::string access = "mock-access-" + std::to_string(nextToken);
+        std::string refresh = "mock-refresh-" + std::to_string(nextToken);
+        ++nextToken;
+        accessTokens.insert(access);
+        refreshTokens.insert(refresh);
+        if (session) {
+            session->authenticated = true;
+        }
+        return ojson{
+            {"access_token", access},
+            {"expires_in", 900},
+            {"refresh_token", refresh},
+            {"scope", "connection mainaccount"},
+            {"token_type", "bearer"}
+        };
+    }
+
+    // Unsupported channels, and account channels of a session that has not
+    // authenticated, are left out of the result.
+    ojson subscribe(const json& params, bool authorized, Session* session, connection_hdl hdl) {
+        ojson out = ojson::array();
+        for (const auto& entry : params.at("channels")) {
+            std::string channel = entry.get<std::string>();
+            if (isAccountChannel(channel)) {
+                if (!authorized) {
+                    continue;
+                }
+            } else {
+                std::string instrument = channelInstrument(channel);
+                if (instrument.empty()) {
+                    continue;
+                }
+                feeds[instrument];
+            }
+            session->channels.insert(channel);
+            subscribers[channel].insert(hdl);
+            out.push_back(channel);
+        }
+        return out;
+    }
+
+    ojson unsubscribe(const json& params, Session* session, connection_hdl hdl) {
+        ojson out = ojson::array();
+        for (const auto& entry : params.at("channels")) {
+            std::string channel = entry.get<std::string>();
+            if (session->channels.erase(channel)) {
+                subscribers[channel].erase(hdl);
+                out.push_back(channel);
+            }
+        }
+        return out;
+    }
+
+    // "book.BTC-PERPETUAL.raw" / "ticker.BTC-PERPETUAL.100ms" -> "BTC-PERPETUAL"; "" if unsupported.
+    static std::string channelInstrument(const std::string& channel) {
+        size_t first = channel.find('.');
+        if (first == std::string::npos) {
+            return "";
+        }
+        std::string kind = channel.substr(0, first);
+        if (kind != "book" && kind != "ticker") {
+            return "";
+        }
+        size_t second = channel.find('.', first + 1);
+        return channel.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1);
+    }
+
+    // True for a channel of 'kind' ("book", "ticker") on exactly 'instrument'.
+    static bool isFeedOf(const std::string& channel, const std::string& kind, const std::string& instrument) {
+        return channel.compare(0, kind.size() + 1, kind + ".") == 0 && channelInstrument(channel) == instrument;
+    }
+
+    static std::vector<std::string> channelParts(const std::string& channel) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (true) {
+            size_t dot = channel.find('.', start);
+            parts.push_back(channel.substr(start, dot == std::string::npos ? std::string::npos : dot - start));
+            if (dot == std::string::npos) {
+                return parts;
+            }
+            start = dot + 1;
+        }
+    }
+
+    // "user.orders.<instrument>.raw", "user.orders.<kind>.<currency>.raw" and
+    // "user.changes.<kind>.<currency>.raw"; kind and currency may be "any".
+    static bool isAccountChannel(const std::string& channel) {
+        std::vector<std::string> parts = channelParts(channel);
+        if (parts[0] != "user" || parts.back() != "raw") {
+            return false;
+        }
+        return (parts.size() == 4 && parts[1] == "orders") ||
+               (parts.size() == 5 && (parts[1] == "orders" || parts[1] == "changes"));
+    }
+
+    // Whether an account channel of 'type' ("orders", "changes") carries 'instrument'.
+    static bool accountChannelCovers(const std::string& channel, const std::string& type,
+                                     const std::string& instrument) {
+        std::vector<std::string> parts = channelParts(channel);
+        if (parts[0] != "user" || parts[1] != type) {
+            return false;
+        }
+        if (parts.size() == 4) {
+            return parts[2] == instrument;
+        }
+        const std::string& kind = parts[2];
+        const std::string& currency = parts[3];
+        bool option = instrument.size() > 2 && instrument[instrument.size() - 2] == '-' &&
+                      (instrument.back() == 'C' || instrument.back() == 'P');
+        return (kind == "any" || kind == (option ? "option" : "future")) &&
+               (currency == "any" || instrument.compare(0, currency.size() + 1, currency + "-") == 0);
+    }
+
+    void sendSnapshots(connection_hdl hdl, const json& request) {
+        if (!request.contains("params") || !request["params"].contains("channels")) {
+            return;
+        }
+        for (const auto& entry : request["params"]["channels"]) {
+            std::string channel = entry.get<std::string>();
+            if (channel.compare(0, 5, "book.") == 0 && subscribers[channel].count(hdl)) {
+                publishBook(channelInstrument(channel));
+                send(hdl, bookNotification(channel, engine.snapshot(channelInstrument(channel))));
+            }
+        }
+    }
+
+    // ------------------ Market data ------------------ //
+
+    static std::string notification(const std::string& channel, const ojson& data) {
+        ojson message = {
+            {"jsonrpc", "2.0"},
+            {"method", "subscription"},
+            {"params", {{"channel", channel}, {"data", data}}}
+        };
+        return message.dump();
+    }
+
+    static std::string bookNotification(const std::string& channel, const MockBookDelta& delta) {
+        ojson data = {
+            {"type", delta.isSnapshot ? "snapshot" : "change"},
+            {"timestamp", delta.timestamp},
+            {"instrument_name", delta.instrument},
+            {"change_id", delta.changeId}
+        };
+        if (!delta.isSnapshot) {
+            data["prev_change_id"] = delta.prevChangeId;
+        }
+        data["bids"] = levelsToJson(delta.bids);
+        data["asks"] = levelsToJson(delta.asks);
+        return notification(channel, data);
+    }
+
+    // Send every pending change of a book to its subscribers.
+    void publishBook(const std::string& instrument) {
+        MockBookDelta delta;
+        while (engine.takeDelta(instrument, delta)) {
+            for (auto& entry : subscribers) {
+                if (entry.second.empty() || !isFeedOf(entry.first, "book", instrument)) {
+                    continue;
+                }
+                std::string payload = bookNotification(entry.first, delta);
+                for (const auto& hdl : entry.second) {
+                    send(hdl, payload);
+                }
+            }
+        }
+    }
+
+    void publishTicker(const std::string& instrument) {
+        MockTicker ticker = engine.ticker(instrument);
+        for (auto& entry : subscribers) {
+            if (entry.second.empty() || !isFeedOf(entry.first, "ticker", instrument)) {
+                continue;
+            }
+            ojson data = {
+                {"timestamp", ticker.timestamp},
+                {"instrument_name", ticker.instrument},
+                {"state", "open"},
+                {"best_bid_price", ticker.bestBidPrice},
+                {"best_bid_amount", ticker.bestBidAmount},
+                {"best_ask_price", ticker.bestAskPrice},
+                {"best_ask_amount", ticker.bestAskAmount},
+                {"last_price", ticker.lastPrice},
+                {"mark_price", ticker.markPrice},
+                {"index_price", ticker.markPrice}
+            };
+            std::string payload = notification(entry.first, data);
+            for (const auto& hdl : entry.second) {
+                send(hdl, payload);
+            }
+        }
+    }
+
+    // An order change and the fills that caused it: user.orders gets the
+    // order, user.changes the order, the trades and the resulting position.
+    void publishAccount(const MockOrder& order, const std::vector<MockTrade>& trades) {
+        for (auto& entry : subscribers) {
+            if (entry.second.empty()) {
+                continue;
+            }
+            std::string payload;
+            if (accountChannelCovers(entry.first, "orders", order.instrument)) {
+                payload = notification(entry.first, orderToJson(order));
+            } else if (accountChannelCovers(entry.first, "changes", order.instrument)) {
+                ojson positions = ojson::array();
+                if (!trades.empty()) {
+                    positions.push_back(positionToJson(engine.position(order.instrument),
+                                                       engine.ticker(order.instrument)));
+                }
+                payload = notification(entry.first, ojson{
+                    {"instrument_name", order.instrument},
+                    {"trades", tradesToJson(trades)},
+                    {"positions", positions},
+                    {"orders", ojson::array({orderToJson(order)})}
+                });
+            } else {
+                continue;
+            }
+            for (const auto& hdl : entry.second) {
+                send(hdl, payload);
+            }
+        }
+    }
+
+    bool hasSubscribers(const std::string& kind, const std::string& instrument) const {
+        for (const auto& entry : subscribers) {
+            if (!entry.second.empty() && isFeedOf(entry.first, kind, instrument)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void scheduleTick() {
+        timer->expires_after(std::chrono::milliseconds(1));
+        timer->async_wait([this](const boost::system::error_code& ec) {
+            if (ec) {
+                return;
+            }
+            onTick();
+            scheduleTick();
+        });
+    }
+
+    void onTick() {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastTick).count();
+        lastTick = now;
+        for (auto& entry : feeds) {
+            const std::string& instrument = entry.first;
+            Feed& feed = entry.second;
+            if (hasSubscribers("book", instrument)) {
+                feed.bookCredit += options.bookRate * elapsed;
+                while (feed.bookCredit >= 1.0) {
+                    engine.tick(instrument);
+                    publishBook(instrument);
+                    feed.bookCredit -= 1.0;
+                }
+            } else {
+                feed.bookCredit = 0.0;
+            }
+            if (hasSubscribers("ticker", instrument)) {
+                feed.tickerCredit += options.tickerRate * elapsed;
+                while (feed.tickerCredit >= 1.0) {
+                    publishTicker(instrument);
+                    feed.tickerCredit -= 1.0;
+                }
+            } else {
+                feed.tickerCredit = 0.0;
+            }
+        }
+        for (const auto& fill : engine.takeRestingFills()) {
+            MockOrder order;
+            if (engine.findOrder(fill.orderId, order)) {
+                publishAccount(order, {fill});
+            }
+        }
+
+        double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+        if (sinceReport >= 5.0) {
+            std::cout << "sessions=" << sessions.size() << " frames/s=" << static_cast<uint64_t>(framesSent / sinceReport)
+                      << " orders/s=" << static_cast<uint64_t>(ordersHandled / sinceReport)
+                      << " http/s=" << static_cast<uint64_t>(httpRequests / sinceReport) << std::endl;
+            framesSent = 0;
+            ordersHandled = 0;
+            httpRequests = 0;
+            lastReport = now;
+        }
+    }
+
+    void shutdown() {
+        std::cout << "shutting down" << std::endl;
+        timer->cancel();
+        websocketpp::lib::error_code ec;
+        server.stop_listening(ec);
+        for (const auto& entry : sessions) {
+            server.close(entry.first, websocketpp::close::status::going_away, "shutdown", ec);
+        }
+        server.stop();
+    }
+};
+
+int main(int argc, char** argv) {
+    MockOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--port") {
+            options.port = static_cast<uint16_t>(std::stoi(value));
+        } else if (flag == "--cert") {
+            options.cert = value;
+        } else if (flag == "--key") {
+            options.key = value;
+        } else if (flag == "--book-rate") {
+            options.bookRate = std::stod(value);
+        } else if (flag == "--ticker-rate") {
+            options.tickerRate = std::stod(value);
+        } else if (flag == "--depth") {
+            options.depth = static_cast<size_t>(std::stoul(value));
+        } else if (flag == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (flag == "--client-id") {
+            options.clientId = value;
+        } else if (flag == "--client-secret") {
+            options.clientSecret = value;
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+    MockExchange exchange(options);
+    exchange.run();
+    return 0;
+}
@@ -0,0 +1,446 @@
+#include "MockMatchingEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static const double kEpsilon = 1e-9;
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+MockMatchingEngine::MockMatchingEngine(uint64_t seed, size_t depth)
+    : rng(seed), depth(depth == 0 ? 1 : depth), nextOrderId(1), nextTradeId(1) {}
+
+double MockMatchingEngine::randomAmount() {
+    std::uniform_int_distribution<int> lots(1, 100);
+    return 10.0 * lots(rng);
+}
+
+// Books are created on first use around a price picked from the instrument name.
+MockMatchingEngine::Book& MockMatchingEngine::bookFor(const std::string& instrument) {
+    auto it = books.find(instrument);
+    if (it != books.end()) {
+        return *it->second;
+    }
+    auto book = std::make_unique<Book>();
+    book->instrument = instrument;
+    double mid = 100.0;
+    book->tickSize = 0.01;
+    if (instrument.compare(0, 3, "BTC") == 0) {
+        mid = 60000.0;
+        book->tickSize = 0.5;
+    } else if (instrument.compare(0, 3, "ETH") == 0) {
+        mid = 3000.0;
+        book->tickSize = 0.05;
+    }
+    book->lastPrice = mid;
+    for (size_t i = 0; i < depth; ++i) {
+        book->bids[mid - book->tickSize * static_cast<double>(i + 1)].synthetic = randomAmount();
+        book->asks[mid + book->tickSize * static_cast<double>(i + 1)].synthetic = randomAmount();
+    }
+    book->changeId = 1;
+    Book& ref = *book;
+    books.emplace(instrument, std::move(book));
+    return ref;
+}
+
+template <typename Side>
+static void adjustSide(Side& side, std::vector<MockLevelChange>& pending, double price,
+                       double syntheticDelta, double userDelta) {
+    auto it = side.find(price);
+    bool existed = it != side.end();
+    auto& level = side[price];
+    level.synthetic = std::max(0.0, level.synthetic + syntheticDelta);
+    level.user = std::max(0.0, level.user + userDelta);
+    if (level.total() <= kEpsilon) {
+        side.erase(price);
+        if (existed) {
+            pending.push_back(MockLevelChange{"delete", price, 0.0});
+        }
+        return;
+    }
+    pending.push_back(MockLevelChange{existed ? "change" : "new", price, level.total()});
+}
+
+void MockMatchingEngine::adjust(Book& book, bool bid, double price, double syntheticDelta, double userDelta) {
+    if (bid) {
+        adjustSide(book.bids, book.pendingBids, price, syntheticDelta, userDelta);
+    } else {
+        adjustSide(book.asks, book.pendingAsks, price, syntheticDelta, userDelta);
+    }
+}
+
+// ------------------ Orders ------------------ //
+
+void MockMatchingEngine::fill(Book& book, MockOrder& order, double price, double amount,
+                              std::vector<MockTrade>& trades) {
+    int64_t now = nowMs();
+    order.averagePrice = (order.averagePrice * order.filledAmount + price * amount) / (order.filledAmount + amount);
+    order.filledAmount += amount;
+    order.lastUpdateTimestamp = now;
+    book.lastPrice = price;
+    trades.push_back(MockTrade{"MOCK-T-" + std::to_string(nextTradeId++), order.orderId, order.instrument,
+                               order.direction, price, amount, now, ++book.tradeSeq});
+
+    MockPosition& position = positionsByInstrument[order.instrument];
+    position.instrument = order.instrument;
+    double signedAmount = order.direction == "buy" ? amount : -amount;
+    if (position.size == 0.0 || (position.size > 0) == (signedAmount > 0)) {
+        double size = std::fabs(position.size);
+        position.averagePrice = (position.averagePrice * size + price * amount) / (size + amount);
+        position.size += signedAmount;
+        return;
+    }
+    double closing = std::min(amount, std::fabs(position.size));
+    position.realizedPnl += closing * (price - position.averagePrice) * (position.size > 0 ? 1.0 : -1.0);
+    double before = position.size;
+    position.size += signedAmount;
+    if (std::fabs(position.size) <= kEpsilon) {
+        position.size = 0.0;
+        position.averagePrice = 0.0;
+    } else if ((before > 0) != (position.size > 0)) {
+        position.averagePrice = price;
+    }
+}
+
+void MockMatchingEngine::rest(Book& book, const MockOrder& order) {
+    double remaining = order.amount - order.filledAmount;
+    adjust(book, order.direction == "buy", order.price, 0.0, remaining);
+    book.openOrders.push_back(order.orderId);
+}
+
+void MockMatchingEngine::unrest(Book& book, const MockOrder& order) {
+    double remaining = order.amount - order.filledAmount;
+    adjust(book, order.direction == "buy", order.price, 0.0, -remaining);
+    book.openOrders.erase(std::remove(book.openOrders.begin(), book.openOrders.end(), order.orderId),
+                          book.openOrders.end());
+}
+
+// Takes synthetic liquidity only, so our own resting orders never trade with each other.
+MockOrderResult MockMatchingEngine::match(Book& book, MockOrder& order) {
+    MockOrderResult result;
+    bool buy = order.direction == "buy";
+    bool limit = order.orderType == "limit";
+    double remaining = order.amount - order.filledAmount;
+    if (buy) {
+        auto it = book.asks.begin();
+        while (remaining > kEpsilon && it != book.asks.end()) {
+            double price = it->first;
+            if (limit && price > order.price) {
+                break;
+            }
+            double take = std::min(remaining, it->second.synthetic);
+            ++it;
+            if (take <= kEpsilon) {
+                continue;
+            }
+            adjust(book, false, price, -take, 0.0);
+            fill(book, order, price, take, result.trades);
+            remaining -= take;
+        }
+    } else {
+        auto it = book.bids.begin();
+        while (remaining > kEpsilon && it != book.bids.end()) {
+            double price = it->first;
+            if (limit && price < order.price) {
+                break;
+            }
+            double take = std::min(remaining, it->second.synthetic);
+            ++it;
+            if (take <= kEpsilon) {
+                continue;
+            }
+            adjust(book, true, price, -take, 0.0);
+            fill(book, order, price, take, result.trades);
+            remaining -= take;
+        }
+    }
+
+    if (remaining <= kEpsilon) {
+        order.orderState = "filled";
+    } else if (limit) {
+        order.orderState = "open";
+        rest(book, order);
+    } else {
+        // Market orders do not rest; whatever the book could not fill is cancelled.
+        order.orderState = order.filledAmount > 0 ? "filled" : "cancelled";
+    }
+    result.order = order;
+    return result;
+}
+
+MockOrderResult MockMatchingEngine::placeOrder(const std::string& instrument, const std::string& direction,
+                                               const std::string& orderType, double amount, double price,
+                                               const std::string& label) {
+    MockOrderResult result;
+    if (amount <= 0 || (direction != "buy" && direction != "sell") ||
+        (orderType != "limit" && orderType != "market") || (orderType == "limit" && price <= 0)) {
+        result.errorCode = -32602;
+        result.error = "Invalid params";
+        return result;
+    }
+    Book& book = bookFor(instrument);
+    MockOrder order;
+    order.orderId = "MOCK-" + std::to_string(nextOrderId++);
+    order.instrument = instrument;
+    order.direction = direction;
+    order.orderType = orderType;
+    order.label = label;
+    order.price = orderType == "limit" ? std::round(price / book.tickSize) * book.tickSize : 0.0;
+    order.amount = amount;
+    order.creationTimestamp = nowMs();
+    order.lastUpdateTimestamp = order.creationTimestamp;
+    result = match(book, order);
+    orders[order.orderId] = order;
+    return result;
+}
+
+MockOrderResult MockMatchingEngine::editOrder(const std::string& orderId, double amount, double price) {
+    MockOrderResult result;
+    auto it = orders.find(orderId);
+    if (it == orders.end() || it->second.orderState != "open") {
+        result.errorCode = 11044;
+        result.error = "not_open_order";
+        return result;
+    }
+    MockOrder& order = it->second;
+    if (amount <= order.filledAmount || price <= 0) {
+        result.errorCode = -32602;
+        result.error = "Invalid params";
+        return result;
+    }
+    Book& book = bookFor(order.instrument);
+    unrest(book, order);
+    order.amount = amount;
+    order.price = std::round(price / book.tickSize) * book.tickSize;
+    order.lastUpdateTimestamp = nowMs();
+    return match(book, order);
+}
+
+MockOrderResult MockMatchingEngine::cancelOrder(const std::string& orderId) {
+    MockOrderResult result;
+    auto it = orders.find(orderId);
+    if (it == orders.end() || it->second.orderState != "open") {
+        result.errorCode = 11044;
+        result.error = "not_open_order";
+        return result;
+    }
+    MockOrder& order = it->second;
+    unrest(bookFor(order.instrument), order);
+    order.orderState = "cancelled";
+    order.lastUpdateTimestamp = nowMs();
+    result.order = order;
+    return result;
+}
+
+std::vector<MockPosition> MockMatchingEngine::positions(const std::string& currency) const {
+    std::vector<MockPosition> out;
+    for (const auto& entry : positionsByInstrument) {
+        if (currency.empty() || entry.first.compare(0, currency.size() + 1, currency + "-") == 0) {
+            out.push_back(entry.second);
+        }
+    }
+    return out;
+}
+
+MockPosition MockMatchingEngine::position(const std::string& instrument) const {
+    auto it = positionsByInstrument.find(instrument);
+    if (it != positionsByInstrument.end()) {
+        return it->second;
+    }
+    MockPosition empty;
+    empty.instrument = instrument;
+    return empty;
+}
+
+std::vector<MockOrder> MockMatchingEngine::openOrders(const std::string& currency) const {
+    std::vector<MockOrder> out;
+    for (const auto& entry : orders) {
+        const MockOrder& order = entry.second;
+        if (order.orderState == "open" &&
+            (currency.empty() || order.instrument.compare(0, currency.size() + 1, currency + "-") == 0)) {
+            out.push_back(order);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const MockOrder& a, const MockOrder& b) {
+        return a.creationTimestamp < b.creationTimestamp;
+    });
+    return out;
+}
+
+bool MockMatchingEngine::findOrder(const std::string& orderId, MockOrder& out) const {
+    auto it = orders.find(orderId);
+    if (it == orders.end()) {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+// ------------------ Market data ------------------ //
+
+void MockMatchingEngine::tick(const std::string& instrument) {
+    Book& book = bookFor(instrument);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    bool bidSide = uniform(rng) < 0.5;
+
+    if (uniform(rng) < 0.8) {
+        // Resize one level's synthetic liquidity.
+        size_t count = bidSide ? book.bids.size() : book.asks.size();
+        if (count == 0) {
+            return;
+        }
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        size_t index = pick(rng);
+        double price;
+        double synthetic;
+        if (bidSide) {
+            auto it = std::next(book.bids.begin(), static_cast<long>(index));
+            price = it->first;
+            synthetic = it->second.synthetic;
+        } else {
+            auto it = std::next(book.asks.begin(), static_cast<long>(index));
+            price = it->first;
+            synthetic = it->second.synthetic;
+        }
+        adjust(book, bidSide, price, randomAmount() - synthetic, 0.0);
+    } else if (!book.bids.empty() && !book.asks.empty()) {
+        // Move the market one tick: the synthetic side trades away the best
+        // opposite level and quotes one tick further in.
+        double tick = book.tickSize;
+        double worstBid = book.bids.rbegin()->first;
+        double worstAsk = book.asks.rbegin()->first;
+        if (bidSide) {
+            double bestAsk = book.asks.begin()->first;
+            double newBid = book.bids.begin()->first + tick;
+            adjust(book, false, bestAsk, -book.asks.begin()->second.synthetic, 0.0);
+            adjust(book, true, newBid, randomAmount(), 0.0);
+            adjust(book, false, worstAsk + tick, randomAmount(), 0.0);
+            adjust(book, true, worstBid, -book.bids.rbegin()->second.synthetic, 0.0);
+            book.lastPrice = bestAsk;
+        } else {
+            double bestBid = book.bids.begin()->first;
+            double newAsk = book.asks.begin()->first - tick;
+            adjust(book, true, bestBid, -book.bids.begin()->second.synthetic, 0.0);
+            adjust(book, false, newAsk, randomAmount(), 0.0);
+            adjust(book, true, worstBid - tick, randomAmount(), 0.0);
+            adjust(book, false, worstAsk, -book.asks.rbegin()->second.synthetic, 0.0);
+            book.lastPrice = bestBid;
+        }
+    }
+    replenish(book);
+    crossRestingOrders(book);
+}
+
+// Keep each side at 'depth' levels: refill thinned sides at their far end
+// (or next to the other side when empty) and drop surplus far levels.
+void MockMatchingEngine::replenish(Book& book) {
+    double tick = book.tickSize;
+    while (book.bids.size() < depth) {
+        double price = !book.bids.empty() ? book.bids.rbegin()->first - tick
+                     : !book.asks.empty() ? book.asks.begin()->first - tick : book.lastPrice - tick;
+        adjust(book, true, price, randomAmount(), 0.0);
+    }
+    while (book.asks.size() < depth) {
+        double price = !book.asks.empty() ? book.asks.rbegin()->first + tick
+                     : !book.bids.empty() ? book.bids.begin()->first + tick : book.lastPrice + tick;
+        adjust(book, false, price, randomAmount(), 0.0);
+    }
+    while (book.bids.size() > depth && book.bids.rbegin()->second.user <= kEpsilon) {
+        adjust(book, true, book.bids.rbegin()->first, -book.bids.rbegin()->second.synthetic, 0.0);
+    }
+    while (book.asks.size() > depth && book.asks.rbegin()->second.user <= kEpsilon) {
+        adjust(book, false, book.asks.rbegin()->first, -book.asks.rbegin()->second.synthetic, 0.0);
+    }
+}
+
+// Resting orders fill in full at their limit once synthetic liquidity is
+// quoted through them.
+void MockMatchingEngine::crossRestingOrders(Book& book) {
+    double bestSyntheticBid = 0.0;
+    for (const auto& level : book.bids) {
+        if (level.second.synthetic > kEpsilon) {
+            bestSyntheticBid = level.first;
+            break;
+        }
+    }
+    double bestSyntheticAsk = 0.0;
+    for (const auto& level : book.asks) {
+        if (level.second.synthetic > kEpsilon) {
+            bestSyntheticAsk = level.first;
+            break;
+        }
+    }
+    std::vector<std::string> open = book.openOrders;
+    for (const auto& orderId : open) {
+        MockOrder& order = orders[orderId];
+        bool crossed = order.direction == "buy" ? (bestSyntheticAsk > 0 && bestSyntheticAsk <= order.price)
+                                                : (bestSyntheticBid > 0 && bestSyntheticBid >= order.price);
+        if (!crossed) {
+            continue;
+        }
+        unrest(book, order);
+        fill(book, order, order.price, order.amount - order.filledAmount, restingFills);
+        order.orderState = "filled";
+    }
+}
+
+MockBookDelta MockMatchingEngine::snapshot(const std::string& instrument) {
+    Book& book = bookFor(instrument);
+    MockBookDelta out;
+    out.instrument = instrument;
+    out.isSnapshot = true;
+    out.changeId = book.changeId;
+    out.timestamp = nowMs();
+    for (const auto& level : book.bids) {
+        out.bids.push_back(MockLevelChange{"new", level.first, level.second.total()});
+    }
+    for (const auto& level : book.asks) {
+        out.asks.push_back(MockLevelChange{"new", level.first, level.second.total()});
+    }
+    return out;
+}
+
+bool MockMatchingEngine::takeDelta(const std::string& instrument, MockBookDelta& out) {
+    Book& book = bookFor(instrument);
+    if (book.pendingBids.empty() && book.pendingAsks.empty()) {
+        return false;
+    }
+    out.instrument = instrument;
+    out.isSnapshot = false;
+    out.prevChangeId = book.changeId;
+    out.changeId = ++book.changeId;
+    out.timestamp = nowMs();
+    out.bids.swap(book.pendingBids);
+    out.asks.swap(book.pendingAsks);
+    book.pendingBids.clear();
+    book.pendingAsks.clear();
+    return true;
+}
+
+MockTicker MockMatchingEngine::ticker(const std::string& instrument) {
+    Book& book = bookFor(instrument);
+    MockTicker out{};
+    out.instrument = instrument;
+    out.timestamp = nowMs();
+    if (!book.bids.empty()) {
+        out.bestBidPrice = book.bids.begin()->first;
+        out.bestBidAmount = book.bids.begin()->second.total();
+    }
+    if (!book.asks.empty()) {
+        out.bestAskPrice = book.asks.begin()->first;
+        out.bestAskAmount = book.asks.begin()->second.total();
+    }
+    out.lastPrice = book.lastPrice;
+    out.markPrice = out.bestBidPrice > 0 && out.bestAskPrice > 0 ? (out.bestBidPrice + out.bestAskPrice) / 2
+                                                                 : book.lastPrice;
+    return out;
+}
+
+std::vector<MockTrade> MockMatchingEngine::takeRestingFills() {
+    std::vector<MockTrade> out;
+    out.swap(restingFills);
+    return out;
+}
@@ -0,0 +1,134 @@
+#include "OrderBook.h"
+#include <algorithm>
+#include <string_view>
+
+OrderBook::OrderBook(const std::string& instrument, size_t levelCapacity)
+    : instrument(instrument), changeId(0), timestamp(0), valid(false)
+{
+    bids.reserve(levelCapacity);
+    asks.reserve(levelCapacity);
+    publish();
+}
+
+void OrderBook::invalidate() {
+    valid = false;
+    publish();
+}
+
+// Both sides keep the best price at the back, so the ordering predicate is
+// "worse than": lower for bids, higher for asks.
+void OrderBook::applySide(std::vector<PriceLevel>& side, const BookLevelUpdate* levels, size_t count, bool isBid) {
+    for (size_t i = 0; i < count; ++i) {
+        const BookLevelUpdate& lvl = levels[i];
+        auto it = std::lower_bound(side.begin(), side.end(), lvl.price,
+            [isBid](const PriceLevel& l, double price) {
+                return isBid ? l.price < price : l.price > price;
+            });
+        bool found = (it != side.end() && it->price == lvl.price);
+
+        if (lvl.action == BookAction::DELETE || lvl.amount == 0.0) {
+            if (found) {
+                side.erase(it);
+            }
+        } else if (found) {
+            it->amount = lvl.amount;
+        } else {
+            side.insert(it, PriceLevel{lvl.price, lvl.amount});
+        }
+    }
+}
+
+BookApplyResult OrderBook::apply(const BookUpdate& update) {
+    if (update.isSnapshot) {
+        bids.clear();
+        asks.clear();
+    } else if (!valid) {
+        return BookApplyResult::AWAITING_SNAPSHOT;
+    } else if (update.prevChangeId != changeId) {
+        valid = false;
+        publish();
+        return BookApplyResult::SEQUENCE_GAP;
+    }
+
+    applySide(bids, update.bids, update.bidCount, true);
+    applySide(asks, update.asks, update.askCount, false);
+    changeId = update.changeId;
+    timestamp = update.timestamp;
+    valid = true;
+    publish();
+    return BookApplyResult::APPLIED;
+}
+
+void OrderBook::publish() {
+    TopOfBook t{};
+    t.changeId = changeId;
+    t.timestamp = timestamp;
+    t.valid = valid;
+    if (!bids.empty()) {
+        t.bidPrice = bids.back().price;
+        t.bidAmount = bids.back().amount;
+    }
+    if (!asks.empty()) {
+        t.askPrice = asks.back().price;
+        t.askAmount = asks.back().amount;
+    }
+    top.store(t);
+
+    BookDepth d{};
+    d.changeId = changeId;
+    d.timestamp = timestamp;
+    d.valid = valid;
+    d.bidCount = std::min(bids.size(), kPublishedDepth);
+    d.askCount = std::min(asks.size(), kPublishedDepth);
+    for (size_t i = 0; i < d.bidCount; ++i) {
+        d.bids[i] = bids[bids.size() - 1 - i];
+    }
+    for (size_t i = 0; i < d.askCount; ++i) {
+        d.asks[i] = asks[asks.size() - 1 - i];
+    }
+    published.store(d);
+}
+
+// ------------------ OrderBookManager ------------------ //
+
+OrderBookManager::OrderBookManager(InstrumentRegistry& registry)
+    : registry(registry), byId(new std::atomic<OrderBook*>[kMaxInstruments])
+{
+    for (size_t i = 0; i < kMaxInstruments; ++i) {
+        byId[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+OrderBook* OrderBookManager::addBook(const std::string& instrument) {
+    InstrumentId id = registry.intern(instrument);
+    if (id == kNoInstrument) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(booksMutex);
+    OrderBook* existing = byId[id].load(std::memory_order_relaxed);
+    if (existing) {
+        return existing;
+    }
+    books.push_back(std::make_unique<OrderBook>(instrument));
+    byId[id].store(books.back().get(), std::memory_order_release);
+    return books.back().get();
+}
+
+OrderBook* OrderBookManager::find(const std::string& instrument) const {
+    return get(registry.find(instrument));
+}
+
+OrderBook* OrderBookManager::find(const char* instrument, size_t length) const {
+    return get(registry.find(std::string_view(instrument, length)));
+}
+
+void OrderBookManager::invalidateAll() {
+    forEach([](OrderBook& book) { book.invalidate(); });
+}
+
+void OrderBookManager::forEach(const std::function<void(OrderBook&)>& fn) const {
+    std::lock_guard<std::mutex> lock(booksMutex);
+    for (auto& book : books) {
+        fn(*book);
+    }
+}
@@ -0,0 +1,721 @@
+#include "OrderManager.h"
+#include "MessageParser.h"
+#include "WebsocketClient.h"
+#include "Logger.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+using json = nlohmann::json;
+
+static std::string_view textField(const json& object, const char* key) {
+    auto it = object.find(key);
+    if (it == object.end() || !it->is_string()) {
+        return {};
+    }
+    return it->get_ref<const std::string&>();
+}
+
+static double numberField(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number() ? it->get<double>() : 0.0;
+}
+
+static int64_t integerField(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number_integer() ? it->get<int64_t>() : 0;
+}
+
+// The update views into 'order', which must outlive it.
+static OrderUpdate decodeJsonOrder(const json& order) {
+    OrderUpdate update;
+    update.orderId = textField(order, "order_id");
+    update.label = textField(order, "label");
+    update.instrument = textField(order, "instrument_name");
+    update.orderState = textField(order, "order_state");
+    update.direction = textField(order, "direction");
+    update.orderType = textField(order, "order_type");
+    update.amount = numberField(order, "amount");
+    update.price = numberField(order, "price"); // "market_price" for market orders
+    update.filledAmount = numberField(order, "filled_amount");
+    update.averagePrice = numberField(order, "average_price");
+    update.createdAt = integerField(order, "creation_timestamp");
+    update.updatedAt = integerField(order, "last_update_timestamp");
+    return update;
+}
+
+// Streaming decode of one order object; nlohmann only for what the parser
+// rejects (escaped strings). The update views into 'text' or 'fallback'.
+static bool decodeOrder(MessageParser& parser, std::string_view text, OrderUpdate& out, json& fallback) {
+    if (parser.parseOrder(text, out)) {
+        return true;
+    }
+    fallback = json::parse(text, nullptr, false);
+    if (!fallback.is_object()) {
+        return false;
+    }
+    out = decodeJsonOrder(fallback);
+    return true;
+}
+
+static bool isArray(std::string_view text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    return first != std::string_view::npos && text[first] == '[';
+}
+
+static OrderState stateFor(const OrderUpdate& update) {
+    if (update.orderState == "filled") {
+        return OrderState::FILLED;
+    }
+    if (update.orderState == "cancelled") {
+        return OrderState::CANCELLED;
+    }
+    if (update.orderState == "rejected") {
+        return OrderState::REJECTED;
+    }
+    return update.filledAmount > 0.0 ? OrderState::PARTIALLY_FILLED : OrderState::OPEN;
+}
+
+static double openAmount(const ManagedOrder& order) {
+    return order.amount > order.filledAmount ? order.amount - order.filledAmount : 0.0;
+}
+
+static std::string_view orderIdKey(const ManagedOrder& order) { return order.orderId; }
+static std::string_view labelKey(const ManagedOrder& order) { return order.label; }
+
+static std::string base36(uint64_t value) {
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::string out;
+    do {
+        out.insert(out.begin(), digits[value % 36]);
+        value /= 36;
+    } while (value);
+    return out;
+}
+
+// ------------------ Construction ------------------ //
+
+OrderManager::OrderManager(InstrumentRegistry& registry, size_t capacity)
+    : registry(registry), capacity(capacity),
+      orders(new ManagedOrder[capacity]()),
+      inUse(new bool[capacity]()),
+      freeList(new uint32_t[capacity]),
+      freeCount(capacity),
+      finished(new uint64_t[kFinishedHistory]()),
+      expectedIn(new uint32_t[capacity]())
+{
+    // Popped from the back, so slot 0 is handed out first.
+    for (size_t i = 0; i < capacity; ++i) {
+        freeList[i] = static_cast<uint32_t>(capacity - 1 - i);
+    }
+    initIndex(byId, orderIdKey);
+    initIndex(byLabel, labelKey);
+    // Generated labels carry the start time so they do not repeat those of an earlier run.
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string prefix = "oms-" + base36(static_cast<uint64_t>(seconds)) + "-";
+    labelPrefixLength = std::min(prefix.size(), sizeof(labelPrefix));
+    std::memcpy(labelPrefix, prefix.data(), labelPrefixLength);
+    counters.capacity = capacity;
+}
+
+OrderManager::OrderManager(WebsocketClient& client, size_t capacity)
+    : OrderManager(client.instruments(), capacity)
+{
+    this->client = &client;
+    client.setOrderManager(this);
+    client.channels().onUserOrders(kNoInstrument, [this](const ChannelDataEvent& event) {
+        applyOrders(event.data);
+    });
+    client.channels().onUserChanges([this](const UserChangesEvent& event) {
+        MessageParser parser;
+        std::string_view updates;
+        if (parser.findMember(event.data, "orders", updates)) {
+            applyOrders(updates);
+        }
+    });
+}
+
+OrderManager::~OrderManager() {
+    if (client) {
+        client->setOrderManager(nullptr);
+    }
+}
+
+void OrderManager::initIndex(Index& index, std::string_view (*key)(const ManagedOrder&)) {
+    size_t buckets = 16;
+    while (buckets < capacity * 2) {
+        buckets <<= 1;
+    }
+    index.buckets.reset(new uint32_t[buckets]);
+    std::fill(index.buckets.get(), index.buckets.get() + buckets, kEmpty);
+    index.mask = buckets - 1;
+    index.key = key;
+}
+
+void OrderManager::start() {
+    if (!client) {
+        return;
+    }
+    client->subscribeToUserChanges();
+    client->onAuthenticated([this]() { reconcile(); });
+    if (client->isAuthenticated()) {
+        reconcile();
+    }
+}
+
+// The snapshot is taken after every order marked here was known to the
+// exchange, so one it does not list has ended. PENDING_NEW orders may still
+// be on their way and are not marked.
+void OrderManager::reconcile() {
+    if (!client) {
+        return;
+    }
+    uint32_t round = beginReconcile();
+    if (round == 0) {
+        return;
+    }
+    client->requestOpenOrders([this, round](const RpcResponse& response) {
+        if (finishReconcile(round, response.ok, response.body)) {
+            reconcile();
+        }
+    });
+}
+
+uint32_t OrderManager::beginReconcile() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (reconciling) {
+        reconcileAgain = true;
+        return 0;
+    }
+    reconciling = true;
+    uint32_t round = ++reconcileRound;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (inUse[i] && orders[i].state != OrderState::PENDING_NEW) {
+            expectedIn[i] = round;
+        }
+    }
+    return round;
+}
+
+bool OrderManager::finishReconcile(uint32_t round, bool ok, std::string_view openOrders) {
+    bool loaded = ok && isArray(openOrders);
+    size_t applied = loaded ? applyOrders(openOrders) : 0;
+    size_t closed = 0;
+    bool again;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (loaded) {
+            closed = settleMissing(round);
+        }
+        reconciling = false;
+        again = reconcileAgain;
+        reconcileAgain = false;
+    }
+    if (loaded) {
+        orderLogger->info("[Orders] Reconciled: {} open order(s) loaded, {} closed as no longer open",
+                          applied, closed);
+    } else {
+        systemLogger->error("[Orders] Open orders request failed: {}", openOrders);
+    }
+    return again;
+}
+
+// With the mutex held. A new order the snapshot does not list either never
+// reached the exchange or ended before it; both count as rejected. Fills
+// among them still reach the positions through their own snapshot.
+size_t OrderManager::settleMissing(uint32_t round) {
+    size_t closed = 0;
+    for (uint32_t slot = 0; slot < capacity; ++slot) {
+        if (!inUse[slot] || expectedIn[slot] != round) {
+            continue;
+        }
+        ManagedOrder& order = orders[slot];
+        double open = openAmount(order);
+        order.state = order.state == OrderState::UNKNOWN ? OrderState::REJECTED : OrderState::CANCELLED;
+        ++(order.state == OrderState::REJECTED ? counters.rejected : counters.cancelled);
+        systemLogger->warn("[Orders] Order {} ({}) is not open on the exchange; closed as {}",
+                           order.orderId[0] ? order.orderId : "without id", order.label, stateName(order.state));
+        reportExposure(order, open, 1);
+        retire(slot);
+        ++closed;
+    }
+    return closed;
+}
+
+// ------------------ Slots and indexes ------------------ //
+
+uint32_t OrderManager::allocate() {
+    if (freeCount == 0) {
+        return kEmpty;
+    }
+    uint32_t slot = freeList[--freeCount];
+    inUse[slot] = true;
+    expectedIn[slot] = 0;
+    ManagedOrder& order = orders[slot];
+    uint32_t generation = order.generation;
+    order = ManagedOrder{};
+    order.generation = generation;
+    order.instrument = kNoInstrument;
+    return slot;
+}
+
+void OrderManager::retire(uint32_t slot) {
+    ManagedOrder& order = orders[slot];
+    if (order.orderId[0]) {
+        erase(byId, slot);
+        uint64_t key = hash(order.orderId);
+        finished[key & (kFinishedHistory - 1)] = key;
+    }
+    if (order.label[0]) {
+        erase(byLabel, slot);
+    }
+    ++order.generation;
+    inUse[slot] = false;
+    freeList[freeCount++] = slot;
+}
+
+bool OrderManager::recentlyFinished(std::string_view orderId) const {
+    uint64_t key = hash(orderId);
+    return finished[key & (kFinishedHistory - 1)] == key;
+}
+
+uint32_t OrderManager::resolve(OrderHandle handle) const {
+    if (handle == kNoOrder) {
+        return kEmpty;
+    }
+    uint32_t slot = static_cast<uint32_t>(handle);
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+    if (slot >= capacity || !inUse[slot] || orders[slot].generation != generation) {
+        return kEmpty;
+    }
+    return slot;
+}
+
+uint32_t OrderManager::lookup(const Index& index, std::string_view key) const {
+    if (key.empty()) {
+        return kEmpty;
+    }
+    for (size_t i = hash(key) & index.mask;; i = (i + 1) & index.mask) {
+        uint32_t slot = index.buckets[i];
+        if (slot == kEmpty || index.key(orders[slot]) == key) {
+            return slot;
+        }
+    }
+}
+
+void OrderManager::insert(Index& index, uint32_t slot) {
+    size_t i = hash(index.key(orders[slot])) & index.mask;
+    while (index.buckets[i] != kEmpty) {
+        i = (i + 1) & index.mask;
+    }
+    index.buckets[i] = slot;
+}
+
+// Backward-shift deletion: later entries of the probe run move into the gap
+// unless their home bucket lies between the gap and their current position.
+void OrderManager::erase(Index& index, uint32_t slot) {
+    size_t i = hash(index.key(orders[slot])) & index.mask;
+    while (index.buckets[i] != slot) {
+        if (index.buckets[i] == kEmpty) {
+            return;
+        }
+        i = (i + 1) & index.mask;
+    }
+    for (size_t j = (i + 1) & index.mask; index.buckets[j] != kEmpty; j = (j + 1) & index.mask) {
+        size_t home = hash(index.key(orders[index.buckets[j]])) & index.mask;
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            index.buckets[i] = index.buckets[j];
+            i = j;
+        }
+    }
+    index.buckets[i] = kEmpty;
+}
+
+bool OrderManager::copyKey(char* out, size_t capacity, std::string_view value) {
+    if (value.size() >= capacity) {
+        out[0] = '\0';
+        return false;
+    }
+    if (!value.empty()) {
+        std::memcpy(out, value.data(), value.size());
+    }
+    out[value.size()] = '\0';
+    return true;
+}
+
+uint64_t OrderManager::hash(std::string_view key) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+// ------------------ Transitions ------------------ //
+
+OrderHandle OrderManager::submit(OrderRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (request.action != OrderAction::PLACE) {
+        uint32_t slot = lookup(byId, request.orderId);
+        if (slot == kEmpty) {
+            return kNoOrder;
+        }
+        ManagedOrder& order = orders[slot];
+        if (order.state != OrderState::PENDING_EDIT && order.state != OrderState::PENDING_CANCEL) {
+            order.restingState = order.state;
+        }
+        if (request.action == OrderAction::EDIT) {
+            order.state = OrderState::PENDING_EDIT;
+            order.pendingAmount = request.amount;
+            order.pendingPrice = request.price;
+        } else {
+            order.state = OrderState::PENDING_CANCEL;
+        }
+        return (static_cast<OrderHandle>(order.generation) << 32) | slot;
+    }
+
+    uint32_t slot = allocate();
+    if (slot == kEmpty) {
+        ++counters.untracked;
+        systemLogger->error("[Orders] Order table full ({} orders), not tracking new order on {}",
+                            capacity, request.instrument);
+        // Nothing could release the risk reservation later, so it goes now.
+        if (request.riskReserved && exposureListener) {
+            exposureListener(ExposureChange{registry.find(request.instrument), request.side == "buy", -1,
+                                            -request.amount, request.price, -request.reservedNotional});
+        }
+        return kNoOrder;
+    }
+    ManagedOrder& order = orders[slot];
+    if (request.label.empty()) {
+        // Formatted in the slot; the request's copy reuses its own buffer.
+        std::memcpy(order.label, labelPrefix, labelPrefixLength);
+        char* last = std::to_chars(order.label + labelPrefixLength, order.label + kLabelCapacity - 1,
+                                   nextLabel++).ptr;
+        *last = '\0';
+        request.label.assign(order.label, last - order.label);
+    } else if (!copyKey(order.label, kLabelCapacity, request.label) || lookup(byLabel, request.label) != kEmpty) {
+        // Still tracked, but only the exchange's order id can find it.
+        systemLogger->error("[Orders] Label '{}' is too long or already in use", request.label);
+        order.label[0] = '\0';
+    }
+    if (order.label[0]) {
+        insert(byLabel, slot);
+    }
+    order.instrument = registry.find(request.instrument);
+    if (order.instrument == kNoInstrument) {
+        order.instrument = registry.intern(request.instrument);
+    }
+    order.state = OrderState::PENDING_NEW;
+    order.restingState = OrderState::PENDING_NEW;
+    order.buy = request.side == "buy";
+    order.limit = request.orderType == "limit";
+    order.amount = request.amount;
+    order.price = request.price;
+    ++counters.submitted;
+    if (request.riskReserved) {
+        order.reserved = true;
+        order.reservedNotional = request.reservedNotional;
+    } else {
+        reportExposure(order, 0.0, 0);
+    }
+    return (static_cast<OrderHandle>(order.generation) << 32) | slot;
+}
+
+void OrderManager::onResponse(OrderHandle handle, OrderAction action, bool ok, std::string_view result,
+                              bool transportFailure) {
+    // buy, sell and edit answer {"order": {...}, "trades": [...]}; cancel answers the order itself.
+    // Decoded before the lock is taken.
+    MessageParser parser;
+    std::string_view text = action == OrderAction::CANCEL ? result : std::string_view();
+    if (ok && action != OrderAction::CANCEL && !parser.findMember(result, "order", text)) {
+        text = std::string_view();
+    }
+    OrderUpdate update;
+    json fallback;
+    bool decoded = ok && !text.empty() && decodeOrder(parser, text, update, fallback);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    uint32_t slot = resolve(handle);
+    if (!ok && transportFailure) {
+        if (slot == kEmpty) {
+            return;
+        }
+        // The exchange may have taken the request; its reports, or the next
+        // reconcile, tell. Until then the order keeps its reservation.
+        if (action == OrderAction::PLACE) {
+            if (orders[slot].state == OrderState::PENDING_NEW) {
+                orders[slot].state = OrderState::UNKNOWN;
+            }
+        } else if (orders[slot].state == OrderState::PENDING_EDIT || orders[slot].state == OrderState::PENDING_CANCEL) {
+            orders[slot].state = orders[slot].restingState;
+        }
+        // A WebSocket session reconciles once it is back; a REST failure has no such event.
+        bool now = client && client->isAuthenticated();
+        lock.unlock();
+        if (now) {
+            reconcile();
+        }
+        return;
+    }
+    if (!ok) {
+        if (slot == kEmpty) {
+            return;
+        }
+        if (action == OrderAction::PLACE) {
+            double open = openAmount(orders[slot]);
+            orders[slot].state = OrderState::REJECTED;
+            ++counters.rejected;
+            reportExposure(orders[slot], open, 1);
+            retire(slot);
+        } else {
+            orders[slot].state = orders[slot].restingState;
+        }
+        return;
+    }
+
+    if (decoded) {
+        // Bind the exchange's id unless a notification has done so already.
+        if (slot != kEmpty && action == OrderAction::PLACE && !orders[slot].orderId[0] &&
+            lookup(byId, update.orderId) == kEmpty && copyKey(orders[slot].orderId, kOrderIdCapacity, update.orderId)) {
+            insert(byId, slot);
+        }
+        applyLocked(update);
+    }
+    // The acknowledged edit or cancel is no longer in flight; a final state has retired the slot already.
+    slot = resolve(handle);
+    if (slot != kEmpty && action != OrderAction::PLACE &&
+        (orders[slot].state == OrderState::PENDING_EDIT || orders[slot].state == OrderState::PENDING_CANCEL)) {
+        orders[slot].state = orders[slot].restingState;
+    }
+}
+
+size_t OrderManager::applyOrders(std::string_view data) {
+    MessageParser parser;
+    size_t applied = 0;
+    auto applyOne = [&](std::string_view text) {
+        OrderUpdate update;
+        json fallback;
+        if (decodeOrder(parser, text, update, fallback)) {
+            apply(update);
+            ++applied;
+        }
+    };
+    // user.orders.<instrument>.raw carries one order, the interval variants and get_open_orders an array.
+    if (isArray(data)) {
+        parser.forEachElement(data, applyOne);
+    } else {
+        applyOne(data);
+    }
+    return applied;
+}
+
+void OrderManager::apply(const OrderUpdate& update) {
+    std::lock_guard<std::mutex> lock(mutex);
+    applyLocked(update);
+}
+
+void OrderManager::applyLocked(const OrderUpdate& update) {
+    if (update.orderId.empty()) {
+        return;
+    }
+    OrderState next = stateFor(update);
+    uint32_t slot = lookup(byId, update.orderId);
+    bool adopted = false;
+    if (slot == kEmpty) {
+        // A notification ahead of the response: our order, known by its label.
+        uint32_t labelled = lookup(byLabel, update.label);
+        if (labelled != kEmpty && !orders[labelled].orderId[0] &&
+            copyKey(orders[labelled].orderId, kOrderIdCapacity, update.orderId)) {
+            insert(byId, labelled);
+            slot = labelled;
+        }
+    }
+    if (slot == kEmpty) {
+        if (isFinal(next) || recentlyFinished(update.orderId)) {
+            return;
+        }
+        // Placed elsewhere (another session, the web UI) or before this run.
+        slot = allocate();
+        ManagedOrder* order = slot != kEmpty ? &orders[slot] : nullptr;
+        if (!order || !copyKey(order->orderId, kOrderIdCapacity, update.orderId)) {
+            if (order) {
+                retire(slot);
+            }
+            ++counters.untracked;
+            return;
+        }
+        insert(byId, slot);
+        if (copyKey(order->label, kLabelCapacity, update.label) && order->label[0]) {
+            if (lookup(byLabel, update.label) == kEmpty) {
+                insert(byLabel, slot);
+            } else {
+                order->label[0] = '\0';
+            }
+        }
+        order->instrument = registry.find(update.instrument);
+        if (order->instrument == kNoInstrument && !update.instrument.empty()) {
+            order->instrument = registry.intern(update.instrument);
+        }
+        order->buy = update.direction == "buy";
+        order->limit = update.orderType == "limit";
+        order->state = OrderState::OPEN;
+        order->restingState = OrderState::OPEN;
+        adopted = true;
+    }
+
+    ManagedOrder& order = orders[slot];
+    expectedIn[slot] = 0;
+    // Notifications and responses can cross; never step back to an older report.
+    if (update.updatedAt != 0 && update.updatedAt < order.updatedAt) {
+        return;
+    }
+    double openBefore = adopted ? 0.0 : openAmount(order);
+    order.amount = update.amount;
+    if (update.price > 0.0) {
+        order.price = update.price;
+    }
+    order.filledAmount = update.filledAmount;
+    order.averagePrice = update.averagePrice;
+    if (update.createdAt != 0) {
+        order.createdAt = update.createdAt;
+    }
+    if (update.updatedAt != 0) {
+        order.updatedAt = update.updatedAt;
+    }
+
+    if (isFinal(next)) {
+        order.state = next;
+        switch (next) {
+            case OrderState::FILLED: ++counters.filled; break;
+            case OrderState::CANCELLED: ++counters.cancelled; break;
+            default: ++counters.rejected; break;
+        }
+        reportExposure(order, openBefore, adopted ? 0 : 1);
+        retire(slot);
+        return;
+    }
+    if (order.state == OrderState::PENDING_EDIT || order.state == OrderState::PENDING_CANCEL) {
+        order.restingState = next;
+    } else {
+        order.state = next;
+    }
+    reportExposure(order, openBefore, adopted ? 0 : 1);
+}
+
+// Orders the listener has not counted yet (submitted without a risk check,
+// or adopted before it was set) enter with their whole unfilled amount.
+// Decreases release the share of the order's recorded notional, and the last
+// one all that is left, so every order releases exactly what was counted for
+// it whatever its price does in between.
+void OrderManager::reportExposure(ManagedOrder& order, double openBefore, int liveBefore) {
+    if (!exposureListener) {
+        return;
+    }
+    bool live = !isFinal(order.state);
+    double open = live ? openAmount(order) : 0.0;
+    int liveNow = live ? 1 : 0;
+    if (!order.reserved) {
+        if (!live) {
+            return;
+        }
+        openBefore = 0.0;
+        liveBefore = 0;
+        order.reserved = true;
+        order.reservedNotional = 0.0;
+    }
+    if (open == openBefore && liveNow == liveBefore) {
+        return;
+    }
+    ExposureChange change;
+    change.instrument = order.instrument;
+    change.buy = order.buy;
+    change.orders = liveNow - liveBefore;
+    change.amount = open - openBefore;
+    change.price = order.price > 0.0 ? order.price : order.averagePrice;
+    change.notional = 0.0;
+    if (change.amount < 0.0) {
+        double released = open > 0.0 && openBefore > 0.0 ? order.reservedNotional * (-change.amount / openBefore)
+                                                         : order.reservedNotional;
+        change.notional = -released;
+        order.reservedNotional -= released;
+    }
+    double counted = exposureListener(change);
+    if (change.amount > 0.0) {
+        order.reservedNotional += counted;
+    }
+    if (!live) {
+        order.reserved = false;
+        order.reservedNotional = 0.0;
+    }
+}
+
+// ------------------ Queries ------------------ //
+
+bool OrderManager::get(OrderHandle handle, ManagedOrder& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t slot = resolve(handle);
+    if (slot == kEmpty) {
+        return false;
+    }
+    out = orders[slot];
+    return true;
+}
+
+bool OrderManager::find(std::string_view orderId, ManagedOrder& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t slot = lookup(byId, orderId);
+    if (slot == kEmpty) {
+        return false;
+    }
+    out = orders[slot];
+    return true;
+}
+
+bool OrderManager::findByLabel(std::string_view label, ManagedOrder& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t slot = lookup(byLabel, label);
+    if (slot == kEmpty) {
+        return false;
+    }
+    out = orders[slot];
+    return true;
+}
+
+std::vector<ManagedOrder> OrderManager::liveOrders() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ManagedOrder> result;
+    result.reserve(capacity - freeCount);
+    for (size_t i = 0; i < capacity; ++i) {
+        if (inUse[i]) {
+            result.push_back(orders[i]);
+        }
+    }
+    return result;
+}
+
+OrderManagerStats OrderManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    OrderManagerStats out = counters;
+    out.live = capacity - freeCount;
+    return out;
+}
+
+const char* OrderManager::stateName(OrderState state) {
+    switch (state) {
+        case OrderState::PENDING_NEW: return "pending_new";
+        case OrderState::OPEN: return "open";
+        case OrderState::PARTIALLY_FILLED: return "partially_filled";
+        case OrderState::PENDING_EDIT: return "pending_edit";
+        case OrderState::PENDING_CANCEL: return "pending_cancel";
+        case OrderState::UNKNOWN: return "unknown";
+        case OrderState::FILLED: return "filled";
+        case OrderState::CANCELLED: return "cancelled";
+        case OrderState::REJECTED: return "rejected";
+    }
+    return "unknown";
+}
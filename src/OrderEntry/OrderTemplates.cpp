@@ -0,0 +1,216 @@
+#include "OrderTemplates.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// ------------------ Order requests ------------------ //
+
+OrderRequest OrderRequest::place(const std::string& instrument, double amount, const std::string& side,
+                                 const std::string& orderType, double price, const std::string& expiryDate,
+                                 double strikePrice, const std::string& optionType, const std::string& label) {
+    OrderRequest request;
+    request.action = OrderAction::PLACE;
+    request.instrument = instrument;
+    request.side = side;
+    request.orderType = orderType;
+    request.amount = amount;
+    request.price = price;
+    request.expiryDate = expiryDate;
+    request.strikePrice = strikePrice;
+    request.optionType = optionType;
+    request.label = label;
+    return request;
+}
+
+OrderRequest OrderRequest::cancel(const std::string& orderId) {
+    OrderRequest request;
+    request.action = OrderAction::CANCEL;
+    request.orderId = orderId;
+    return request;
+}
+
+OrderRequest OrderRequest::edit(const std::string& orderId, double newAmount, double newPrice) {
+    OrderRequest request;
+    request.action = OrderAction::EDIT;
+    request.orderId = orderId;
+    request.amount = newAmount;
+    request.price = newPrice;
+    return request;
+}
+
+// ------------------ Reference rendering ------------------ //
+
+// Placeholder for a templated field. nlohmann escapes the control character,
+// so it shows up in the dump as "\u0001<field>" and cannot clash with real text.
+static const char kMarker = '\x01';
+static const char* kMarkerText = "\"\\u0001";
+
+static json placeholder(uint8_t field) {
+    return json(std::string{kMarker, static_cast<char>('0' + field)});
+}
+
+// The message as the REST and WebSocket clients built it. With 'markers' set,
+// every per-order field is replaced by its placeholder; the structure (which
+// keys exist) still follows the request.
+static json messageJson(uint64_t id, const OrderRequest& request, bool markers) {
+    auto field = [markers](uint8_t slot, const json& value) { return markers ? placeholder(slot) : value; };
+    // Field numbering matches OrderMessageBuilder::Field.
+    const uint8_t ID = 1, AMOUNT = 2, PRICE = 3, STRIKE = 4, TYPE = 5, EXPIRY = 6, OPTION_TYPE = 7, ORDER_ID = 8, LABEL = 9;
+
+    json params;
+    const char* method;
+    if (request.action == OrderAction::CANCEL) {
+        method = "private/cancel";
+        params = { {"order_id", field(ORDER_ID, request.orderId)} };
+    } else if (request.action == OrderAction::EDIT) {
+        method = "private/edit";
+        params = {
+            {"order_id", field(ORDER_ID, request.orderId)},
+            {"amount", field(AMOUNT, request.amount)},
+            {"price", field(PRICE, request.price)}
+        };
+    } else {
+        method = request.side == "buy" ? "private/buy" : "private/sell";
+        params = {
+            {"instrument_name", request.instrument},
+            {"amount", field(AMOUNT, request.amount)},
+            {"type", field(TYPE, request.orderType)}
+        };
+        if (request.orderType == "limit") {
+            params["price"] = field(PRICE, request.price);
+        }
+        if (!request.expiryDate.empty()) {
+            params["expiry_date"] = field(EXPIRY, request.expiryDate);
+        }
+        if (request.strikePrice != 0.0) {
+            params["strike_price"] = field(STRIKE, request.strikePrice);
+        }
+        if (!request.optionType.empty()) {
+            params["option_type"] = field(OPTION_TYPE, request.optionType);
+        }
+        if (!request.label.empty()) {
+            params["label"] = field(LABEL, request.label);
+        }
+    }
+    return json{
+        {"jsonrpc", "2.0"},
+        {"id", field(ID, id)},
+        {"method", method},
+        {"params", params}
+    };
+}
+
+std::string OrderMessageBuilder::renderJson(uint64_t id, const OrderRequest& request) {
+    return messageJson(id, request, false).dump();
+}
+
+// ------------------ Templates ------------------ //
+
+OrderMessageBuilder::OrderMessageBuilder()
+    : cancelTemplate(compile(OrderRequest::cancel(""))),
+      editTemplate(compile(OrderRequest::edit("", 0.0, 0.0)))
+{
+}
+
+OrderMessageBuilder::MessageTemplate OrderMessageBuilder::compile(const OrderRequest& request) {
+    std::string text = messageJson(0, request, true).dump();
+    MessageTemplate segments;
+    size_t markerLength = std::strlen(kMarkerText);
+    size_t pos = 0;
+    for (;;) {
+        size_t marker = text.find(kMarkerText, pos);
+        if (marker == std::string::npos) {
+            segments.push_back(Segment{text.substr(pos), Field::NONE});
+            return segments;
+        }
+        Field field = static_cast<Field>(text[marker + markerLength] - '0');
+        segments.push_back(Segment{text.substr(pos, marker - pos), field});
+        pos = marker + markerLength + 2; // field digit and closing quote
+    }
+}
+
+const OrderMessageBuilder::MessageTemplate& OrderMessageBuilder::placeTemplate(const OrderRequest& request) const {
+    size_t variant = (request.side == "buy" ? 1 : 0) |
+                     (request.orderType == "limit" ? 2 : 0) |
+                     (request.expiryDate.empty() ? 0 : 4) |
+                     (request.strikePrice != 0.0 ? 8 : 0) |
+                     (request.optionType.empty() ? 0 : 16) |
+                     (request.label.empty() ? 0 : 32);
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = placeTemplates.find(request.instrument);
+    if (it == placeTemplates.end()) {
+        it = placeTemplates.emplace(request.instrument, std::make_unique<InstrumentTemplates>()).first;
+    }
+    std::unique_ptr<MessageTemplate>& slot = it->second->variants[variant];
+    if (!slot) {
+        slot = std::make_unique<MessageTemplate>(compile(request));
+    }
+    // Templates are never replaced, so the reference stays valid after unlocking.
+    return *slot;
+}
+
+void OrderMessageBuilder::render(std::string& out, uint64_t id, const OrderRequest& request) const {
+    // Strings written into the message verbatim must not need JSON escaping.
+    if (needsEscape(request.orderType) || needsEscape(request.expiryDate) ||
+        needsEscape(request.optionType) || needsEscape(request.orderId) ||
+        needsEscape(request.label)) {
+        out = renderJson(id, request);
+        return;
+    }
+    const MessageTemplate& segments = request.action == OrderAction::CANCEL ? cancelTemplate
+                                    : request.action == OrderAction::EDIT ? editTemplate
+                                    : placeTemplate(request);
+    out.clear();
+    for (const auto& segment : segments) {
+        out.append(segment.literal);
+        const std::string* text = nullptr;
+        switch (segment.field) {
+            case Field::NONE: break;
+            case Field::ID: appendUnsigned(out, id); break;
+            case Field::AMOUNT: appendDouble(out, request.amount); break;
+            case Field::PRICE: appendDouble(out, request.price); break;
+            case Field::STRIKE: appendDouble(out, request.strikePrice); break;
+            case Field::TYPE: text = &request.orderType; break;
+            case Field::EXPIRY: text = &request.expiryDate; break;
+            case Field::OPTION_TYPE: text = &request.optionType; break;
+            case Field::ORDER_ID: text = &request.orderId; break;
+            case Field::LABEL: text = &request.label; break;
+        }
+        if (text) {
+            out.push_back('"');
+            out.append(*text);
+            out.push_back('"');
+        }
+    }
+}
+
+// Anything nlohmann would escape (or reject): quotes, backslashes, control and non-ASCII bytes.
+bool OrderMessageBuilder::needsEscape(const std::string& value) {
+    for (char ch : value) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// nlohmann's own Grisu2 formatter, so numbers match dump() exactly.
+void OrderMessageBuilder::appendDouble(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out.append("null");
+        return;
+    }
+    char buffer[64];
+    char* end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, static_cast<size_t>(end - buffer));
+}
+
+void OrderMessageBuilder::appendUnsigned(std::string& out, uint64_t value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+}
@@ -0,0 +1,403 @@
+#include "PositionEngine.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+static double numberOr(const json& object, const char* key, double fallback) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number() ? it->get<double>() : fallback;
+}
+
+// A view into the parsed message, so looking up the instrument copies nothing.
+static std::string_view stringOr(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_string() ? std::string_view(it->get_ref<const std::string&>())
+                                                 : std::string_view();
+}
+
+PositionEngine::PositionEngine(WebsocketClient& client)
+    : client(client), registry(client.instruments()),
+      states(new Seqlock<PositionState>[kMaxInstruments]),
+      working(new PositionState[kMaxInstruments]()),
+      known(new bool[kMaxInstruments]()), tickerRequested(new std::atomic<bool>[kMaxInstruments]()),
+      trackedCount(0), grossPerInstrument(new double[kMaxInstruments]()), gross(0.0), currencyCount(0)
+{
+    client.channels().onUserChanges([this](const UserChangesEvent& event) {
+        if (snapshotsPending.load(std::memory_order_acquire) > 0) {
+            heldChanges.emplace_back(event.data);
+            return;
+        }
+        releaseHeldChanges();
+        applyChanges(event.data);
+    });
+    client.channels().onPortfolio([this](const PortfolioEvent& event) {
+        applyPortfolio(event.currency, event.data);
+    });
+}
+
+// Slots are registered before anything is subscribed, so the consumer thread
+// only ever appends currencies it discovers from instrument names afterwards.
+void PositionEngine::start(const std::vector<std::string>& currencies) {
+    for (const auto& currency : currencies) {
+        currencySlot(currency);
+    }
+    client.subscribeToUserChanges();
+    for (const auto& currency : currencies) {
+        client.subscribeToPortfolio(currency);
+    }
+    client.onAuthenticated([this]() { requestSnapshots(); });
+    if (client.isAuthenticated()) {
+        requestSnapshots();
+    }
+}
+
+// The answers run on the consumer thread, in order with the user.changes
+// stream; the held changes go once the last one is in. A request that could
+// not be sent fails on the calling thread, which must not touch them, so then
+// they wait for the next notification.
+void PositionEngine::requestSnapshots() {
+    std::vector<std::string> names = currencies();
+    snapshotsPending.fetch_add(static_cast<int>(names.size()), std::memory_order_acq_rel);
+    for (const auto& currency : names) {
+        client.requestCurrentPositions(currency, [this, currency](const RpcResponse& response) {
+            bool last = snapshotsPending.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            if (response.ok) {
+                applySnapshot(currency, response.body);
+            } else {
+                systemLogger->error("[Positions] Snapshot for {} failed: {}", currency, response.body);
+            }
+            if (last && (response.ok || response.transportFailure)) {
+                releaseHeldChanges();
+            }
+        });
+    }
+}
+
+void PositionEngine::applySnapshot(const std::string& currency, const std::string& body) {
+    json result = json::parse(body, nullptr, false);
+    if (!result.is_array()) {
+        return;
+    }
+    for (const auto& position : result) {
+        applyPosition(position);
+        // The snapshot is the only source of realized PnL before this session.
+        InstrumentId id;
+        if (PositionState* state = stateFor(stringOr(position, "instrument_name"), id)) {
+            state->realizedPnl = numberOr(position, "realized_profit_loss", state->realizedPnl);
+            publish(id);
+        }
+    }
+    positions->info("[Positions] Snapshot for {}: {} position(s)", currency, result.size());
+}
+
+void PositionEngine::releaseHeldChanges() {
+    if (heldChanges.empty()) {
+        return;
+    }
+    std::vector<std::string> held;
+    held.swap(heldChanges);
+    for (const auto& data : held) {
+        applyChanges(data);
+    }
+    positions->info("[Positions] Applied {} change(s) held during the snapshot", held.size());
+}
+
+ContractType PositionEngine::contractTypeFor(std::string_view instrument) {
+    bool option = instrument.size() > 2 && instrument[instrument.size() - 2] == '-' &&
+                  (instrument.back() == 'C' || instrument.back() == 'P');
+    if (option || instrument.find('_') != std::string_view::npos) {
+        return ContractType::LINEAR;
+    }
+    return ContractType::INVERSE;
+}
+
+std::string_view PositionEngine::settlementCurrency(std::string_view instrument) {
+    size_t dash = instrument.find('-');
+    std::string_view base = instrument.substr(0, dash);
+    size_t underscore = base.find('_');
+    return underscore == std::string_view::npos ? base : base.substr(underscore + 1);
+}
+
+uint8_t PositionEngine::findCurrency(std::string_view currency) const {
+    size_t count = currencyCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (currencyNames[i] == currency) {
+            return static_cast<uint8_t>(i);
+        }
+    }
+    return kNoCurrency;
+}
+
+uint8_t PositionEngine::currencySlot(std::string_view currency) {
+    uint8_t slot = findCurrency(currency);
+    if (slot != kNoCurrency) {
+        return slot;
+    }
+    size_t count = currencyCount.load(std::memory_order_relaxed);
+    if (count == kMaxCurrencies) {
+        systemLogger->error("[Positions] Currency limit reached, not tracking {}", currency);
+        return kNoCurrency;
+    }
+    currencyNames[count] = std::string(currency);
+    currencyCount.store(count + 1, std::memory_order_release);
+    return static_cast<uint8_t>(count);
+}
+
+void PositionEngine::track(std::string_view instrument) {
+    if (instrument.empty()) {
+        return;
+    }
+    InstrumentId id = registry.find(instrument);
+    if (id == kNoInstrument) {
+        id = registry.intern(instrument);
+    }
+    if (id != kNoInstrument && !tickerRequested[id].exchange(true, std::memory_order_relaxed)) {
+        // Live marks for unrealized PnL, subscribed from the I/O thread so
+        // the caller never builds or sends the request.
+        std::string name(instrument);
+        client.post([this, name]() { client.subscribe(ChannelKind::TICKER, {name}); });
+    }
+}
+
+PositionState* PositionEngine::stateFor(std::string_view instrument, InstrumentId& id) {
+    if (instrument.empty()) {
+        return nullptr;
+    }
+    id = registry.find(instrument);
+    if (id == kNoInstrument || !known[id]) {
+        return firstSight(instrument, id);
+    }
+    return &working[id];
+}
+
+// Once per instrument. Interning is left to track() where possible; one that
+// was never registered (an order placed elsewhere, a position from before
+// this session) is interned here, and its ticker subscription is handed to
+// the I/O thread either way.
+PositionState* PositionEngine::firstSight(std::string_view instrument, InstrumentId& id) {
+    if (id == kNoInstrument) {
+        id = registry.intern(instrument);
+    }
+    if (id == kNoInstrument) {
+        systemLogger->error("[Positions] Instrument limit reached, not tracking {}", instrument);
+        return nullptr;
+    }
+    PositionState& state = working[id];
+    known[id] = true;
+    state.contract = contractTypeFor(instrument);
+    state.currency = currencySlot(settlementCurrency(instrument));
+    state.lastMarkPrice = std::numeric_limits<double>::quiet_NaN();
+    state.lastTradeSeq = -1;
+    publish(id);
+    size_t count = trackedCount.load(std::memory_order_relaxed);
+    tracked[count] = id;
+    trackedCount.store(count + 1, std::memory_order_release);
+    if (!tickerRequested[id].exchange(true, std::memory_order_relaxed)) {
+        std::string name(instrument);
+        client.post([this, name]() { client.subscribe(ChannelKind::TICKER, {name}); });
+    }
+    return &state;
+}
+
+void PositionEngine::publish(InstrumentId instrument) {
+    const PositionState& state = working[instrument];
+    states[instrument].store(state);
+    double notional = state.contract == ContractType::INVERSE ? std::fabs(state.size)
+                                                              : std::fabs(state.size) * state.averagePrice;
+    grossTotal += notional - grossPerInstrument[instrument];
+    grossPerInstrument[instrument] = notional;
+    gross.store(grossTotal, std::memory_order_release);
+}
+
+// Average-cost accounting: a trade first closes against the open position,
+// realizing PnL on the closed amount, and any remainder opens at the trade price.
+void PositionEngine::applyTrade(const json& trade) {
+    InstrumentId id;
+    PositionState* state = stateFor(stringOr(trade, "instrument_name"), id);
+    if (!state) {
+        return;
+    }
+    int64_t seq = trade.value("trade_seq", int64_t(-1));
+    if (seq >= 0 && seq <= state->lastTradeSeq) {
+        return;
+    }
+    double price = numberOr(trade, "price", 0.0);
+    double amount = numberOr(trade, "amount", 0.0);
+    if (price <= 0.0 || amount <= 0.0) {
+        return;
+    }
+    double quantity = stringOr(trade, "direction") == "sell" ? -amount : amount;
+    bool inverse = state->contract == ContractType::INVERSE;
+
+    double size = state->size;
+    if (size != 0.0 && (size > 0.0) != (quantity > 0.0)) {
+        double closed = std::min(std::fabs(quantity), std::fabs(size));
+        double perUnit = inverse ? 1.0 / state->averagePrice - 1.0 / price : price - state->averagePrice;
+        state->realizedPnl += (size > 0.0 ? closed : -closed) * perUnit;
+        size += quantity > 0.0 ? closed : -closed;
+        quantity += quantity > 0.0 ? -closed : closed;
+        if (size == 0.0) {
+            state->averagePrice = 0.0;
+        }
+    }
+    if (quantity != 0.0) {
+        double total = std::fabs(size) + std::fabs(quantity);
+        if (inverse) {
+            state->averagePrice = total / (std::fabs(size) / (size != 0.0 ? state->averagePrice : price) +
+                                           std::fabs(quantity) / price);
+        } else {
+            state->averagePrice = (std::fabs(size) * state->averagePrice + std::fabs(quantity) * price) / total;
+        }
+        size += quantity;
+    }
+    state->size = size;
+
+    double fee = numberOr(trade, "fee", 0.0);
+    state->fees += fee;
+    state->realizedPnl -= fee;
+    state->lastMarkPrice = numberOr(trade, "mark_price", state->lastMarkPrice);
+    state->updatedAt = trade.value("timestamp", state->updatedAt);
+    if (seq >= 0) {
+        state->lastTradeSeq = seq;
+    }
+    publish(id);
+}
+
+// The exchange's own position record: size and average price are taken as
+// authoritative, realized PnL stays the engine's running sum.
+void PositionEngine::applyPosition(const json& position) {
+    InstrumentId id;
+    PositionState* state = stateFor(stringOr(position, "instrument_name"), id);
+    if (!state) {
+        return;
+    }
+    state->size = numberOr(position, "size", state->size);
+    state->averagePrice = state->size != 0.0 ? numberOr(position, "average_price", state->averagePrice) : 0.0;
+    state->lastMarkPrice = numberOr(position, "mark_price", state->lastMarkPrice);
+    publish(id);
+}
+
+// Trades before positions: the positions of the same notification already
+// include those trades and overwrite whatever rounding the replay introduced.
+void PositionEngine::applyChanges(std::string_view data) {
+    json changes = json::parse(data, nullptr, false);
+    if (!changes.is_object()) {
+        return;
+    }
+    auto trades = changes.find("trades");
+    if (trades != changes.end() && trades->is_array()) {
+        for (const auto& trade : *trades) {
+            applyTrade(trade);
+        }
+    }
+    auto updates = changes.find("positions");
+    if (updates != changes.end() && updates->is_array()) {
+        for (const auto& position : *updates) {
+            applyPosition(position);
+        }
+    }
+}
+
+void PositionEngine::applyPortfolio(std::string_view currency, std::string_view data) {
+    json portfolio = json::parse(data, nullptr, false);
+    if (!portfolio.is_object()) {
+        return;
+    }
+    std::string name(currency);
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    uint8_t slot = currencySlot(name);
+    if (slot == kNoCurrency) {
+        return;
+    }
+    AccountState account{};
+    account.equity = numberOr(portfolio, "equity", 0.0);
+    account.balance = numberOr(portfolio, "balance", 0.0);
+    account.availableFunds = numberOr(portfolio, "available_funds", 0.0);
+    account.initialMargin = numberOr(portfolio, "initial_margin", 0.0);
+    account.maintenanceMargin = numberOr(portfolio, "maintenance_margin", 0.0);
+    account.totalPnl = numberOr(portfolio, "total_pl", 0.0);
+    account.valid = true;
+    accounts[slot].store(account);
+}
+
+double PositionEngine::markPrice(InstrumentId instrument, const PositionState& state) const {
+    double mark;
+    if (client.tickers().loadField(instrument, TickerField::MARK_PRICE, mark) && !std::isnan(mark)) {
+        return mark;
+    }
+    return state.lastMarkPrice;
+}
+
+PositionView PositionEngine::value(InstrumentId instrument, const PositionState& state) const {
+    PositionView view{};
+    view.instrument = instrument;
+    view.size = state.size;
+    view.averagePrice = state.averagePrice;
+    view.markPrice = markPrice(instrument, state);
+    view.realizedPnl = state.realizedPnl;
+    view.fees = state.fees;
+    view.contract = state.contract;
+    view.currency = state.currency;
+    if (state.size != 0.0 && view.markPrice > 0.0 && state.averagePrice > 0.0) {
+        view.unrealizedPnl = state.contract == ContractType::INVERSE
+            ? state.size * (1.0 / state.averagePrice - 1.0 / view.markPrice)
+            : state.size * (view.markPrice - state.averagePrice);
+    }
+    return view;
+}
+
+bool PositionEngine::position(InstrumentId instrument, PositionView& out) const {
+    if (instrument >= kMaxInstruments || states[instrument].version() == 0) {
+        return false;
+    }
+    out = value(instrument, states[instrument].load());
+    return true;
+}
+
+double PositionEngine::positionSize(InstrumentId instrument) const {
+    return instrument < kMaxInstruments ? states[instrument].load().size : 0.0;
+}
+
+bool PositionEngine::position(const std::string& instrument, PositionView& out) const {
+    return position(registry.find(instrument), out);
+}
+
+std::vector<PositionView> PositionEngine::openPositions() const {
+    std::vector<PositionView> result;
+    size_t count = trackedCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        PositionState state = states[tracked[i]].load();
+        if (state.size != 0.0) {
+            result.push_back(value(tracked[i], state));
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> PositionEngine::currencies() const {
+    size_t count = currencyCount.load(std::memory_order_acquire);
+    return std::vector<std::string>(currencyNames, currencyNames + count);
+}
+
+CurrencyTotals PositionEngine::totals(const std::string& currency) const {
+    CurrencyTotals result{};
+    uint8_t slot = findCurrency(currency);
+    if (slot == kNoCurrency) {
+        return result;
+    }
+    size_t count = trackedCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        PositionState state = states[tracked[i]].load();
+        if (state.currency != slot) {
+            continue;
+        }
+        PositionView view = value(tracked[i], state);
+        result.realizedPnl += view.realizedPnl;
+        result.unrealizedPnl += view.unrealizedPnl;
+        result.openPositions += state.size != 0.0 ? 1 : 0;
+    }
+    result.account = accounts[slot].load();
+    return result;
+}
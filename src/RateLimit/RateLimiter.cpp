@@ -0,0 +1,262 @@
+#include "RateLimiter.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include <algorithm>
+
+RateLimiter::RateLimiter(const RateLimitOptions& options) : options(options) {
+    const CreditBucketOptions* configured[2] = {&options.matchingEngine, &options.nonMatchingEngine};
+    Clock::time_point now = Clock::now();
+    for (size_t i = 0; i < 2; ++i) {
+        buckets[i].rate = std::max(configured[i]->rate, 0.001);
+        buckets[i].burst = std::max(configured[i]->burst, 1.0);
+        buckets[i].credits = buckets[i].burst;
+        buckets[i].refilledAt = now;
+        buckets[i].pausedUntil = now;
+    }
+}
+
+void RateLimiter::refill(Bucket& bucket, Clock::time_point now) {
+    if (now <= bucket.refilledAt) {
+        return;
+    }
+    double elapsed = std::chrono::duration<double>(now - bucket.refilledAt).count();
+    bucket.credits = std::min(bucket.burst, bucket.credits + elapsed * bucket.rate);
+    bucket.refilledAt = now;
+}
+
+RateLimiter::Clock::time_point RateLimiter::readyAt(const Bucket& bucket, Clock::time_point now) const {
+    Clock::time_point at = now;
+    if (bucket.credits < 1.0) {
+        auto missing = std::chrono::duration<double>((1.0 - bucket.credits) / bucket.rate);
+        at = bucket.refilledAt + std::chrono::duration_cast<Clock::duration>(missing);
+    }
+    return std::max({at, bucket.pausedUntil, now});
+}
+
+// Waiting requests of the same bucket and the same or higher priority go first.
+bool RateLimiter::mayGo(RequestPriority priority, Clock::time_point now) {
+    size_t b = bucketFor(priority);
+    Bucket& bucket = buckets[b];
+    refill(bucket, now);
+    if (bucket.credits < 1.0 || now < bucket.pausedUntil) {
+        return false;
+    }
+    for (size_t p = 0; p <= static_cast<size_t>(priority); ++p) {
+        if (bucketFor(static_cast<RequestPriority>(p)) == b && !queues[p].empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RateLimiter::recordSent(RequestPriority priority, int64_t waitNs) {
+    size_t p = static_cast<size_t>(priority);
+    ++counters.sent[p];
+    if (waitNs > 0) {
+        ++counters.delayed[p];
+        counters.totalWaitNs[p] += waitNs;
+        counters.maxWaitNs[p] = std::max(counters.maxWaitNs[p], waitNs);
+        recordLatency(LatencyProbe::THROTTLE_WAIT, waitNs);
+    }
+}
+
+RateLimiter::Clock::time_point RateLimiter::grantLocked(Clock::time_point now,
+                                                        std::vector<std::function<void()>>& ready) {
+    bool woke = false;
+    Clock::time_point next{};
+    for (size_t p = 0; p < kRequestPriorities; ++p) {
+        RequestPriority priority = static_cast<RequestPriority>(p);
+        Bucket& bucket = buckets[bucketFor(priority)];
+        refill(bucket, now);
+        std::deque<Waiter>& queue = queues[p];
+        while (!queue.empty() && bucket.credits >= 1.0 && now >= bucket.pausedUntil) {
+            Waiter& waiter = queue.front();
+            bucket.credits -= 1.0;
+            recordSent(priority, std::chrono::duration_cast<std::chrono::nanoseconds>(now - waiter.enqueuedAt).count());
+            if (waiter.granted) {
+                *waiter.granted = true;
+                woke = true;
+            } else {
+                ready.push_back(std::move(waiter.send));
+            }
+            queue.pop_front();
+        }
+        if (!queue.empty()) {
+            Clock::time_point at = readyAt(bucket, now);
+            next = next == Clock::time_point() ? at : std::min(next, at);
+        }
+    }
+    if (woke) {
+        wakeup.notify_all();
+    }
+    return next;
+}
+
+// ------------------ Callers ------------------ //
+
+void RateLimiter::acquire(RequestPriority priority) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    if (mayGo(priority, now)) {
+        buckets[bucketFor(priority)].credits -= 1.0;
+        recordSent(priority, 0);
+        return;
+    }
+    bool done = false;
+    queues[static_cast<size_t>(priority)].push_back(Waiter{now, nullptr, &done, nullptr});
+    std::vector<std::function<void()>> ready;
+    while (true) {
+        Clock::time_point next = grantLocked(Clock::now(), ready);
+        if (!ready.empty()) {
+            // Queued WebSocket sends whose turn came up while we wait.
+            lock.unlock();
+            for (auto& send : ready) {
+                send();
+            }
+            ready.clear();
+            lock.lock();
+        }
+        if (done) {
+            return;
+        }
+        if (next == Clock::time_point()) {
+            wakeup.wait(lock);
+        } else {
+            wakeup.wait_until(lock, next);
+        }
+    }
+}
+
+bool RateLimiter::tryAcquire(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!mayGo(priority, Clock::now())) {
+        return false;
+    }
+    buckets[bucketFor(priority)].credits -= 1.0;
+    recordSent(priority, 0);
+    return true;
+}
+
+RateLimiter::Clock::time_point RateLimiter::submit(RequestPriority priority, std::function<void()> send,
+                                                   const void* owner) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+        if (!mayGo(priority, now)) {
+            queues[static_cast<size_t>(priority)].push_back(Waiter{now, std::move(send), nullptr, owner});
+            return readyAt(buckets[bucketFor(priority)], now);
+        }
+        buckets[bucketFor(priority)].credits -= 1.0;
+        recordSent(priority, 0);
+    }
+    send();
+    return Clock::time_point();
+}
+
+RateLimiter::Clock::time_point RateLimiter::drain() {
+    std::vector<std::function<void()>> ready;
+    Clock::time_point next;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        next = grantLocked(Clock::now(), ready);
+    }
+    for (auto& send : ready) {
+        send();
+    }
+    return next;
+}
+
+// Blocked acquire() callers have no owner and are never removed. Dropping
+// waiters can only let the ones behind them go sooner, so the blocked ones
+// are woken to re-check.
+size_t RateLimiter::cancel(const void* owner) {
+    if (!owner) {
+        return 0;
+    }
+    std::vector<std::function<void()>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::deque<Waiter>& queue : queues) {
+            for (auto it = queue.begin(); it != queue.end();) {
+                if (it->owner == owner && !it->granted) {
+                    dropped.push_back(std::move(it->send));
+                    it = queue.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        counters.cancelled += dropped.size();
+    }
+    if (!dropped.empty()) {
+        wakeup.notify_all();
+    }
+    // Destroyed outside the lock; the sends may own their callers' state.
+    return dropped.size();
+}
+
+void RateLimiter::onThrottled(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    Bucket& bucket = buckets[bucketFor(priority)];
+    refill(bucket, now);
+    bucket.credits = std::min(bucket.credits, 0.0);
+    bucket.pausedUntil = std::max(bucket.pausedUntil, now + options.throttledBackoff);
+    ++counters.throttled;
+    systemLogger->warn("[RateLimiter] Exchange rate limit hit on a {} request; pausing {} ms",
+                       priorityName(priority), options.throttledBackoff.count());
+}
+
+// ------------------ Queries ------------------ //
+
+std::chrono::nanoseconds RateLimiter::waitEstimate(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+    if (mayGo(priority, now)) {
+        return std::chrono::nanoseconds(0);
+    }
+    size_t b = bucketFor(priority);
+    size_t ahead = 0;
+    for (size_t p = 0; p <= static_cast<size_t>(priority); ++p) {
+        if (bucketFor(static_cast<RequestPriority>(p)) == b) {
+            ahead += queues[p].size();
+        }
+    }
+    auto queuedFor = std::chrono::duration<double>(static_cast<double>(ahead) / buckets[b].rate);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(readyAt(buckets[b], now) - now + queuedFor);
+}
+
+RateLimiterStats RateLimiter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    RateLimiterStats out = counters;
+    for (size_t p = 0; p < kRequestPriorities; ++p) {
+        out.queued[p] = queues[p].size();
+    }
+    Clock::time_point now = Clock::now();
+    for (size_t b = 0; b < 2; ++b) {
+        double elapsed = std::chrono::duration<double>(now - buckets[b].refilledAt).count();
+        out.credits[b] = std::min(buckets[b].burst, buckets[b].credits + std::max(elapsed, 0.0) * buckets[b].rate);
+    }
+    return out;
+}
+
+void RateLimiter::logStats(const char* label) const {
+    RateLimiterStats s = stats();
+    for (size_t p = 0; p < kRequestPriorities; ++p) {
+        latencyLogger->info("[RateLimiter] {} {} queued={} sent={} delayed={} wait_total={:.2f}us wait_max={:.2f}us",
+                            label, priorityName(static_cast<RequestPriority>(p)), s.queued[p], s.sent[p],
+                            s.delayed[p], s.totalWaitNs[p] / 1000.0, s.maxWaitNs[p] / 1000.0);
+    }
+    latencyLogger->info("[RateLimiter] {} throttled={} cancelled={} credits_matching={:.1f} credits_non_matching={:.1f}",
+                        label, s.throttled, s.cancelled, s.credits[0], s.credits[1]);
+}
+
+const char* RateLimiter::priorityName(RequestPriority priority) {
+    switch (priority) {
+        case RequestPriority::CANCEL: return "cancel";
+        case RequestPriority::EDIT: return "edit";
+        case RequestPriority::ORDER: return "order";
+        case RequestPriority::QUERY: return "query";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,222 @@
+#include "HttpConnectionPool.h"
+#include "Logger.h"
+#include <algorithm>
+
+// Callback for libcurl to write response data into a std::string.
+static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    std::string* response = reinterpret_cast<std::string*>(userp);
+    size_t totalSize = size * nmemb;
+    response->append(reinterpret_cast<char*>(contents), totalSize);
+    return totalSize;
+}
+
+// Warm-up responses are thrown away.
+static size_t DiscardCallback(void* /*contents*/, size_t size, size_t nmemb, void* /*userp*/) {
+    return size * nmemb;
+}
+
+HttpConnectionPool::HttpConnectionPool(const HttpPoolOptions& options)
+    : options(options), handles(options.size == 0 ? 1 : options.size), share(nullptr),
+      requests(0), connects(0), running(true)
+{
+    curl_global_init(CURL_GLOBAL_ALL);
+    initLogger();
+
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &HttpConnectionPool::lockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &HttpConnectionPool::unlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    for (auto& handle : handles) {
+        configure(handle);
+        idle.push_back(&handle);
+    }
+
+    if (options.warmOnStart) {
+        warm();
+    }
+    if (options.warmInterval.count() > 0) {
+        warmer = std::thread(&HttpConnectionPool::warmLoop, this);
+    }
+    systemLogger->info("[HttpPool] {} handles for {} (http2: {})", handles.size(), options.baseUrl, options.http2);
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    {
+        std::lock_guard<std::mutex> lock(warmMutex);
+        running.store(false);
+    }
+    warmCv.notify_all();
+    if (warmer.joinable()) {
+        warmer.join();
+    }
+    for (auto& handle : handles) {
+        curl_slist_free_all(handle.headers);
+        curl_easy_cleanup(handle.curl);
+    }
+    curl_share_cleanup(share);
+    curl_global_cleanup();
+}
+
+void HttpConnectionPool::lockShare(CURL* /*handle*/, curl_lock_data data, curl_lock_access /*access*/, void* userp) {
+    static_cast<HttpConnectionPool*>(userp)->shareMutex[data].lock();
+}
+
+void HttpConnectionPool::unlockShare(CURL* /*handle*/, curl_lock_data data, void* userp) {
+    static_cast<HttpConnectionPool*>(userp)->shareMutex[data].unlock();
+}
+
+// Options that stay fixed for the lifetime of the handle.
+void HttpConnectionPool::configure(PooledHandle& handle) {
+    handle.curl = curl_easy_init();
+    handle.response.reserve(4096);
+    CURL* curl = handle.curl;
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, 3600L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    if (options.http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+    if (!options.verifyPeer) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    setAuthHeader(handle, "");
+}
+
+void HttpConnectionPool::setAuthHeader(PooledHandle& handle, const std::string& authHeader) {
+    if (handle.headers && handle.authHeader == authHeader) {
+        return;
+    }
+    curl_slist_free_all(handle.headers);
+    handle.headers = nullptr;
+    for (const auto& header : options.headers) {
+        handle.headers = curl_slist_append(handle.headers, header.c_str());
+    }
+    if (!authHeader.empty()) {
+        handle.headers = curl_slist_append(handle.headers, authHeader.c_str());
+    }
+    handle.authHeader = authHeader;
+    curl_easy_setopt(handle.curl, CURLOPT_HTTPHEADER, handle.headers);
+}
+
+// ------------------ Borrowing handles ------------------ //
+
+PooledHandle* HttpConnectionPool::acquire() {
+    std::unique_lock<std::mutex> lock(poolMutex);
+    poolCv.wait(lock, [this]() { return !idle.empty(); });
+    PooledHandle* handle = idle.back();
+    idle.pop_back();
+    return handle;
+}
+
+PooledHandle* HttpConnectionPool::tryAcquire() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (idle.empty()) {
+        return nullptr;
+    }
+    PooledHandle* handle = idle.back();
+    idle.pop_back();
+    return handle;
+}
+
+void HttpConnectionPool::release(PooledHandle* handle) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        idle.push_back(handle);
+    }
+    poolCv.notify_one();
+}
+
+void HttpConnectionPool::preparePost(PooledHandle* handle, const std::string& url, const std::string& body,
+                                     const std::string& authHeader) {
+    setAuthHeader(*handle, authHeader);
+    handle->response.clear();
+    curl_easy_setopt(handle->curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle->curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(handle->curl, CURLOPT_POSTFIELDS, body.c_str());
+    curl_easy_setopt(handle->curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+    curl_easy_setopt(handle->curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(handle->curl, CURLOPT_WRITEDATA, &handle->response);
+}
+
+void HttpConnectionPool::noteCompleted(PooledHandle* handle) {
+    long newConnections = 0;
+    curl_easy_getinfo(handle->curl, CURLINFO_NUM_CONNECTS, &newConnections);
+    requests.fetch_add(1, std::memory_order_relaxed);
+    connects.fetch_add(static_cast<uint64_t>(newConnections), std::memory_order_relaxed);
+}
+
+long HttpConnectionPool::post(const std::string& url, const std::string& body, std::string& response,
+                              const std::string& authHeader) {
+    PooledHandle* handle = acquire();
+    preparePost(handle, url, body, authHeader);
+
+    long httpCode = 0;
+    CURLcode res = curl_easy_perform(handle->curl);
+    if (res != CURLE_OK) {
+        systemLogger->error("[HttpPool] HTTP POST failed: {}", curl_easy_strerror(res));
+    } else {
+        curl_easy_getinfo(handle->curl, CURLINFO_RESPONSE_CODE, &httpCode);
+    }
+    noteCompleted(handle);
+    response.assign(handle->response);
+    release(handle);
+    return httpCode;
+}
+
+// ------------------ Connection warming ------------------ //
+
+// Handles are borrowed one at a time so order traffic is never starved while
+// the pool warms up.
+void HttpConnectionPool::warm() {
+    std::string url = options.baseUrl + options.warmPath;
+    std::vector<PooledHandle*> warmed;
+    for (;;) {
+        PooledHandle* handle = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            for (auto it = idle.begin(); it != idle.end(); ++it) {
+                if (std::find(warmed.begin(), warmed.end(), *it) == warmed.end()) {
+                    handle = *it;
+                    idle.erase(it);
+                    break;
+                }
+            }
+        }
+        if (!handle) {
+            break;
+        }
+        curl_easy_setopt(handle->curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle->curl, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(handle->curl, CURLOPT_WRITEFUNCTION, DiscardCallback);
+        CURLcode res = curl_easy_perform(handle->curl);
+        if (res != CURLE_OK) {
+            systemLogger->error("[HttpPool] Warm-up request failed: {}", curl_easy_strerror(res));
+        }
+        noteCompleted(handle);
+        warmed.push_back(handle);
+        release(handle);
+    }
+}
+
+void HttpConnectionPool::warmLoop() {
+    std::unique_lock<std::mutex> lock(warmMutex);
+    while (running.load()) {
+        warmCv.wait_for(lock, options.warmInterval, [this]() { return !running.load(); });
+        if (!running.load()) {
+            break;
+        }
+        lock.unlock();
+        warm();
+        lock.lock();
+    }
+}
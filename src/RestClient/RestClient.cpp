@@ -1,204 +1,308 @@
 #include "RestClient.h"
+#include "LatencyHistogram.h"
 #include <iostream>
-#include <curl/curl.h>
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <nlohmann/json.hpp>
 #include <spdlog/sinks/basic_file_sink.h>
 
 
 using json = nlohmann::json;
 
-// Callback function for libcurl to collect response data.
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    std::string* response = reinterpret_cast<std::string*>(userp);
-    size_t totalSize = size * nmemb;
-    response->append(reinterpret_cast<char*>(contents), totalSize);
-    return totalSize;
-}
+// Reused per thread so single requests render their body without allocating.
+static thread_local std::string requestBody;
 
-RestClient::RestClient(Authorization* auth)
-    : auth(auth)
+RestClient::RestClient(Authorization* auth, const HttpPoolOptions& poolOptions)
+    : auth(auth), pool(poolOptions),
+      buyUrl(poolOptions.baseUrl + "/api/v2/private/buy"),
+      sellUrl(poolOptions.baseUrl + "/api/v2/private/sell"),
+      cancelUrl(poolOptions.baseUrl + "/api/v2/private/cancel"),
+      editUrl(poolOptions.baseUrl + "/api/v2/private/edit"),
+      multi(curl_multi_init())
 {
-    curl_global_init(CURL_GLOBAL_ALL);
     initLogger();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    // Pooled handles use the multi handle's connection cache while a batch
+    // drives them; keep one connection per handle open between batches.
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(poolOptions.size));
     systemLogger->info("RestClient initialized.");
 }
 
 RestClient::~RestClient() {
-    curl_global_cleanup();
+    curl_multi_cleanup(multi);
     systemLogger->info("RestClient shutting down.");
 }
 
 std::string RestClient::httpPost(const std::string& url, const std::string& jsonPayload) {
-    CURL* curl = curl_easy_init();  
     std::string response;
-    if (curl) {
-        struct curl_slist* headers = nullptr;
-        std::string authHeader = "Authorization: Bearer " + auth->getAccessToken();
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        headers = curl_slist_append(headers, authHeader.c_str());
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, jsonPayload.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-        CURLcode res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            systemLogger->error("[RestClient] HTTP POST failed: {}", curl_easy_strerror(res));
-        }
-
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-    }
+    pool.post(url, jsonPayload, response, auth->currentToken().bearerHeader);
     return response;
 }
 
 
-std::string RestClient::placeOrder(const std::string& instrument, double amount, 
-                                   const std::string& side, const std::string& orderType, double price,
-                                   const std::string& expiryDate , double strikePrice , 
-                                   const std::string& optionType ) {
-                            
-    
-    std::string url = (side == "buy") ? "https://test.deribit.com/api/v2/private/buy" 
-                                      : "https://test.deribit.com/api/v2/private/sell";
-    if(url.empty()){
-    	std::cerr<<"ENV variables not loaded properly"<<std::endl;
-    }
+// ------------------ Order requests ------------------ //
 
-  
-    json payload = {
-        {"jsonrpc", "2.0"},
-        {"id", 1},
-        {"method", side == "buy" ? "private/buy" : "private/sell"},
-        {"params", {
-            {"instrument_name", instrument},
-            {"amount", amount},
-            {"type", orderType}
-        }}
-    };
-
-   
-    if (orderType == "limit") {
-        payload["params"]["price"] = price;
+const std::string& RestClient::urlFor(const OrderRequest& request) const {
+    switch (request.action) {
+        case OrderAction::CANCEL: return cancelUrl;
+        case OrderAction::EDIT: return editUrl;
+        default: return request.side == "buy" ? buyUrl : sellUrl;
     }
+}
 
-  
-    if (!expiryDate.empty()) {
-        payload["params"]["expiry_date"] = expiryDate;
-    }
+std::string RestClient::payloadFor(const OrderRequest& request) const {
+    std::string out;
+    payloadFor(request, out);
+    return out;
+}
 
-   
-    if (strikePrice != 0.0) {
-        payload["params"]["strike_price"] = strikePrice;
-    }
-    if (!optionType.empty()) {
-        payload["params"]["option_type"] = optionType;
-    }
+// REST requests always carry id 1; the HTTP exchange does the correlation.
+void RestClient::payloadFor(const OrderRequest& request, std::string& out) const {
+    messages.render(out, 1, request);
+}
 
-    orderLogger->info("Placing {} order for {}: Amount: {}, Type: {}", side, instrument, amount, orderType);
-    auto start = std::chrono::high_resolution_clock::now();
-    std::string response = httpPost(url, payload.dump());
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    latencyLogger->info("Time taken to place order and receive a response (in microseconds): {}", duration);
+// Records the round trip and turns the raw response into the same result
+// strings the single-request calls have always returned.
+OrderResult RestClient::handleResponse(const OrderRequest& request, OrderHandle handle, const std::string& response,
+                                       int64_t duration) {
+    OrderResult out;
+    out.latencyNs = duration;
+    const std::string& ackId = request.action == OrderAction::PLACE ? request.instrument : request.orderId;
+    double amount = request.action == OrderAction::CANCEL ? 0.0 : request.amount;
+    double price = request.action == OrderAction::CANCEL ? 0.0 : request.price;
+
+    switch (request.action) {
+        case OrderAction::PLACE: recordLatency(LatencyProbe::ORDER_RTT, duration); break;
+        case OrderAction::CANCEL: recordLatency(LatencyProbe::CANCEL_RTT, duration); break;
+        case OrderAction::EDIT: recordLatency(LatencyProbe::EDIT_RTT, duration); break;
+    }
 
-    
     try {
         auto j = json::parse(response);
-        orderLogger->info("ORDER INFO: {}", j.dump(4));  
-        if (j.contains("result") && j["result"].contains("order")) {
-            std::string orderId = j["result"]["order"].value("order_id", "ORDER_FAILED");
-            return orderId;
-        } else if (j.contains("error")) {
-            systemLogger->error("Order failed: {}", j["error"].dump());
-            return "ORDER_FAILED";
+        // Deribit error 10028: too_many_requests.
+        if (rateLimiter && j.contains("error") && j["error"].value("code", 0) == 10028) {
+            rateLimiter->onThrottled(requestPriority(request.action));
+        }
+        if (orders) {
+            auto result = j.find("result");
+            orders->onResponse(handle, request.action, result != j.end(),
+                               result != j.end() ? result->dump() : std::string(), false);
+        }
+        if (request.action == OrderAction::PLACE) {
+            orderLogger->info("ORDER INFO: {}", j.dump(4));
+            if (j.contains("result") && j["result"].contains("order")) {
+                out.result = j["result"]["order"].value("order_id", "ORDER_FAILED");
+                out.ok = true;
+                binaryLogger->logOrderAck(out.result, OrderAckStatus::ACCEPTED, duration, amount, price);
+                return out;
+            } else if (j.contains("error")) {
+                systemLogger->error("Order failed: {}", j["error"].dump());
+                binaryLogger->logOrderAck(ackId, OrderAckStatus::REJECTED, duration, amount, price);
+                out.result = "ORDER_FAILED";
+                return out;
+            }
+        } else if (request.action == OrderAction::CANCEL) {
+            orderLogger->info("CANCLE ORDER INFO {}",j.dump(4));
+            if (j.contains("result")) {
+                binaryLogger->logOrderAck(ackId, OrderAckStatus::ACCEPTED, duration, amount, price);
+                out.result = "ORDER_CANCELED";
+                out.ok = true;
+                return out;
+            } else if (j.contains("error")) {
+                systemLogger->error("Cancel failed: {}", j["error"].dump());
+                binaryLogger->logOrderAck(ackId, OrderAckStatus::REJECTED, duration, amount, price);
+                out.result = "CANCEL_FAILED";
+                return out;
+            }
+        } else {
+            orderLogger->info("MODIFY ORDER INFO {}",j.dump(4));
+            if (j.contains("result")) {
+                binaryLogger->logOrderAck(ackId, OrderAckStatus::ACCEPTED, duration, amount, price);
+                out.result = j["result"].value("order_id", "MODIFY_FAILED");
+                out.ok = true;
+                return out;
+            } else if (j.contains("error")) {
+                systemLogger->error("Modify failed: {}", j["error"].dump());
+                binaryLogger->logOrderAck(ackId, OrderAckStatus::REJECTED, duration, amount, price);
+                out.result = "MODIFY_FAILED";
+                return out;
+            }
         }
     } catch (json::exception& e) {
         systemLogger->error("JSON parsing error: {} | Raw response: {}", e.what(), response);
-        return "JSON_ERROR";
+        if (orders) {
+            // No answer to read (a transport error or timeout): the request may have been taken.
+            orders->onResponse(handle, request.action, false, std::string_view(), true);
+        }
+        binaryLogger->logOrderAck(ackId, OrderAckStatus::BAD_RESPONSE, duration, amount, price);
+        out.result = "JSON_ERROR";
+        return out;
     }
-    return "UNKNOWN_ERROR";
+    out.result = "UNKNOWN_ERROR";
+    return out;
 }
 
+// ------------------ Single requests ------------------ //
 
-
+std::string RestClient::placeOrder(const std::string& instrument, double amount, 
+                                   const std::string& side, const std::string& orderType, double price,
+                                   const std::string& expiryDate , double strikePrice , 
+                                   const std::string& optionType ) {
+    return sendOrder(OrderRequest::place(instrument, amount, side, orderType, price,
+                                         expiryDate, strikePrice, optionType));
+}
 
 std::string RestClient::cancelOrder(const std::string& orderId) {
-	
-    std::string url = "https://test.deribit.com/api/v2/private/cancel";
-    if(url.empty()){
-    	std::cerr<<"ENV variables not loaded properly"<<std::endl;
+    return sendOrder(OrderRequest::cancel(orderId));
+}
+
+std::string RestClient::modifyOrder(const std::string& orderId, double newAmount, double newPrice) {
+    return sendOrder(OrderRequest::edit(orderId, newAmount, newPrice));
+}
+
+std::string RestClient::sendOrder(OrderRequest request) {
+    switch (request.action) {
+        case OrderAction::CANCEL:
+            orderLogger->info("Canceling order: {}", request.orderId);
+            break;
+        case OrderAction::EDIT:
+            orderLogger->info("Modifying order {}: New Amount: {}, New Price: {}", request.orderId, request.amount,
+                              request.price);
+            break;
+        default:
+            orderLogger->info("Placing {} order for {}: Amount: {}, Type: {}", request.side, request.instrument,
+                              request.amount, request.orderType);
+            break;
     }
-    json payload = {
-        {"jsonrpc", "2.0"},
-        {"id", 1},
-        {"method", "private/cancel"},
-        {"params", { {"order_id", orderId} }}
-    };
-
-    orderLogger->info("Canceling order: {}", orderId);
-    auto start=std::chrono::high_resolution_clock::now();
-    std::string response = httpPost(url, payload.dump());
-    auto end=std::chrono::high_resolution_clock::now();
-    auto duration=std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
-    latencyLogger->info("Time taken to cancle an order and recieve a conformation (in microseconds) {}",duration);
-    
-    
-    try {
-        auto j = json::parse(response);
-        orderLogger->info("CANCLE ORDER INFO {}",j.dump(4));
-        if (j.contains("result")) {
-            return "ORDER_CANCELED";
-        } else if (j.contains("error")) {
-            systemLogger->error("Cancel failed: {}", j["error"].dump());
-            return "CANCEL_FAILED";
-        }
-    } catch (json::exception& e) {
-        systemLogger->error("JSON parsing error: {}", e.what());
-        return "JSON_ERROR";
+    OrderHandle handle = orders ? orders->submit(request) : kNoOrder;
+    if (rateLimiter) {
+        rateLimiter->acquire(requestPriority(request.action));
     }
-    return "UNKNOWN_ERROR";
+    auto start = std::chrono::high_resolution_clock::now();
+    payloadFor(request, requestBody);
+    std::string response = httpPost(urlFor(request), requestBody);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return handleResponse(request, handle, response, duration).result;
 }
 
-std::string RestClient::modifyOrder(const std::string& orderId, double newAmount, double newPrice) {
+// ------------------ Batches ------------------ //
 
-    std::string url = "https://test.deribit.com/api/v2/private/edit";
-    json payload = {
-        {"jsonrpc", "2.0"},
-        {"id", 1},
-        {"method", "private/edit"},
-        {"params", {
-            {"order_id", orderId},
-            {"amount", newAmount},
-            {"price", newPrice}
-        }}
-    };
-
-    orderLogger->info("Modifying order {}: New Amount: {}, New Price: {}", orderId, newAmount, newPrice);
-    auto start=std::chrono::high_resolution_clock::now();
-    std::string response = httpPost(url, payload.dump());
-    auto end=std::chrono::high_resolution_clock::now();
-    auto duration=std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
-    latencyLogger->info("Time taken to modify the order and recieve a conformation back (in microsecnds) {}",duration);
-    
-    try {
-        auto j = json::parse(response);
-        orderLogger->info("MODIFY ORDER INFO {}",j.dump(4));
-        if (j.contains("result")) {
-            return j["result"].value("order_id", "MODIFY_FAILED");
-        } else if (j.contains("error")) {
-            systemLogger->error("Modify failed: {}", j["error"].dump());
-            return "MODIFY_FAILED";
+std::vector<OrderResult> RestClient::executeBatch(const std::vector<OrderRequest>& requests) {
+    std::vector<OrderResult> results(requests.size());
+    if (requests.empty()) {
+        return results;
+    }
+    std::lock_guard<std::mutex> lock(batchMutex);
+
+    // Tracked orders may get a generated label, so they are sent from a copy.
+    std::vector<OrderRequest> labelled;
+    std::vector<OrderHandle> orderHandles(requests.size(), kNoOrder);
+    if (orders) {
+        labelled = requests;
+        for (size_t i = 0; i < labelled.size(); ++i) {
+            orderHandles[i] = orders->submit(labelled[i]);
         }
-    } catch (json::exception& e) {
-        systemLogger->error("JSON parsing error: {}", e.what());
-        return "JSON_ERROR";
     }
-    return "UNKNOWN_ERROR";
-}
+    const std::vector<OrderRequest>& batch = orders ? labelled : requests;
+
+    // Copied once: the batch may outlive the snapshot it was read from.
+    const std::string authHeader = auth->currentToken().bearerHeader;
+    // curl does not copy POSTFIELDS, so the bodies must outlive the transfers.
+    std::vector<std::string> bodies(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        payloadFor(batch[i], bodies[i]);
+    }
+    std::vector<PooledHandle*> handles(batch.size(), nullptr);
+    std::vector<std::chrono::high_resolution_clock::time_point> started(batch.size());
+    // Start order: cancels, edits, then new orders, each in request order, so a
+    // throttled batch spends its credits on the most urgent requests first.
+    std::vector<size_t> startOrder(batch.size());
+    for (size_t i = 0; i < startOrder.size(); ++i) {
+        startOrder[i] = i;
+    }
+    if (rateLimiter) {
+        std::stable_sort(startOrder.begin(), startOrder.end(), [&batch](size_t a, size_t b) {
+            return requestPriority(batch[a].action) < requestPriority(batch[b].action);
+        });
+    }
+
+    orderLogger->info("Sending batch of {} requests", batch.size());
+    auto batchStart = std::chrono::high_resolution_clock::now();
+    size_t next = 0;
+    size_t active = 0;
+    size_t done = 0;
+    while (done < batch.size()) {
+        // Start as many requests as there are idle handles and credits. Block for
+        // one only when nothing of ours is in flight, otherwise wait for our own to finish.
+        bool throttled = false;
+        while (next < batch.size()) {
+            size_t i = startOrder[next];
+            PooledHandle* handle = active == 0 ? pool.acquire() : pool.tryAcquire();
+            if (!handle) {
+                break;
+            }
+            if (rateLimiter) {
+                RequestPriority priority = requestPriority(batch[i].action);
+                if (active == 0) {
+                    rateLimiter->acquire(priority);
+                } else if (!rateLimiter->tryAcquire(priority)) {
+                    pool.release(handle);
+                    throttled = true;
+                    break;
+                }
+            }
+            pool.preparePost(handle, urlFor(batch[i]), bodies[i], authHeader);
+            curl_easy_setopt(handle->curl, CURLOPT_PRIVATE, reinterpret_cast<void*>(i));
+            handles[i] = handle;
+            started[i] = std::chrono::high_resolution_clock::now();
+            curl_multi_add_handle(multi, handle->curl);
+            ++next;
+            ++active;
+        }
+
+        int stillRunning = 0;
+        curl_multi_perform(multi, &stillRunning);
 
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL* easy = msg->easy_handle;
+            CURLcode res = msg->data.result;
+            void* priv = nullptr;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &priv);
+            size_t i = reinterpret_cast<size_t>(priv);
+            auto end = std::chrono::high_resolution_clock::now();
+            curl_multi_remove_handle(multi, easy);
+
+            PooledHandle* handle = handles[i];
+            pool.noteCompleted(handle);
+            if (res != CURLE_OK) {
+                systemLogger->error("Batch request {} failed: {}", i, curl_easy_strerror(res));
+                handle->response.clear();
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - started[i]).count();
+            results[i] = handleResponse(batch[i], orderHandles[i], handle->response, duration);
+            pool.release(handle);
+            --active;
+            ++done;
+        }
 
+        if (done < batch.size() && active > 0) {
+            int timeoutMs = 100;
+            if (throttled) {
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    rateLimiter->waitEstimate(requestPriority(batch[startOrder[next]].action)));
+                timeoutMs = static_cast<int>(std::clamp<int64_t>(wait.count() + 1, 1, 100));
+            }
+            curl_multi_poll(multi, nullptr, 0, timeoutMs, nullptr);
+        }
+    }
+    auto batchEnd = std::chrono::high_resolution_clock::now();
+    orderLogger->info("Batch of {} requests completed in {} us", batch.size(),
+                      std::chrono::duration_cast<std::chrono::microseconds>(batchEnd - batchStart).count());
+    return results;
+}
@@ -0,0 +1,278 @@
+#include "RiskGate.h"
+#include "Logger.h"
+#include "OrderBook.h"
+#include "PositionEngine.h"
+#include "TickerStore.h"
+#include "WebsocketClient.h"
+
+// std::atomic<double> has no fetch_add before C++20.
+static double atomicAdd(std::atomic<double>& target, double delta) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + delta, std::memory_order_acq_rel,
+                                         std::memory_order_relaxed)) {
+    }
+    return current + delta;
+}
+
+
+static bool exceeds(double value, double limit) {
+    return limit > 0.0 && value > limit;
+}
+
+RiskGate::RiskGate(InstrumentRegistry& registry, const OrderBookManager* books, const TickerStore* tickers,
+                   const PositionEngine* positions, const RiskConfig& config)
+    : registry(registry), books(books), tickers(tickers), positions(positions), config(config),
+      instrumentLimits(new Seqlock<InstrumentRisk>[kMaxInstruments]),
+      working(new Working[kMaxInstruments]) {
+    for (auto& count : rejected) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+RiskGate::RiskGate(WebsocketClient& client, const PositionEngine* positions, const RiskConfig& config)
+    : RiskGate(client.instruments(), &client.orderBooks(), &client.tickers(), positions, config) {}
+
+void RiskGate::setLimits(const std::string& instrument, const RiskLimits& limits) {
+    InstrumentId id = registry.intern(instrument);
+    if (id == kNoInstrument) {
+        systemLogger->error("[Risk] Cannot set limits for {}: instrument table full", instrument);
+        return;
+    }
+    InstrumentRisk entry{limits, PositionEngine::contractTypeFor(instrument) == ContractType::INVERSE, true};
+    std::lock_guard<std::mutex> lock(limitsMutex);
+    instrumentLimits[id].store(entry);
+    systemLogger->info("[Risk] {} limits: size {}, notional {}, collar {}, position {}", instrument,
+                       limits.maxOrderSize, limits.maxNotional, limits.priceCollar, limits.maxPosition);
+}
+
+void RiskGate::setLimits(const std::string& instrument) {
+    setLimits(instrument, config.defaults);
+}
+
+RiskLimits RiskGate::limits(InstrumentId instrument) const {
+    return instrument < kMaxInstruments ? instrumentLimits[instrument].load().limits : config.defaults;
+}
+
+void RiskGate::attach(OrderManager& manager) {
+    manager.setExposureListener([this](const ExposureChange& change) { return onExposure(change); });
+    tracking = true;
+}
+
+// ------------------ Checks ------------------ //
+
+bool RiskGate::referencePrice(InstrumentId instrument, bool buy, double& out) const {
+    if (const OrderBook* book = books ? books->get(instrument) : nullptr) {
+        TopOfBook top = book->topOfBook();
+        double price = buy ? top.askPrice : top.bidPrice;
+        if (top.valid && price > 0.0) {
+            out = price;
+            return true;
+        }
+    }
+    return tickers && tickers->loadField(instrument, TickerField::MARK_PRICE, out) && out > 0.0;
+}
+
+RiskReject RiskGate::checkTerms(InstrumentId instrument, const RiskLimits& limits, bool inverse, bool buy,
+                                bool limitOrder, double amount, double price, double& notional) const {
+    if (!(amount > 0.0) || price < 0.0 || (limitOrder && !(price > 0.0))) {
+        return RiskReject::INVALID;
+    }
+    if (exceeds(amount, limits.maxOrderSize)) {
+        return RiskReject::ORDER_SIZE;
+    }
+
+    double reference = 0.0;
+    bool haveReference = referencePrice(instrument, buy, reference);
+    bool needReference = (limitOrder && limits.priceCollar > 0.0) || (!limitOrder && !inverse);
+    if (needReference && !haveReference && config.requireReferencePrice) {
+        return RiskReject::NO_REFERENCE_PRICE;
+    }
+    if (limitOrder && limits.priceCollar > 0.0 && haveReference) {
+        if (buy ? price > reference * (1.0 + limits.priceCollar) : price < reference * (1.0 - limits.priceCollar)) {
+            return RiskReject::PRICE_COLLAR;
+        }
+    }
+
+    if (inverse) {
+        notional = amount;
+    } else {
+        notional = amount * (limitOrder ? price : (haveReference ? reference : 0.0));
+    }
+    if (exceeds(notional, limits.maxNotional)) {
+        return RiskReject::NOTIONAL;
+    }
+    return RiskReject::NONE;
+}
+
+RiskReject RiskGate::reject(RiskReject reason) {
+    rejected[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+    return reason;
+}
+
+RiskReject RiskGate::checkOrder(OrderRequest& request) {
+    if (request.action == OrderAction::CANCEL) {
+        return RiskReject::NONE;
+    }
+    checked.fetch_add(1, std::memory_order_relaxed);
+    if (request.action == OrderAction::EDIT) {
+        // Without the order there is nothing to compare an edit against; size still applies.
+        RiskLimits defaults = config.defaults;
+        if (!(request.amount > 0.0) || request.price < 0.0) {
+            return reject(RiskReject::INVALID);
+        }
+        if (exceeds(request.amount, defaults.maxOrderSize)) {
+            return reject(RiskReject::ORDER_SIZE);
+        }
+        passed.fetch_add(1, std::memory_order_relaxed);
+        return RiskReject::NONE;
+    }
+
+    InstrumentId instrument = registry.find(request.instrument);
+    if (instrument == kNoInstrument) {
+        return reject(RiskReject::INVALID);
+    }
+    InstrumentRisk risk = instrumentLimits[instrument].load();
+    if (!risk.loaded) {
+        return reject(RiskReject::INVALID);
+    }
+    const RiskLimits& limits = risk.limits;
+    bool buy = request.side == "buy";
+    double notional = 0.0;
+    RiskReject reason = checkTerms(instrument, limits, risk.inverse, buy, request.orderType == "limit",
+                                   request.amount, request.price, notional);
+    if (reason != RiskReject::NONE) {
+        return reject(reason);
+    }
+    if (!tracking) {
+        passed.fetch_add(1, std::memory_order_relaxed);
+        return RiskReject::NONE;
+    }
+
+    // Reserve first, then verify; a check that loses the race rolls its reservation back.
+    int orders = openOrders.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (config.maxOpenOrders > 0 && orders > config.maxOpenOrders) {
+        openOrders.fetch_sub(1, std::memory_order_acq_rel);
+        return reject(RiskReject::OPEN_ORDERS);
+    }
+    std::atomic<double>& side = buy ? working[instrument].buy : working[instrument].sell;
+    double sideWorking = atomicAdd(side, request.amount);
+    double position = positions ? positions->positionSize(instrument) : 0.0;
+    double worstCase = buy ? position + sideWorking : sideWorking - position;
+    if (exceeds(worstCase, limits.maxPosition)) {
+        atomicAdd(side, -request.amount);
+        openOrders.fetch_sub(1, std::memory_order_acq_rel);
+        return reject(RiskReject::POSITION);
+    }
+    double gross = atomicAdd(workingNotional, notional) + (positions ? positions->grossNotional() : 0.0);
+    if (exceeds(gross, config.maxGrossNotional)) {
+        atomicAdd(workingNotional, -notional);
+        atomicAdd(side, -request.amount);
+        openOrders.fetch_sub(1, std::memory_order_acq_rel);
+        return reject(RiskReject::GROSS_NOTIONAL);
+    }
+    // The order manager releases exactly this as the order fills or ends.
+    request.riskReserved = true;
+    request.reservedNotional = notional;
+    passed.fetch_add(1, std::memory_order_relaxed);
+    return RiskReject::NONE;
+}
+
+RiskReject RiskGate::checkEdit(const ManagedOrder& order, double newAmount, double newPrice) {
+    checked.fetch_add(1, std::memory_order_relaxed);
+    if (order.instrument >= kMaxInstruments) {
+        return reject(RiskReject::INVALID);
+    }
+    InstrumentRisk risk = instrumentLimits[order.instrument].load();
+    if (!risk.loaded) {
+        return reject(RiskReject::INVALID);
+    }
+    const RiskLimits& limits = risk.limits;
+    double notional = 0.0;
+    RiskReject reason = checkTerms(order.instrument, limits, risk.inverse, order.buy, order.limit, newAmount,
+                                   order.limit ? newPrice : 0.0, notional);
+    if (reason != RiskReject::NONE) {
+        return reject(reason);
+    }
+    // The increase is not reserved: it reaches the counters when the edit is acknowledged.
+    double increase = newAmount - order.amount;
+    if (tracking && increase > 0.0) {
+        const Working& sides = working[order.instrument];
+        double sideWorking = (order.buy ? sides.buy : sides.sell).load(std::memory_order_acquire) + increase;
+        double position = positions ? positions->positionSize(order.instrument) : 0.0;
+        if (exceeds(order.buy ? position + sideWorking : sideWorking - position, limits.maxPosition)) {
+            return reject(RiskReject::POSITION);
+        }
+    }
+    passed.fetch_add(1, std::memory_order_relaxed);
+    return RiskReject::NONE;
+}
+
+// ------------------ Exposure feed ------------------ //
+
+// The order manager only reports orders it has counted here (reserved by
+// checkOrder() or entered through an increase), so every release matches a
+// reservation and no counter is clamped.
+double RiskGate::onExposure(const ExposureChange& change) {
+    if (change.instrument >= kMaxInstruments) {
+        return 0.0;
+    }
+    if (change.orders != 0) {
+        openOrders.fetch_add(change.orders, std::memory_order_acq_rel);
+    }
+    std::atomic<double>& side = change.buy ? working[change.instrument].buy : working[change.instrument].sell;
+    if (change.amount > 0.0) {
+        // Only orders checked here are reported, so the instrument's limits are loaded.
+        bool inverse = instrumentLimits[change.instrument].load().inverse;
+        double notional = change.amount * (inverse ? 1.0 : change.price);
+        atomicAdd(side, change.amount);
+        atomicAdd(workingNotional, notional);
+        return notional;
+    }
+    if (change.amount < 0.0) {
+        atomicAdd(side, change.amount);
+        atomicAdd(workingNotional, change.notional);
+    }
+    return 0.0;
+}
+
+// ------------------ Queries ------------------ //
+
+RiskStats RiskGate::stats() const {
+    RiskStats out{};
+    out.checked = checked.load(std::memory_order_relaxed);
+    out.passed = passed.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kRiskRejects; ++i) {
+        out.rejected[i] = rejected[i].load(std::memory_order_relaxed);
+    }
+    out.openOrders = openOrders.load(std::memory_order_relaxed);
+    out.workingNotional = workingNotional.load(std::memory_order_relaxed);
+    return out;
+}
+
+void RiskGate::logStats(const char* label) const {
+    RiskStats s = stats();
+    std::string rejects;
+    for (size_t i = 1; i < kRiskRejects; ++i) {
+        if (s.rejected[i] > 0) {
+            rejects += std::string(" ") + rejectName(static_cast<RiskReject>(i)) + "=" + std::to_string(s.rejected[i]);
+        }
+    }
+    latencyLogger->info("[Risk] {} checked={} passed={} open_orders={} working_notional={:.2f} rejected:{}",
+                        label, s.checked, s.passed, s.openOrders, s.workingNotional,
+                        rejects.empty() ? " none" : rejects);
+}
+
+const char* RiskGate::rejectName(RiskReject reason) {
+    switch (reason) {
+        case RiskReject::NONE: return "NONE";
+        case RiskReject::INVALID: return "INVALID";
+        case RiskReject::ORDER_SIZE: return "ORDER_SIZE";
+        case RiskReject::NOTIONAL: return "NOTIONAL";
+        case RiskReject::PRICE_COLLAR: return "PRICE_COLLAR";
+        case RiskReject::NO_REFERENCE_PRICE: return "NO_REFERENCE_PRICE";
+        case RiskReject::POSITION: return "POSITION";
+        case RiskReject::GROSS_NOTIONAL: return "GROSS_NOTIONAL";
+        case RiskReject::OPEN_ORDERS: return "OPEN_ORDERS";
+        default: return "UNKNOWN";
+    }
+}
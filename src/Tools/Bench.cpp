@@ -0,0 +1,1095 @@
+#include "ChannelDispatcher.h"
+#include "ConflatedSubscriber.h"
+#include "InstrumentRegistry.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "MessageParser.h"
+#include "OrderManager.h"
+#include "PositionEngine.h"
+#include "RateLimiter.h"
+#include "RestClient.h"
+#include "RiskGate.h"
+#include "TickerStore.h"
+#include "WebsocketClient.h"
+#include "trade.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Microbenchmarks for the hot paths. Each result is printed as one JSON line
+// so runs can be appended to a file and compared across commits:
+//   {"bench":"parse/book_change","label":"abc123","iterations":...,"ns_per_op":...,
+//    "ns_per_op_min":...,"allocs_per_op":...,"bytes_per_op":...}
+// ns_per_op is the median of the repeats. Allocations are counted on the
+// benchmark thread only, so background logger threads do not show up.
+//
+// usage: bench [--filter <substring>] [--label <text>] [--min-time <ms>] [--repeats <n>]
+
+// ------------------ Allocation counting ------------------ //
+
+static thread_local uint64_t allocCount = 0;
+static thread_local uint64_t allocBytes = 0;
+
+void* operator new(size_t size) {
+    ++allocCount;
+    allocBytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// ------------------ Harness ------------------ //
+
+// Keeps the compiler from discarding a value computed by the benchmark.
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchOptions {
+    std::string filter;
+    std::string label;
+    double minTimeMs = 100.0;
+    int repeats = 5;
+};
+
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchOptions& options) : options(options) {}
+
+    // op(i) runs one operation; i counts up from 0 across warm-up and repeats.
+    void run(const std::string& name, const std::function<void(uint64_t)>& op) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            return;
+        }
+        uint64_t i = 0;
+        // Calibrate: grow the batch until one batch takes min-time.
+        uint64_t iterations = 1;
+        for (;;) {
+            auto begin = std::chrono::steady_clock::now();
+            for (uint64_t n = 0; n < iterations; ++n) {
+                op(i++);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            if (ms >= options.minTimeMs || iterations >= (1ull << 30)) {
+                break;
+            }
+            iterations *= ms < options.minTimeMs / 10.0 ? 10 : 2;
+        }
+
+        std::vector<double> nsPerOp;
+        uint64_t allocs = 0;
+        uint64_t bytes = 0;
+        for (int r = 0; r < options.repeats; ++r) {
+            uint64_t allocsBefore = allocCount;
+            uint64_t bytesBefore = allocBytes;
+            auto begin = std::chrono::steady_clock::now();
+            for (uint64_t n = 0; n < iterations; ++n) {
+                op(i++);
+            }
+            auto end = std::chrono::steady_clock::now();
+            allocs = allocCount - allocsBefore;
+            bytes = allocBytes - bytesBefore;
+            nsPerOp.push_back(std::chrono::duration<double, std::nano>(end - begin).count() / iterations);
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        nlohmann::ordered_json line = {
+            {"bench", name},
+            {"label", options.label},
+            {"iterations", iterations},
+            {"ns_per_op", nsPerOp[nsPerOp.size() / 2]},
+            {"ns_per_op_min", nsPerOp.front()},
+            {"allocs_per_op", static_cast<double>(allocs) / iterations},
+            {"bytes_per_op", static_cast<double>(bytes) / iterations}
+        };
+        std::cout << line.dump() << std::endl;
+    }
+
+    // A line of counters gathered by a benchmark, under the same name filter.
+    void report(const std::string& name, const nlohmann::ordered_json& fields) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            return;
+        }
+        nlohmann::ordered_json line = {{"bench", name}, {"label", options.label}};
+        for (const auto& field : fields.items()) {
+            line[field.key()] = field.value();
+        }
+        std::cout << line.dump() << std::endl;
+    }
+
+private:
+    BenchOptions options;
+};
+
+// ------------------ Frames ------------------ //
+
+static const char* kInstrument = "BTC-PERPETUAL";
+static const int kSnapshotLevels = 20;
+// Change frames per snapshot in the book_change cycle.
+static const uint64_t kChangesPerSnapshot = 63;
+
+static std::string bookSnapshotFrame(int64_t changeId) {
+    std::string bids;
+    std::string asks;
+    char level[64];
+    for (int i = 0; i < kSnapshotLevels; ++i) {
+        std::snprintf(level, sizeof(level), "%s[\"new\",%.1f,%d.0]", i ? "," : "", 60000.0 - i * 0.5, 1000 + i * 10);
+        bids += level;
+        std::snprintf(level, sizeof(level), "%s[\"new\",%.1f,%d.0]", i ? "," : "", 60000.5 + i * 0.5, 1000 + i * 10);
+        asks += level;
+    }
+    char head[256];
+    std::snprintf(head, sizeof(head),
+                  "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"book.%s.raw\","
+                  "\"data\":{\"type\":\"snapshot\",\"timestamp\":1700000000000,\"instrument_name\":\"%s\","
+                  "\"change_id\":%lld,",
+                  kInstrument, kInstrument, static_cast<long long>(changeId));
+    return std::string(head) + "\"bids\":[" + bids + "],\"asks\":[" + asks + "]}}}";
+}
+
+// Changes one existing level per side, so a cycle leaves the book the same size.
+static std::string bookChangeFrame(int64_t changeId, int step) {
+    char frame[512];
+    int level = step % kSnapshotLevels;
+    std::snprintf(frame, sizeof(frame),
+                  "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"book.%s.raw\","
+                  "\"data\":{\"type\":\"change\",\"timestamp\":1700000000%03d,\"prev_change_id\":%lld,"
+                  "\"instrument_name\":\"%s\",\"change_id\":%lld,"
+                  "\"bids\":[[\"change\",%.1f,%d.0]],\"asks\":[[\"change\",%.1f,%d.0]]}}}",
+                  kInstrument, step % 1000, static_cast<long long>(changeId - 1), kInstrument,
+                  static_cast<long long>(changeId), 60000.0 - level * 0.5, 500 + step, 60000.5 + level * 0.5,
+                  700 + step);
+    return frame;
+}
+
+static std::string tickerFrame() {
+    return "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"ticker.BTC-PERPETUAL.raw\","
+           "\"data\":{\"timestamp\":1700000000000,\"stats\":{\"volume_usd\":512345670.0,\"volume\":8543.21,"
+           "\"price_change\":1.2345,\"low\":59100.0,\"high\":60450.5},\"state\":\"open\",\"settlement_price\":59876.12,"
+           "\"open_interest\":1234567890,\"min_price\":59100.0,\"max_price\":60900.0,\"mark_price\":60000.21,"
+           "\"last_price\":60000.5,\"interest_value\":0.0,\"instrument_name\":\"BTC-PERPETUAL\","
+           "\"index_price\":59990.87,\"funding_8h\":0.00001,\"estimated_delivery_price\":59990.87,"
+           "\"current_funding\":0.0,\"best_bid_price\":60000.0,\"best_bid_amount\":1000.0,"
+           "\"best_ask_price\":60000.5,\"best_ask_amount\":1000.0}}}";
+}
+
+// ------------------ Benchmarks ------------------ //
+
+static void benchParser(BenchRunner& runner) {
+    MessageParser parser;
+    auto parsed = std::make_unique<ParsedMessage>();
+    std::string change = bookChangeFrame(1001, 1);
+    std::string snapshot = bookSnapshotFrame(1000);
+    std::string ticker = tickerFrame();
+
+    runner.run("parse/book_change", [&](uint64_t) { keep(parser.parse(change, *parsed)); });
+    runner.run("parse/book_snapshot_20", [&](uint64_t) { keep(parser.parse(snapshot, *parsed)); });
+    runner.run("parse/ticker", [&](uint64_t) { keep(parser.parse(ticker, *parsed)); });
+    // Reference point for frames that fall back to nlohmann::json.
+    runner.run("parse/book_change_nlohmann", [&](uint64_t) {
+        auto message = nlohmann::json::parse(change);
+        keep(message.size());
+    });
+}
+
+// The same path the consumer thread runs: parse, dispatch, book apply, event log.
+static void benchHandler(BenchRunner& runner) {
+    // Never started: no connection and no consumer thread.
+    auto client = std::make_unique<WebsocketClient>(nullptr);
+    client->orderBooks().addBook(kInstrument);
+
+    // One snapshot followed by chained changes; replaying the cycle keeps change ids valid.
+    std::vector<std::string> cycle;
+    cycle.push_back(bookSnapshotFrame(1000));
+    for (uint64_t step = 1; step <= kChangesPerSnapshot; ++step) {
+        cycle.push_back(bookChangeFrame(1000 + static_cast<int64_t>(step), static_cast<int>(step)));
+    }
+    std::string snapshot = bookSnapshotFrame(1000);
+    std::string ticker = tickerFrame();
+
+    runner.run("handler/book_change", [&](uint64_t i) {
+        client->processFrame(cycle[i % cycle.size()], std::chrono::high_resolution_clock::now());
+    });
+    runner.run("handler/book_snapshot_20", [&](uint64_t) {
+        client->processFrame(snapshot, std::chrono::high_resolution_clock::now());
+    });
+    runner.run("handler/ticker", [&](uint64_t) {
+        client->processFrame(ticker, std::chrono::high_resolution_clock::now());
+    });
+}
+
+// Templated rendering must match the nlohmann::json reference byte for byte.
+// Returns the number of mismatches (each is printed to stderr).
+static int verifyOrderMessages() {
+    OrderMessageBuilder builder;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> amounts(0.0, 1000.0);
+    std::uniform_real_distribution<double> prices(0.0, 100000.0);
+    const double tricky[] = {0.0, -0.0, 0.1, 1.0, 1e21, 1e-7, 123456789.125, 5e-324, 1.7976931348623157e308,
+                             std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity()};
+    const char* instruments[] = {kInstrument, "ETH-PERPETUAL", "BTC-OPTIONS", "BTC_USDC"};
+    const char* sides[] = {"buy", "sell"};
+    const char* types[] = {"market", "limit"};
+
+    std::vector<OrderRequest> requests;
+    for (double value : tricky) {
+        requests.push_back(OrderRequest::place(kInstrument, value, "buy", "limit", value));
+        requests.push_back(OrderRequest::place("BTC-OPTIONS", value, "sell", "limit", value, "27DEC24", value, "put"));
+        requests.push_back(OrderRequest::edit("USDC-123456789", value, value));
+        requests.push_back(OrderRequest::place(kInstrument, value, "sell", "market", value, "", 0.0, "", "oms-1-42"));
+    }
+    for (int i = 0; i < 20000; ++i) {
+        const char* instrument = instruments[rng() % 4];
+        bool option = std::strcmp(instrument, "BTC-OPTIONS") == 0;
+        requests.push_back(OrderRequest::place(instrument, amounts(rng), sides[rng() % 2], types[rng() % 2], prices(rng),
+                                               option ? "27DEC24" : "", option ? prices(rng) : 0.0,
+                                               option ? (rng() & 1 ? "call" : "put") : ""));
+    }
+    requests.push_back(OrderRequest::cancel("USDC-123456789"));
+    requests.push_back(OrderRequest::cancel("needs \"escaping\""));
+    requests.push_back(OrderRequest::edit("", 1.0, 2.0));
+    requests.push_back(OrderRequest::place(kInstrument, 1.0, "buy", "limit", 2.0, "", 0.0, "", "quote \"a\""));
+
+    int mismatches = 0;
+    std::string rendered;
+    uint64_t ids[] = {0, 1, 42, 4294967296ULL, std::numeric_limits<uint64_t>::max()};
+    for (size_t i = 0; i < requests.size(); ++i) {
+        uint64_t id = i < 5 ? ids[i] : rng();
+        builder.render(rendered, id, requests[i]);
+        std::string expected = OrderMessageBuilder::renderJson(id, requests[i]);
+        if (rendered != expected) {
+            std::cerr << "order message mismatch:\n  template: " << rendered << "\n  json:     " << expected << std::endl;
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+// Average-cost PnL against hand-computed values: open, add, partial close
+// and flip on an inverse and a linear contract, fed through user.changes.
+// Returns the number of failed checks (each is printed to stderr).
+static int verifyPositionPnl() {
+    auto client = std::make_unique<WebsocketClient>(nullptr);
+    PositionEngine engine(*client);
+    auto trade = [&](const char* instrument, int64_t seq, const char* direction, double amount, double price,
+                     double fee, double mark) {
+        nlohmann::json fill = {{"instrument_name", instrument}, {"trade_seq", seq}, {"direction", direction},
+                               {"amount", amount}, {"price", price}, {"fee", fee}, {"mark_price", mark}};
+        engine.applyChanges(nlohmann::json{{"trades", {fill}}}.dump());
+    };
+    // Inverse, sized in USD: 100 @ 50000, +100 @ 40000 (average 44444.44), close
+    // 50 @ 60000, then sell 250 @ 50000 to close 150 and open 100 short.
+    trade(kInstrument, 1, "buy", 100.0, 50000.0, 0.00001, 50000.0);
+    trade(kInstrument, 2, "buy", 100.0, 40000.0, 0.0, 40000.0);
+    trade(kInstrument, 3, "sell", 50.0, 60000.0, 0.0, 60000.0);
+    trade(kInstrument, 3, "sell", 50.0, 60000.0, 0.0, 60000.0); // replayed, ignored
+    trade(kInstrument, 4, "sell", 250.0, 50000.0, 0.0, 40000.0);
+    // Linear, sized in ETH: 2 @ 3000, +2 @ 3200 (average 3100), close 1 @ 3300,
+    // then sell 5 @ 2900 to close 3 and open 2 short.
+    const char* linear = "ETH_USDC-PERPETUAL";
+    trade(linear, 1, "buy", 2.0, 3000.0, 0.0, 3000.0);
+    trade(linear, 2, "buy", 2.0, 3200.0, 0.0, 3200.0);
+    trade(linear, 3, "sell", 1.0, 3300.0, 0.0, 3300.0);
+    trade(linear, 4, "sell", 5.0, 2900.0, 0.5, 2800.0);
+
+    struct Expected {
+        const char* instrument;
+        double size, averagePrice, realizedPnl, unrealizedPnl;
+    };
+    const Expected expected[] = {
+        // 50 * (1/44444.44 - 1/60000) + 150 * (1/44444.44 - 1/50000) = 1/1500; short 100 marked at 40000.
+        {kInstrument, -100.0, 50000.0, 1.0 / 1500.0 - 0.00001, -100.0 * (1.0 / 50000.0 - 1.0 / 40000.0)},
+        // 1 * (3300 - 3100) + 3 * (2900 - 3100); short 2 marked at 2800.
+        {linear, -2.0, 2900.0, -400.0 - 0.5, -2.0 * (2800.0 - 2900.0)},
+    };
+    auto close = [](double a, double b) { return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b)); };
+    int failures = 0;
+    for (const Expected& want : expected) {
+        PositionView view;
+        if (!engine.position(want.instrument, view)) {
+            std::cerr << "position missing: " << want.instrument << std::endl;
+            ++failures;
+            continue;
+        }
+        if (!close(view.size, want.size) || !close(view.averagePrice, want.averagePrice) ||
+            !close(view.realizedPnl, want.realizedPnl) || !close(view.unrealizedPnl, want.unrealizedPnl)) {
+            std::cerr.precision(12);
+            std::cerr << "position mismatch for " << want.instrument << ":\n  engine:   size " << view.size
+                      << " avg " << view.averagePrice << " realized " << view.realizedPnl << " unrealized "
+                      << view.unrealizedPnl << "\n  expected: size " << want.size << " avg " << want.averagePrice
+                      << " realized " << want.realizedPnl << " unrealized " << want.unrealizedPnl << std::endl;
+            ++failures;
+        }
+    }
+    // |-100| USD plus 2 ETH at the 2900 average.
+    if (!close(engine.grossNotional(), 100.0 + 2.0 * 2900.0)) {
+        std::cerr << "gross notional mismatch: " << engine.grossNotional() << std::endl;
+        ++failures;
+    }
+    return failures;
+}
+
+// Prints 'what' to stderr when a check fails; returns 1 for a failure.
+static int expect(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "check failed: " << what << std::endl;
+    }
+    return ok ? 0 : 1;
+}
+
+// Snapshot, deltas, a sequence gap and recovery on the next snapshot.
+// Returns the number of failed checks (each is printed to stderr).
+static int verifyOrderBook() {
+    OrderBook book(kInstrument);
+    int failures = 0;
+    BookLevelUpdate early[] = {{BookAction::NEW, 59999.0, 5.0}};
+    failures += expect(book.apply(BookUpdate{false, 9, 8, 1, early, 1, nullptr, 0}) ==
+                       BookApplyResult::AWAITING_SNAPSHOT, "book: delta before the snapshot is held off");
+    failures += expect(!book.isValid() && book.bidLevels().empty(), "book: invalid and empty before the snapshot");
+
+    BookLevelUpdate bids[] = {{BookAction::NEW, 60000.0, 10.0}, {BookAction::NEW, 59999.5, 20.0}};
+    BookLevelUpdate asks[] = {{BookAction::NEW, 60000.5, 30.0}, {BookAction::NEW, 60001.0, 40.0}};
+    failures += expect(book.apply(BookUpdate{true, 10, 0, 2, bids, 2, asks, 2}) == BookApplyResult::APPLIED,
+                       "book: snapshot applies");
+    TopOfBook top = book.topOfBook();
+    failures += expect(top.valid && top.bidPrice == 60000.0 && top.askPrice == 60000.5 && top.changeId == 10,
+                       "book: top of book after the snapshot");
+
+    BookLevelUpdate bidChange[] = {{BookAction::DELETE, 60000.0, 0.0}, {BookAction::CHANGE, 59999.5, 25.0}};
+    BookLevelUpdate askChange[] = {{BookAction::NEW, 60000.25, 1.0}};
+    failures += expect(book.apply(BookUpdate{false, 11, 10, 3, bidChange, 2, askChange, 1}) ==
+                       BookApplyResult::APPLIED, "book: chained delta applies");
+    BookDepth depth = book.depth();
+    failures += expect(depth.valid && depth.bidCount == 1 && depth.bids[0].price == 59999.5 &&
+                       depth.bids[0].amount == 25.0 && depth.askCount == 3 && depth.asks[0].price == 60000.25 &&
+                       depth.asks[2].price == 60001.0, "book: levels after the delta, best first");
+
+    BookLevelUpdate gapped[] = {{BookAction::NEW, 59990.0, 1.0}};
+    failures += expect(book.apply(BookUpdate{false, 13, 12, 4, gapped, 1, nullptr, 0}) ==
+                       BookApplyResult::SEQUENCE_GAP, "book: missed change id is a gap");
+    failures += expect(!book.isValid() && !book.topOfBook().valid && !book.depth().valid,
+                       "book: a gap invalidates the published book");
+    failures += expect(book.apply(BookUpdate{false, 14, 13, 5, gapped, 1, nullptr, 0}) ==
+                       BookApplyResult::AWAITING_SNAPSHOT, "book: deltas after a gap wait for a snapshot");
+
+    BookLevelUpdate fresh[] = {{BookAction::NEW, 59000.0, 7.0}};
+    failures += expect(book.apply(BookUpdate{true, 20, 0, 6, fresh, 1, fresh, 0}) == BookApplyResult::APPLIED,
+                       "book: the next snapshot recovers");
+    top = book.topOfBook();
+    failures += expect(top.valid && top.bidPrice == 59000.0 && book.bidLevels().size() == 1 &&
+                       book.askLevels().empty() && book.lastChangeId() == 20,
+                       "book: a snapshot replaces every level");
+    book.invalidate();
+    failures += expect(!book.isValid() && !book.topOfBook().valid, "book: invalidate()");
+    return failures;
+}
+
+// One order object in the exchange's format.
+static std::string orderText(const char* orderId, const char* label, const char* state, double amount,
+                             double filled, int64_t updatedAt) {
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "{\"order_id\":\"%s\",\"label\":\"%s\",\"instrument_name\":\"%s\",\"order_state\":\"%s\","
+                  "\"direction\":\"buy\",\"order_type\":\"limit\",\"amount\":%.1f,\"price\":60000.0,"
+                  "\"filled_amount\":%.1f,\"average_price\":%.1f,\"creation_timestamp\":1,"
+                  "\"last_update_timestamp\":%lld}",
+                  orderId, label, kInstrument, state, amount, filled, filled > 0.0 ? 60000.0 : 0.0,
+                  static_cast<long long>(updatedAt));
+    return text;
+}
+
+// Every reject reason once, and reservations released by the order manager
+// as orders are rejected, filled, cancelled or settled by a reconcile.
+// Returns the number of failed checks (each is printed to stderr).
+static int verifyRiskGate() {
+    InstrumentRegistry registry;
+    OrderBookManager books(registry);
+    BookLevelUpdate bid{BookAction::NEW, 60000.0, 10000.0};
+    BookLevelUpdate ask{BookAction::NEW, 60000.5, 10000.0};
+    books.addBook(kInstrument)->apply(BookUpdate{true, 1, 0, 1700000000000, &bid, 1, &ask, 1});
+
+    RiskConfig config;
+    config.maxGrossNotional = 3000.0;
+    config.maxOpenOrders = 3;
+    config.requireReferencePrice = true;
+    RiskGate gate(registry, &books, nullptr, nullptr, config);
+    gate.setLimits(kInstrument, RiskLimits{2000.0, 1500.0, 0.05, 2500.0});
+    gate.setLimits("ETH_USDC-PERPETUAL", RiskLimits{10.0, 0.0, 0.05, 0.0});
+    OrderManager manager(registry, 16);
+    gate.attach(manager);
+
+    int failures = 0;
+    auto check = [&](OrderRequest request, RiskReject want, const char* what) {
+        failures += expect(gate.checkOrder(request) == want, what);
+    };
+    check(OrderRequest::place(kInstrument, 0.0, "buy", "limit", 60000.0), RiskReject::INVALID,
+          "risk: zero amount is INVALID");
+    check(OrderRequest::place("ETH-PERPETUAL", 1.0, "buy", "limit", 3000.0), RiskReject::INVALID,
+          "risk: instrument without limits is INVALID");
+    check(OrderRequest::place(kInstrument, 2500.0, "buy", "limit", 60000.0), RiskReject::ORDER_SIZE,
+          "risk: ORDER_SIZE");
+    check(OrderRequest::place(kInstrument, 1600.0, "buy", "limit", 60000.0), RiskReject::NOTIONAL,
+          "risk: NOTIONAL in USD on an inverse contract");
+    check(OrderRequest::place(kInstrument, 100.0, "buy", "limit", 63500.0), RiskReject::PRICE_COLLAR,
+          "risk: buy above the ask collar");
+    check(OrderRequest::place(kInstrument, 100.0, "sell", "limit", 56900.0), RiskReject::PRICE_COLLAR,
+          "risk: sell below the bid collar");
+    check(OrderRequest::place("ETH_USDC-PERPETUAL", 1.0, "buy", "market", 0.0), RiskReject::NO_REFERENCE_PRICE,
+          "risk: linear market order without a book");
+
+    // Resting buys of 1000, 1000 and 500: the position and open order limits in turn.
+    std::vector<OrderHandle> handles;
+    auto place = [&](double amount, const char* label, const char* side = "buy") {
+        OrderRequest request = OrderRequest::place(kInstrument, amount, side, "limit", 60000.0, "", 0.0, "", label);
+        RiskReject reason = gate.checkOrder(request);
+        if (reason == RiskReject::NONE) {
+            handles.push_back(manager.submit(request));
+        }
+        return reason;
+    };
+    failures += expect(place(1000.0, "risk-1") == RiskReject::NONE && place(1000.0, "risk-2") == RiskReject::NONE,
+                       "risk: orders within limits pass");
+    failures += expect(place(1000.0, "risk-x") == RiskReject::POSITION, "risk: POSITION counts working buys");
+    failures += expect(place(500.0, "risk-3") == RiskReject::NONE, "risk: third order passes");
+    failures += expect(place(400.0, "risk-x") == RiskReject::OPEN_ORDERS, "risk: OPEN_ORDERS");
+    RiskStats stats = gate.stats();
+    failures += expect(stats.openOrders == 3 && stats.workingNotional == 2500.0, "risk: three reservations held");
+
+    // Rejected by the exchange: its reservation goes at once.
+    manager.onResponse(handles[2], OrderAction::PLACE, false, "", false);
+    stats = gate.stats();
+    failures += expect(stats.openOrders == 2 && stats.workingNotional == 2000.0, "risk: a rejection releases");
+    // A sell stays within its side's position limit but not the gross one.
+    failures += expect(place(1200.0, "risk-x", "sell") == RiskReject::GROSS_NOTIONAL, "risk: GROSS_NOTIONAL");
+
+    // Acknowledged, half filled, then cancelled: released pro rata, then in full.
+    std::string acked = "{\"order\":" + orderText("BTC-1", "risk-1", "open", 1000.0, 0.0, 10) + ",\"trades\":[]}";
+    manager.onResponse(handles[0], OrderAction::PLACE, true, acked, false);
+    manager.applyOrders(orderText("BTC-1", "risk-1", "open", 1000.0, 500.0, 11));
+    stats = gate.stats();
+    failures += expect(stats.openOrders == 2 && stats.workingNotional == 1500.0, "risk: a fill releases its share");
+    manager.applyOrders(orderText("BTC-1", "risk-1", "cancelled", 1000.0, 500.0, 12));
+    stats = gate.stats();
+    failures += expect(stats.openOrders == 1 && stats.workingNotional == 1000.0, "risk: a cancel releases the rest");
+
+    // Lost with the session: held as UNKNOWN until a reconcile finds it gone.
+    manager.onResponse(handles[1], OrderAction::PLACE, false, R"({"message":"connection closed"})", true);
+    stats = gate.stats();
+    failures += expect(stats.openOrders == 1 && stats.workingNotional == 1000.0, "risk: an unknown order keeps it");
+    uint32_t round = manager.beginReconcile();
+    manager.finishReconcile(round, true, "[]");
+    stats = gate.stats();
+    failures += expect(stats.openOrders == 0 && stats.workingNotional == 0.0, "risk: a reconcile releases it");
+    return failures;
+}
+
+// Priority order of queued sends, bucket separation and cancel().
+// Returns the number of failed checks (each is printed to stderr).
+static int verifyRateLimiter() {
+    RateLimitOptions options;
+    options.matchingEngine = {100.0, 1.0};
+    RateLimiter limiter(options);
+    int failures = 0;
+    failures += expect(limiter.tryAcquire(RequestPriority::ORDER), "ratelimit: the burst credit is available");
+    failures += expect(!limiter.tryAcquire(RequestPriority::CANCEL), "ratelimit: an empty bucket refuses");
+
+    std::string order;
+    int owners[2];
+    auto sendOf = [&order](char tag) { return [&order, tag]() { order += tag; }; };
+    bool queued = limiter.submit(RequestPriority::ORDER, sendOf('o'), &owners[0]) != RateLimiter::Clock::time_point();
+    queued &= limiter.submit(RequestPriority::EDIT, sendOf('e'), &owners[0]) != RateLimiter::Clock::time_point();
+    queued &= limiter.submit(RequestPriority::ORDER, sendOf('x'), &owners[1]) != RateLimiter::Clock::time_point();
+    queued &= limiter.submit(RequestPriority::CANCEL, sendOf('c'), &owners[0]) != RateLimiter::Clock::time_point();
+    failures += expect(queued && order.empty(), "ratelimit: sends queue while the bucket is empty");
+    failures += expect(limiter.submit(RequestPriority::QUERY, sendOf('q')) == RateLimiter::Clock::time_point() &&
+                       order == "q", "ratelimit: queries use their own bucket");
+    failures += expect(limiter.cancel(&owners[1]) == 1, "ratelimit: cancel() drops the owner's sends");
+
+    auto deadline = RateLimiter::Clock::now() + std::chrono::seconds(2);
+    while (order.size() < 4 && RateLimiter::Clock::now() < deadline) {
+        auto next = limiter.drain();
+        if (next != RateLimiter::Clock::time_point()) {
+            std::this_thread::sleep_until(next);
+        }
+    }
+    failures += expect(order == "qceo", "ratelimit: queued sends run cancel, edit, order");
+    RateLimiterStats stats = limiter.stats();
+    failures += expect(stats.cancelled == 1 && stats.delayed[0] == 1 && stats.delayed[1] == 1 &&
+                       stats.delayed[2] == 1 && stats.sent[2] == 2, "ratelimit: counters");
+    return failures;
+}
+
+// Every state an order passes through, including a lost response (UNKNOWN)
+// and a reconcile that settles the table against the exchange's open orders.
+// Returns the number of failed checks (each is printed to stderr).
+static int verifyOrderStates() {
+    InstrumentRegistry registry;
+    OrderManager manager(registry, 16);
+    int failures = 0;
+    auto stateOf = [&](OrderHandle handle, OrderState want) {
+        ManagedOrder order;
+        return manager.get(handle, order) && order.state == want;
+    };
+    auto submit = [&](const char* label) {
+        OrderRequest request = OrderRequest::place(kInstrument, 100.0, "buy", "limit", 60000.0, "", 0.0, "", label);
+        return manager.submit(request);
+    };
+
+    OrderHandle first = submit("state-1");
+    failures += expect(stateOf(first, OrderState::PENDING_NEW), "orders: PENDING_NEW after submit");
+    std::string acked = "{\"order\":" + orderText("BTC-1", "state-1", "open", 100.0, 0.0, 10) + ",\"trades\":[]}";
+    manager.onResponse(first, OrderAction::PLACE, true, acked, false);
+    failures += expect(stateOf(first, OrderState::OPEN), "orders: OPEN once acknowledged");
+
+    OrderRequest edit = OrderRequest::edit("BTC-1", 200.0, 60001.0);
+    OrderHandle editing = manager.submit(edit);
+    failures += expect(stateOf(first, OrderState::PENDING_EDIT), "orders: PENDING_EDIT");
+    manager.onResponse(editing, OrderAction::EDIT, false, R"({"code":11044})", false);
+    failures += expect(stateOf(first, OrderState::OPEN), "orders: a rejected edit falls back");
+
+    manager.applyOrders(orderText("BTC-1", "state-1", "open", 100.0, 40.0, 11));
+    failures += expect(stateOf(first, OrderState::PARTIALLY_FILLED), "orders: PARTIALLY_FILLED");
+    OrderRequest cancel = OrderRequest::cancel("BTC-1");
+    OrderHandle cancelling = manager.submit(cancel);
+    failures += expect(stateOf(first, OrderState::PENDING_CANCEL), "orders: PENDING_CANCEL");
+    manager.onResponse(cancelling, OrderAction::CANCEL, false, R"({"message":"connection closed"})", true);
+    failures += expect(stateOf(first, OrderState::PARTIALLY_FILLED), "orders: a lost cancel falls back");
+
+    OrderHandle rejected = submit("state-2");
+    manager.onResponse(rejected, OrderAction::PLACE, false, R"({"code":10009})", false);
+    ManagedOrder order;
+    failures += expect(!manager.get(rejected, order) && manager.stats().rejected == 1,
+                       "orders: a rejected order is retired");
+
+    OrderHandle lost = submit("state-3");
+    OrderHandle found = submit("state-4");
+    OrderHandle inFlight = submit("state-5");
+    manager.onResponse(lost, OrderAction::PLACE, false, R"({"message":"connection closed"})", true);
+    manager.onResponse(found, OrderAction::PLACE, false, R"({"message":"connection closed"})", true);
+    failures += expect(stateOf(lost, OrderState::UNKNOWN) && stateOf(found, OrderState::UNKNOWN),
+                       "orders: UNKNOWN after a transport failure");
+
+    uint32_t round = manager.beginReconcile();
+    failures += expect(round != 0 && manager.beginReconcile() == 0, "orders: one reconcile at a time");
+    OrderHandle later = submit("state-6");
+    std::string open = "[" + orderText("BTC-1", "state-1", "open", 100.0, 40.0, 11) + "," +
+                       orderText("BTC-4", "state-4", "open", 100.0, 0.0, 12) + "]";
+    failures += expect(manager.finishReconcile(round, true, open), "orders: a second round was asked for");
+    failures += expect(!manager.get(lost, order) && manager.stats().rejected == 2,
+                       "orders: an unknown order the exchange does not list is rejected");
+    failures += expect(manager.find("BTC-4", order) && order.state == OrderState::OPEN,
+                       "orders: an unknown order the exchange lists is adopted by its label");
+    failures += expect(stateOf(first, OrderState::PARTIALLY_FILLED), "orders: a listed order is kept");
+    failures += expect(stateOf(inFlight, OrderState::PENDING_NEW) && stateOf(later, OrderState::PENDING_NEW),
+                       "orders: orders still in flight are left alone");
+
+    manager.applyOrders(orderText("BTC-1", "state-1", "filled", 100.0, 100.0, 13));
+    failures += expect(!manager.find("BTC-1", order) && manager.stats().filled == 1, "orders: FILLED retires");
+    manager.applyOrders(orderText("BTC-1", "state-1", "open", 100.0, 40.0, 14));
+    failures += expect(!manager.find("BTC-1", order), "orders: a late report of a finished order is ignored");
+    return failures;
+}
+
+// The registry filled to capacity: every name and channel resolves to its
+// own id through the probe sequences, and the next intern is refused.
+// Returns the number of failed checks (each is printed to stderr).
+static int verifyInstrumentRegistry() {
+    InstrumentRegistry registry;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < kMaxInstruments; ++i) {
+        names.push_back("BTC-" + std::to_string(i));
+    }
+    int failures = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (registry.intern(names[i]) != i) {
+            failures += expect(false, "registry: ids are handed out in order");
+            break;
+        }
+    }
+    failures += expect(registry.size() == kMaxInstruments, "registry: full");
+    failures += expect(registry.intern("ETH-PERPETUAL") == kNoInstrument, "registry: intern past capacity");
+    failures += expect(registry.intern(names[7]) == 7, "registry: a known name still interns when full");
+    size_t wrong = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        InstrumentId id = static_cast<InstrumentId>(i);
+        wrong += registry.find(names[i]) != id || registry.name(id) != names[i];
+        for (size_t kind = 0; kind < kChannelKinds; ++kind) {
+            ChannelKey key = registry.resolveChannel(registry.channelName(static_cast<ChannelKind>(kind), id));
+            wrong += key.kind != static_cast<ChannelKind>(kind) || key.instrument != id;
+        }
+    }
+    failures += expect(wrong == 0, "registry: every name and channel resolves to its id");
+    failures += expect(registry.find("BTC-1024") == kNoInstrument && registry.find("BTC-") == kNoInstrument &&
+                       registry.resolveChannel("book.BTC-1.100ms").instrument == kNoInstrument,
+                       "registry: unknown names miss");
+    return failures;
+}
+
+static void benchPayloads(BenchRunner& runner) {
+    HttpPoolOptions poolOptions;
+    poolOptions.size = 1;
+    poolOptions.warmOnStart = false;
+    poolOptions.warmInterval = std::chrono::seconds(0);
+    RestClient restClient(nullptr, poolOptions);
+
+    OrderRequest buy = OrderRequest::place(kInstrument, 10.0, "buy", "limit", 60000.5);
+    OrderRequest sell = OrderRequest::place(kInstrument, 10.0, "sell", "limit", 60000.5);
+    OrderRequest option = OrderRequest::place("BTC-OPTIONS", 1.0, "buy", "limit", 0.05, "27DEC24", 60000.0, "call");
+    OrderRequest edit = OrderRequest::edit("USDC-123456789", 20.0, 60001.0);
+    OrderRequest cancel = OrderRequest::cancel("USDC-123456789");
+    std::string buffer;
+
+    runner.run("payload/place_limit", [&](uint64_t i) {
+        OrderRequest& request = i & 1 ? buy : sell;
+        request.price = 60000.5 + static_cast<double>(i & 63);
+        restClient.payloadFor(request, buffer);
+        keep(buffer.size());
+    });
+    runner.run("payload/place_option", [&](uint64_t) {
+        restClient.payloadFor(option, buffer);
+        keep(buffer.size());
+    });
+    runner.run("payload/edit", [&](uint64_t) {
+        restClient.payloadFor(edit, buffer);
+        keep(buffer.size());
+    });
+    runner.run("payload/cancel", [&](uint64_t) {
+        restClient.payloadFor(cancel, buffer);
+        keep(buffer.size());
+    });
+    // The nlohmann::json construction the templates replaced, for comparison.
+    runner.run("payload/place_limit_json", [&](uint64_t i) {
+        keep(OrderMessageBuilder::renderJson(1, i & 1 ? buy : sell).size());
+    });
+    runner.run("payload/cancel_json", [&](uint64_t) {
+        keep(OrderMessageBuilder::renderJson(1, cancel).size());
+    });
+}
+
+// Order table with 10000 resting orders: id lookups, fills on resting orders,
+// and a full submit / acknowledge / fill cycle through a recycled slot.
+static void benchOrders(BenchRunner& runner) {
+    const size_t kResting = 10000;
+    InstrumentRegistry registry;
+    registry.intern(kInstrument);
+    OrderManager manager(registry, 16384);
+
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < kResting; ++i) {
+        ids.push_back("BTC-" + std::to_string(9000000000ULL + i));
+    }
+    OrderUpdate update{};
+    update.instrument = kInstrument;
+    update.direction = "buy";
+    update.orderType = "limit";
+    update.orderState = "open";
+    update.amount = 1000.0;
+    update.price = 60000.0;
+    for (size_t i = 0; i < kResting; ++i) {
+        update.orderId = ids[i];
+        update.updatedAt = 1;
+        manager.apply(update);
+    }
+
+    runner.run("orders/find_by_id_10k", [&](uint64_t i) {
+        ManagedOrder out;
+        keep(manager.find(ids[(i * 7919) % kResting], out));
+        keep(out.state);
+    });
+    runner.run("orders/partial_fill_10k", [&](uint64_t i) {
+        OrderUpdate fill = update;
+        fill.orderId = ids[(i * 7919) % kResting];
+        fill.filledAmount = static_cast<double>(i % 999 + 1);
+        fill.updatedAt = static_cast<int64_t>(i + 2);
+        manager.apply(fill);
+    });
+
+    // A user.orders notification decoded from its text and looked up. Replays
+    // are older than what the table holds, so after the first pass this is
+    // the decode and lookup without the update.
+    std::vector<std::string> notifications;
+    for (size_t i = 0; i < 64; ++i) {
+        notifications.push_back(R"({"order_id":")" + ids[(i * 7919) % kResting] +
+                                R"(","label":"","instrument_name":"BTC-PERPETUAL","order_state":"open",)"
+                                R"("direction":"buy","order_type":"limit","amount":1000.0,"price":60000.0,)"
+                                R"("filled_amount":)" + std::to_string(i + 1) +
+                                R"(.0,"average_price":60000.0,"creation_timestamp":1,"last_update_timestamp":)" +
+                                std::to_string(i + 1000000000) + "}");
+    }
+    runner.run("orders/decode_notification_10k", [&](uint64_t i) {
+        keep(manager.applyOrders(notifications[i % notifications.size()]));
+    });
+
+    OrderRequest request = OrderRequest::place(kInstrument, 10.0, "buy", "limit", 60000.5, "", 0.0, "", "bench-cycle");
+    OrderUpdate ack = update;
+    ack.orderId = "BTC-8999999999";
+    ack.label = "bench-cycle";
+    OrderUpdate filled = ack;
+    filled.orderState = "filled";
+    filled.filledAmount = ack.amount;
+    runner.run("orders/submit_ack_fill", [&](uint64_t i) {
+        keep(manager.submit(request));
+        ack.updatedAt = static_cast<int64_t>(i + 1);
+        filled.updatedAt = ack.updatedAt;
+        manager.apply(ack);
+        manager.apply(filled);
+    });
+}
+
+// Every check runs against a valid book; passing orders are released through
+// the exposure feed the way a cancel would, so the counters stay flat.
+static void benchRisk(BenchRunner& runner) {
+    InstrumentRegistry registry;
+    OrderBookManager books(registry);
+    OrderBook* book = books.addBook(kInstrument);
+    BookLevelUpdate bid{BookAction::NEW, 60000.0, 10000.0};
+    BookLevelUpdate ask{BookAction::NEW, 60000.5, 10000.0};
+    BookUpdate snapshot{true, 1, 0, 1700000000000, &bid, 1, &ask, 1};
+    book->apply(snapshot);
+
+    RiskConfig config;
+    config.defaults = RiskLimits{100000.0, 1000000.0, 0.05, 500000.0};
+    config.maxGrossNotional = 10000000.0;
+    config.maxOpenOrders = 1000;
+    RiskGate gate(registry, &books, nullptr, nullptr, config);
+    gate.setLimits(kInstrument);
+    OrderManager manager(registry, 1024);
+    gate.attach(manager);
+    InstrumentId id = registry.find(kInstrument);
+
+    OrderRequest order = OrderRequest::place(kInstrument, 1000.0, "buy", "limit", 60010.0);
+    runner.run("risk/check_place", [&](uint64_t) {
+        keep(gate.checkOrder(order));
+        gate.onExposure(ExposureChange{id, true, -1, -order.amount, order.price, -order.reservedNotional});
+        order.riskReserved = false;
+    });
+    OrderRequest collared = OrderRequest::place(kInstrument, 1000.0, "buy", "limit", 70000.0);
+    runner.run("risk/check_reject_collar", [&](uint64_t) {
+        keep(gate.checkOrder(collared));
+    });
+    ManagedOrder resting{};
+    resting.instrument = id;
+    resting.buy = true;
+    resting.limit = true;
+    resting.amount = 1000.0;
+    resting.price = 60000.0;
+    runner.run("risk/check_edit", [&](uint64_t i) {
+        keep(gate.checkEdit(resting, 1000.0 + static_cast<double>(i & 7), 60001.0));
+    });
+}
+
+// The cost every outbound request pays while credits are available, then a
+// bucket refilling slower than the loop submits: sends of mixed priority
+// queue and run from drain(). The queue's counters follow as ratelimit/stats.
+static void benchRateLimiter(BenchRunner& runner) {
+    RateLimitOptions options;
+    options.matchingEngine = {1e12, 1e12};
+    RateLimiter limiter(options);
+    runner.run("ratelimit/try_acquire", [&](uint64_t) {
+        keep(limiter.tryAcquire(RequestPriority::ORDER));
+    });
+
+    RateLimitOptions tight;
+    tight.matchingEngine = {2e6, 16.0};
+    RateLimiter contended(tight);
+    uint64_t submitted = 0;
+    uint64_t ran = 0;
+    auto send = [&ran]() { ++ran; };
+    runner.run("ratelimit/submit_drain_contended", [&](uint64_t i) {
+        contended.submit(static_cast<RequestPriority>(i % 3), send);
+        ++submitted;
+        // Bounds the backlog so the waits stay comparable between runs.
+        do {
+            contended.drain();
+        } while (submitted - ran > 64);
+    });
+    if (submitted == 0) {
+        return; // filtered out
+    }
+    RateLimiterStats stats = contended.stats();
+    nlohmann::ordered_json fields;
+    for (size_t p = 0; p < 3; ++p) {
+        fields[RateLimiter::priorityName(static_cast<RequestPriority>(p))] = {
+            {"queued", stats.queued[p]},
+            {"sent", stats.sent[p]},
+            {"delayed", stats.delayed[p]},
+            {"wait_total_us", stats.totalWaitNs[p] / 1000.0},
+            {"wait_mean_us", stats.delayed[p] ? stats.totalWaitNs[p] / 1000.0 / stats.delayed[p] : 0.0},
+            {"wait_max_us", stats.maxWaitNs[p] / 1000.0}
+        };
+    }
+    fields["throttled"] = stats.throttled;
+    runner.report("ratelimit/stats", fields);
+}
+
+static void benchInstrumentNames(BenchRunner& runner) {
+    runner.run("instrument/spot_to_string", [&](uint64_t i) {
+        keep(Trade::spotInstrumentToString(static_cast<SpotInstrument>(i % 2)).size());
+    });
+    runner.run("instrument/futures_to_string", [&](uint64_t i) {
+        keep(Trade::futuresInstrumentToString(static_cast<FuturesInstrument>(i % 6)).size());
+    });
+    runner.run("instrument/options_to_string", [&](uint64_t i) {
+        keep(Trade::optionsInstrumentToString(static_cast<OptionsInstrument>(i % 2)).size());
+    });
+}
+
+// std::set lookups as a baseline for the registry that routes incoming channels.
+static void benchChannels(BenchRunner& runner) {
+    std::vector<std::string> instruments = {"BTC-PERPETUAL", "ETH-PERPETUAL", "USDC-PERPETUAL", "USDT-PERPETUAL",
+                                            "BTC-FUTURES", "ETH-FUTURES", "BTC-OPTIONS", "ETH-OPTIONS"};
+    std::set<std::string> subscribedChannels;
+    for (const auto& instrument : instruments) {
+        subscribedChannels.insert("book." + instrument + ".raw");
+        subscribedChannels.insert("ticker." + instrument + ".raw");
+    }
+    std::string hit = "book.ETH-PERPETUAL.raw";
+    std::string miss = "book.SOL-PERPETUAL.raw";
+
+    runner.run("channels/find_hit", [&](uint64_t) { keep(subscribedChannels.find(hit) != subscribedChannels.end()); });
+    runner.run("channels/find_miss", [&](uint64_t) { keep(subscribedChannels.find(miss) != subscribedChannels.end()); });
+    runner.run("channels/build_and_find", [&](uint64_t i) {
+        std::string channel = "book." + instruments[i % instruments.size()] + ".raw";
+        keep(subscribedChannels.find(channel) != subscribedChannels.end());
+    });
+
+    InstrumentRegistry registry;
+    registry.intern(instruments);
+    std::vector<std::string> incoming;
+    for (const auto& channel : subscribedChannels) {
+        incoming.push_back(channel);
+    }
+    runner.run("channels/registry_resolve", [&](uint64_t i) {
+        keep(registry.resolveChannel(incoming[i % incoming.size()]).instrument);
+    });
+    runner.run("channels/registry_resolve_miss", [&](uint64_t) {
+        keep(registry.resolveChannel(miss).instrument);
+    });
+}
+
+// Counts events per kind; the static path inlines these into the dispatch switch.
+struct CountingSink {
+    uint64_t books = 0;
+    uint64_t tickers = 0;
+    uint64_t trades = 0;
+    uint64_t userOrders = 0;
+    uint64_t userTrades = 0;
+    void onBook(const BookEvent&) { ++books; }
+    void onTicker(const ChannelDataEvent& event) { tickers += event.instrument; }
+    void onTrades(const ChannelDataEvent& event) { trades += event.instrument; }
+    void onUserOrders(const ChannelDataEvent& event) { userOrders += event.instrument; }
+    void onUserTrades(const ChannelDataEvent& event) { userTrades += event.instrument; }
+};
+
+// Channel name to handler, with 600 subscribed channels (150 instruments x 4 kinds).
+static void benchDispatch(BenchRunner& runner) {
+    const ChannelKind kinds[] = {ChannelKind::TICKER, ChannelKind::TRADES, ChannelKind::USER_ORDERS,
+                                 ChannelKind::USER_TRADES};
+    InstrumentRegistry registry;
+    std::vector<std::string> names;
+    for (int i = 0; i < 150; ++i) {
+        names.push_back("BTC-" + std::to_string(27 + i) + "DEC25-" + std::to_string(40000 + i * 1000) + "-C");
+    }
+    std::vector<InstrumentId> ids = registry.intern(names);
+
+    CountingSink sink;
+    ChannelDispatcher dispatcher;
+    std::vector<std::string> channels;
+    for (InstrumentId id : ids) {
+        for (ChannelKind kind : kinds) {
+            channels.push_back(registry.channelName(kind, id));
+        }
+        dispatcher.onTicker(id, [&sink](const ChannelDataEvent& event) { sink.onTicker(event); });
+        dispatcher.onTrades(id, [&sink](const ChannelDataEvent& event) { sink.onTrades(event); });
+        dispatcher.onUserOrders(id, [&sink](const ChannelDataEvent& event) { sink.onUserOrders(event); });
+        dispatcher.onUserTrades(id, [&sink](const ChannelDataEvent& event) { sink.onUserTrades(event); });
+    }
+    std::string_view data = "{}";
+
+    runner.run("dispatch/runtime_600ch", [&](uint64_t i) {
+        const std::string& channel = channels[(i * 7919) % channels.size()];
+        ChannelKey key = registry.resolveChannel(channel);
+        keep(dispatcher.dispatch(ChannelDataEvent{key.kind, key.instrument, data}));
+    });
+    runner.run("dispatch/static_600ch", [&](uint64_t i) {
+        const std::string& channel = channels[(i * 7919) % channels.size()];
+        ChannelKey key = registry.resolveChannel(channel);
+        dispatchStatic(sink, ChannelDataEvent{key.kind, key.instrument, data});
+    });
+    keep(sink.tickers + sink.trades + sink.userOrders + sink.userTrades);
+}
+
+// Ticker decode and seqlock store with 1000 instruments, then reads with and
+// without a writer thread updating every slot.
+static void benchTickers(BenchRunner& runner) {
+    const size_t kTickers = 1000;
+    MessageParser parser;
+    auto parsed = std::make_unique<ParsedMessage>();
+    std::string frame = tickerFrame();
+    parser.parse(frame, *parsed);
+    std::string_view data = parsed->data;
+
+    TickerStore store;
+    TickerSnapshot ticker;
+    parser.parseTicker(data, ticker);
+    for (size_t i = 0; i < kTickers; ++i) {
+        store.store(static_cast<InstrumentId>(i), ticker);
+    }
+
+    runner.run("ticker/parse_store", [&](uint64_t i) {
+        TickerSnapshot decoded;
+        parser.parseTicker(data, decoded);
+        store.store(static_cast<InstrumentId>(i % kTickers), decoded);
+    });
+    runner.run("ticker/load", [&](uint64_t i) {
+        TickerSnapshot out;
+        keep(store.load(static_cast<InstrumentId>((i * 7919) % kTickers), out));
+        keep(out.markPrice);
+    });
+    runner.run("ticker/load_mark", [&](uint64_t i) {
+        double mark;
+        keep(store.loadField(static_cast<InstrumentId>((i * 7919) % kTickers), TickerField::MARK_PRICE, mark));
+        keep(mark);
+    });
+
+    std::atomic<bool> writing{true};
+    std::thread writer([&]() {
+        TickerSnapshot update = ticker;
+        for (uint64_t i = 0; writing.load(std::memory_order_relaxed); ++i) {
+            update.markPrice = 60000.0 + static_cast<double>(i & 1023);
+            store.store(static_cast<InstrumentId>(i % kTickers), update);
+        }
+    });
+    runner.run("ticker/load_with_writer", [&](uint64_t i) {
+        TickerSnapshot out;
+        keep(store.load(static_cast<InstrumentId>((i * 7919) % kTickers), out));
+        keep(out.markPrice);
+    });
+    writing.store(false);
+    writer.join();
+}
+
+// Conflated subscriber with 150 books: the handler cost on the consumer
+// thread, and a reader's poll when idle and when every book changed.
+static void benchConflation(BenchRunner& runner) {
+    const size_t kBooks = 150;
+    OrderBook book(kInstrument);
+    TickerStore tickers;
+    ChannelDispatcher dispatcher;
+    ConflatedSubscriber subscriber(dispatcher, [&tickers](InstrumentId instrument, TickerSnapshot& out) {
+        return tickers.load(instrument, out);
+    });
+    BookUpdate update{false, 0, 0, 0, nullptr, 0, nullptr, 0};
+    uint64_t seen = 0;
+    auto reader = [&seen](const ConflatedUpdate& conflated) { seen += conflated.bookUpdates; };
+
+    runner.run("conflate/dispatch_book", [&](uint64_t i) {
+        keep(dispatcher.dispatch(BookEvent{static_cast<InstrumentId>(i % kBooks), update, book}));
+    });
+    subscriber.poll(reader);
+    runner.run("conflate/poll_idle", [&](uint64_t) { keep(subscriber.poll(reader)); });
+    runner.run("conflate/mark_and_poll_150", [&](uint64_t) {
+        for (size_t b = 0; b < kBooks; ++b) {
+            subscriber.markBook(static_cast<InstrumentId>(b), book);
+        }
+        keep(subscriber.poll(reader));
+    });
+    keep(seen);
+}
+
+static void benchLogger(BenchRunner& runner) {
+    runner.run("logger/system_info", [&](uint64_t i) {
+        systemLogger->info("[Bench] order {} acknowledged in {} ns", i, 12345);
+    });
+    runner.run("logger/orderbook_info", [&](uint64_t i) {
+        orderbook->info("[OrderBook] {} change {}", kInstrument, i);
+    });
+    runner.run("logger/filtered_debug", [&](uint64_t i) {
+        systemLogger->debug("[Bench] filtered {}", i);
+    });
+    runner.run("logger/binary_book_delta", [&](uint64_t i) {
+        binaryLogger->logBookDelta(kInstrument, std::strlen(kInstrument), static_cast<int64_t>(i),
+                                   1700000000000, 1, 1, 60000.0, 60000.5);
+    });
+    runner.run("logger/latency_record", [&](uint64_t i) {
+        recordLatency(LatencyProbe::PARSE, static_cast<int64_t>(i & 1023));
+    });
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            options.label = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.minTimeMs = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            options.repeats = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--filter <substring>] [--label <text>] [--min-time <ms>] [--repeats <n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    initLogger();
+    if (int mismatches = verifyOrderMessages()) {
+        std::cerr << mismatches << " order message(s) differ from the json rendering" << std::endl;
+        shutdownLogger();
+        return 1;
+    }
+    if (int failures = verifyPositionPnl()) {
+        std::cerr << failures << " position / PnL check(s) failed" << std::endl;
+        shutdownLogger();
+        return 1;
+    }
+    int failures = verifyOrderBook() + verifyRiskGate() + verifyRateLimiter() + verifyOrderStates() +
+                   verifyInstrumentRegistry();
+    if (failures) {
+        std::cerr << failures << " order book / risk / rate limit / order state / registry check(s) failed"
+                  << std::endl;
+        shutdownLogger();
+        return 1;
+    }
+    BenchRunner runner(options);
+    benchParser(runner);
+    benchHandler(runner);
+    benchPayloads(runner);
+    benchOrders(runner);
+    benchRisk(runner);
+    benchRateLimiter(runner);
+    benchInstrumentNames(runner);
+    benchChannels(runner);
+    benchDispatch(runner);
+    benchTickers(runner);
+    benchConflation(runner);
+    benchLogger(runner);
+    shutdownLogger();
+    return 0;
+}
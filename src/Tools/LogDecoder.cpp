@@ -0,0 +1,34 @@
+#include "BinaryLog.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// Decodes binary event logs written by BinaryLog into one text line per record.
+// usage: log_decoder logs/events.bin [logs/events.bin.1 ...]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <events.bin> [more files...]" << std::endl;
+        return 1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        FILE* file = fopen(argv[i], "rb");
+        if (!file) {
+            std::cerr << "cannot open " << argv[i] << std::endl;
+            return 1;
+        }
+        BinaryLogHeader header{};
+        if (fread(&header, sizeof(header), 1, file) != 1 ||
+            std::memcmp(header.magic, "TBLOG001", sizeof(header.magic)) != 0 ||
+            header.recordSize != sizeof(BinaryRecord)) {
+            std::cerr << argv[i] << ": not a binary event log" << std::endl;
+            fclose(file);
+            return 1;
+        }
+        BinaryRecord record;
+        while (fread(&record, sizeof(record), 1, file) == 1) {
+            std::cout << BinaryLog::format(record) << '\n';
+        }
+        fclose(file);
+    }
+    return 0;
+}
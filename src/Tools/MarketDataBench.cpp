@@ -0,0 +1,184 @@
+#include "Authorisation.h"
+#include "ConflatedSubscriber.h"
+#include "Logger.h"
+#include "MarketDataManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures market data throughput of MarketDataManager: subscribes synthetic
+// book channels, spread over N connections, and reports the frames received
+// per second per shard and in total. Run it against bin/mock_exchange; since
+// one mock runs on a single thread, give each connection its own mock to see
+// client-side scaling:
+//   ./bin/mock_exchange --port 8443 --book-rate 2000 &
+//   ./bin/mock_exchange --port 8444 --book-rate 2000 &
+//   md_bench wss://127.0.0.1:8443/ws/api/v2,wss://127.0.0.1:8444/ws/api/v2 --connections 2
+//
+// usage: md_bench <ws-url>[,<ws-url>...] [--connections n] [--instruments n] [--seconds n]
+//                 [--policy hash|rate] [--pin] [--slow-reader-us n]
+// The REST endpoint for authentication is derived from the first URL.
+// --pin puts shard i's I/O thread on CPU 2i and its consumer on CPU 2i+1.
+// --slow-reader-us adds a conflated subscriber whose reader spends n us on
+// each update it gets, and reports how many book updates it skipped.
+
+static std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) {
+            comma = text.size();
+        }
+        if (comma > start) {
+            parts.push_back(text.substr(start, comma - start));
+        }
+        start = comma + 1;
+    }
+    return parts;
+}
+
+// wss://host:port/ws/api/v2 -> https://host:port
+static std::string restBaseFor(const std::string& wsUrl) {
+    std::string url = wsUrl;
+    if (url.compare(0, 6, "wss://") == 0) {
+        url = "https://" + url.substr(6);
+    } else if (url.compare(0, 5, "ws://") == 0) {
+        url = "http://" + url.substr(5);
+    }
+    size_t path = url.find('/', url.find("//") + 2);
+    return path == std::string::npos ? url : url.substr(0, path);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <ws-url>[,<ws-url>...] [--connections n] [--instruments n]"
+                  << " [--seconds n] [--policy hash|rate] [--pin] [--slow-reader-us n]" << std::endl;
+        return 1;
+    }
+    MarketDataOptions options;
+    options.urls = splitList(argv[1]);
+    options.connections = options.urls.size();
+    size_t instruments = 64;
+    int seconds = 10;
+    bool pin = false;
+    int slowReaderUs = -1;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            options.connections = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--instruments") == 0 && i + 1 < argc) {
+            instruments = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            options.policy = std::strcmp(argv[++i], "rate") == 0 ? ShardPolicy::RATE : ShardPolicy::HASH;
+        } else if (std::strcmp(argv[i], "--pin") == 0) {
+            pin = true;
+        } else if (std::strcmp(argv[i], "--slow-reader-us") == 0 && i + 1 < argc) {
+            slowReaderUs = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (options.urls.empty() || options.connections == 0) {
+        std::cerr << "need at least one URL and one connection" << std::endl;
+        return 1;
+    }
+    if (pin) {
+        for (size_t i = 0; i < options.connections; ++i) {
+            options.ioCpus.push_back(static_cast<int>(2 * i));
+            options.consumerCpus.push_back(static_cast<int>(2 * i + 1));
+        }
+    }
+    initLogger();
+    HttpPoolOptions httpOptions;
+    httpOptions.baseUrl = restBaseFor(options.urls[0]);
+    httpOptions.verifyPeer = false;
+    {
+        Authorization auth("md_bench", "md_bench", httpOptions);
+        MarketDataManager manager(&auth, options);
+        // Dispatched on the shard threads; the count only checks that events reach consumers.
+        std::atomic<uint64_t> bookEvents{0};
+        manager.channels().onBook(kNoInstrument, [&bookEvents](const BookEvent&) {
+            bookEvents.fetch_add(1, std::memory_order_relaxed);
+        });
+        std::unique_ptr<ConflatedSubscriber> conflated;
+        std::atomic<bool> reading{false};
+        std::atomic<uint64_t> readerUpdates{0};
+        std::thread reader;
+        if (slowReaderUs >= 0) {
+            ConflationOptions conflation;
+            conflation.tickers = false;
+            conflated = std::make_unique<ConflatedSubscriber>(manager, conflation);
+            reading.store(true);
+            reader = std::thread([&]() {
+                auto work = std::chrono::microseconds(slowReaderUs);
+                while (reading.load(std::memory_order_relaxed)) {
+                    size_t polled = conflated->poll([&](const ConflatedUpdate&) {
+                        auto until = std::chrono::steady_clock::now() + work;
+                        while (std::chrono::steady_clock::now() < until) {
+                        }
+                        readerUpdates.fetch_add(1, std::memory_order_relaxed);
+                    });
+                    if (polled == 0) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    }
+                }
+            });
+        }
+        manager.start();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        std::vector<std::string> names;
+        for (size_t i = 0; i < instruments; ++i) {
+            names.push_back("SYN-" + std::to_string(i) + "-PERPETUAL");
+        }
+        manager.subscribeToOrderBook(names);
+        // Let snapshots arrive before measuring.
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        std::vector<ShardStats> before = manager.stats();
+        uint64_t eventsBefore = bookEvents.load();
+        ConflationStats conflatedBefore = conflated ? conflated->stats() : ConflationStats{};
+        uint64_t readerBefore = readerUpdates.load();
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        std::vector<ShardStats> after = manager.stats();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t total = 0;
+        for (size_t i = 0; i < after.size(); ++i) {
+            uint64_t frames = after[i].frames - before[i].frames;
+            total += frames;
+            std::cout << "shard " << i << ": " << after[i].instruments << " instruments, "
+                      << static_cast<uint64_t>(frames / elapsed) << " frames/s, dropped "
+                      << after[i].ring.dropped - before[i].ring.dropped << ", ring high watermark "
+                      << after[i].ring.highWatermark << "\n";
+        }
+        std::cout << "total: " << static_cast<uint64_t>(total / elapsed) << " frames/s, "
+                  << static_cast<uint64_t>((bookEvents.load() - eventsBefore) / elapsed) << " book events/s over "
+                  << options.connections << " connection(s)" << std::endl;
+        if (conflated) {
+            ConflationStats conflatedAfter = conflated->stats();
+            size_t book = static_cast<size_t>(ConflatedKind::BOOK);
+            std::cout << "conflated reader (" << slowReaderUs << " us/update): "
+                      << static_cast<uint64_t>((readerUpdates.load() - readerBefore) / elapsed) << " updates/s, "
+                      << conflatedAfter.conflated[book] - conflatedBefore.conflated[book] << " of "
+                      << conflatedAfter.updates[book] - conflatedBefore.updates[book]
+                      << " book updates conflated, " << conflatedAfter.dirty << " instruments dirty" << std::endl;
+        }
+        manager.stop();
+        if (reader.joinable()) {
+            reading.store(false);
+            reader.join();
+        }
+    }
+    shutdownLogger();
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include "FrameJournal.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "MessageParser.h"
+#include "WebsocketClient.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Feeds captured frames through WebsocketClient::processFrame, the same code
+// the live consumer thread runs, without a network connection.
+//
+// usage: replay <capture-dir | file.jrn ...> [--mode afap|realtime|scaled] [--speed X]
+//               [--from <ns>] [--conn <id>]
+//   afap      as fast as possible, reports msgs/sec and ns/msg
+//   realtime  keeps the captured gaps between frames
+//   scaled    realtime divided by --speed (2 = twice as fast)
+// Books are created for every instrument seen in the capture; they only become
+// valid once the subscribe snapshot is replayed, so --from should not skip it.
+
+enum class ReplayMode {
+    AFAP,
+    REALTIME,
+    SCALED
+};
+
+// Frames of one connection, read file after file.
+struct ConnectionCursor {
+    std::vector<std::string> files;
+    size_t nextFile = 0;
+    std::unique_ptr<FrameJournalReader> reader;
+    JournalFrame frame;
+    bool hasFrame = false;
+
+    bool advance(uint64_t fromNs) {
+        for (;;) {
+            if (reader && reader->next(frame)) {
+                hasFrame = true;
+                return true;
+            }
+            if (nextFile == files.size()) {
+                hasFrame = false;
+                return false;
+            }
+            reader = std::make_unique<FrameJournalReader>(files[nextFile++]);
+            if (!reader->isOpen()) {
+                std::cerr << "skipping unreadable journal " << files[nextFile - 1] << std::endl;
+                reader.reset();
+                continue;
+            }
+            if (fromNs != 0 && reader->header().lastNs != 0 && reader->header().lastNs < fromNs) {
+                reader.reset();
+                continue;
+            }
+            if (fromNs != 0) {
+                reader->seek(fromNs);
+            }
+        }
+    }
+};
+
+// Merges the connections of a capture by receive time.
+class CaptureCursor {
+public:
+    CaptureCursor(const std::vector<std::string>& files, uint64_t fromNs, long connectionFilter) {
+        std::map<uint32_t, std::vector<std::string>> byConnection;
+        for (const auto& path : files) {
+            FrameJournalReader probe(path);
+            if (!probe.isOpen()) {
+                std::cerr << "not a frame journal: " << path << std::endl;
+                continue;
+            }
+            uint32_t id = probe.header().connectionId;
+            if (connectionFilter < 0 || static_cast<uint32_t>(connectionFilter) == id) {
+                byConnection[id].push_back(path);
+            }
+        }
+        for (auto& entry : byConnection) {
+            auto cursor = std::make_unique<ConnectionCursor>();
+            cursor->files = entry.second;
+            cursor->advance(fromNs);
+            cursors.push_back(std::move(cursor));
+        }
+    }
+
+    bool next(JournalFrame& frame) {
+        ConnectionCursor* earliest = nullptr;
+        for (auto& cursor : cursors) {
+            if (cursor->hasFrame && (!earliest || cursor->frame.receivedNs < earliest->frame.receivedNs)) {
+                earliest = cursor.get();
+            }
+        }
+        if (!earliest) {
+            return false;
+        }
+        frame = earliest->frame;
+        // Safe to keep 'frame': readers stay mapped until the cursor moves to the next file.
+        pendingAdvance = earliest;
+        return true;
+    }
+
+    // Move past the frame returned by next(), once the caller is done with it.
+    void consume() {
+        if (pendingAdvance) {
+            pendingAdvance->advance(0);
+            pendingAdvance = nullptr;
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<ConnectionCursor>> cursors;
+    ConnectionCursor* pendingAdvance = nullptr;
+};
+
+static void printProbe(LatencyProbe probe) {
+    LatencyHistogram h = latencySnapshot(probe);
+    if (h.count() == 0) {
+        return;
+    }
+    std::cout << "  " << latencyProbeName(probe) << ": count=" << h.count()
+              << " p50=" << h.valueAtPercentile(50.0) << "ns p99=" << h.valueAtPercentile(99.0)
+              << "ns p99.9=" << h.valueAtPercentile(99.9) << "ns max=" << h.max() << "ns\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0]
+                  << " <capture-dir | file.jrn ...> [--mode afap|realtime|scaled] [--speed X] [--from <ns>] [--conn <id>]"
+                  << std::endl;
+        return 1;
+    }
+    ReplayMode mode = ReplayMode::AFAP;
+    double speed = 1.0;
+    uint64_t fromNs = 0;
+    long connectionFilter = -1;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value == "realtime") {
+                mode = ReplayMode::REALTIME;
+            } else if (value == "scaled") {
+                mode = ReplayMode::SCALED;
+            } else if (value == "afap") {
+                mode = ReplayMode::AFAP;
+            } else {
+                std::cerr << "unknown mode " << value << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            fromNs = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--conn") == 0 && i + 1 < argc) {
+            connectionFilter = std::stol(argv[++i]);
+        } else {
+            std::string path = argv[i];
+            if (path.size() > 4 && path.compare(path.size() - 4, 4, ".jrn") == 0) {
+                files.push_back(path);
+            } else {
+                std::vector<std::string> listed = FrameJournal::listFiles(path);
+                files.insert(files.end(), listed.begin(), listed.end());
+            }
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "no journal files found" << std::endl;
+        return 1;
+    }
+    if (mode == ReplayMode::REALTIME) {
+        speed = 1.0;
+    }
+    if (speed <= 0.0) {
+        std::cerr << "--speed must be positive" << std::endl;
+        return 1;
+    }
+
+    initLogger();
+    // A client that is never started: no connection, no consumer thread.
+    auto owner = std::make_unique<WebsocketClient>(nullptr);
+    WebsocketClient& client = *owner;
+
+    // First pass: create a book for every instrument with book traffic. This
+    // also pulls the capture into the page cache before anything is timed.
+    {
+        MessageParser parser;
+        std::unique_ptr<ParsedMessage> parsed = std::make_unique<ParsedMessage>();
+        CaptureCursor cursor(files, fromNs, connectionFilter);
+        JournalFrame frame;
+        while (cursor.next(frame)) {
+            if (parser.parse(frame.data, frame.length, *parsed) && parsed->hasBook) {
+                std::string instrument(parsed->instrument);
+                if (!client.orderBooks().find(instrument)) {
+                    client.orderBooks().addBook(instrument);
+                }
+            }
+            cursor.consume();
+        }
+    }
+
+    CaptureCursor cursor(files, fromNs, connectionFilter);
+    JournalFrame frame;
+    std::string payload;
+    payload.reserve(1 << 16);
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t firstNs = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    while (cursor.next(frame)) {
+        if (frames == 0) {
+            firstNs = frame.receivedNs;
+        }
+        if (mode != ReplayMode::AFAP) {
+            auto due = begin + std::chrono::nanoseconds(
+                static_cast<int64_t>(static_cast<double>(frame.receivedNs - firstNs) / speed));
+            std::this_thread::sleep_until(due);
+        }
+        payload.assign(frame.data, frame.length);
+        client.processFrame(payload, std::chrono::high_resolution_clock::now());
+        ++frames;
+        bytes += frame.length;
+        cursor.consume();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+
+    std::cout << "frames=" << frames << " bytes=" << bytes << " elapsed_ms=" << elapsedNs / 1e6 << "\n";
+    if (frames > 0 && elapsedNs > 0) {
+        std::cout << "msgs_per_sec=" << static_cast<uint64_t>(frames / (elapsedNs / 1e9))
+                  << " ns_per_msg=" << static_cast<uint64_t>(elapsedNs / frames) << "\n";
+    }
+    printProbe(LatencyProbe::PARSE);
+    printProbe(LatencyProbe::DISPATCH);
+    printProbe(LatencyProbe::FRAME_PROCESSING);
+
+    client.orderBooks().forEach([](OrderBook& book) {
+        TopOfBook top = book.topOfBook();
+        std::cout << book.getInstrument() << ": ";
+        if (top.valid) {
+            std::cout << top.bidAmount << " @ " << top.bidPrice << " / " << top.askAmount << " @ " << top.askPrice
+                      << " (change " << book.lastChangeId() << ")\n";
+        } else {
+            std::cout << "no valid book\n";
+        }
+    });
+    owner.reset();
+    shutdownLogger();
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "HttpConnectionPool.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Measures POST round trips against an HTTPS endpoint, either through the
+// pooled keep-alive handles or with a fresh curl handle per request (the old
+// RestClient behaviour). Point it at a local stand-in to isolate client cost.
+//
+// usage: rest_bench <base-url> [requests] [--fresh] [--http2] [--insecure]
+//   e.g. rest_bench https://127.0.0.1:8443 2000 --insecure
+
+static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
+    return size * nmemb;
+}
+
+static long freshPost(const std::string& url, const std::string& body, bool verifyPeer, std::string& response) {
+    CURL* curl = curl_easy_init();
+    struct curl_slist* headers = nullptr;
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    if (!verifyPeer) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    long code = 0;
+    if (curl_easy_perform(curl) == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    }
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    return code;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <base-url> [requests] [--fresh] [--http2] [--insecure]" << std::endl;
+        return 1;
+    }
+    HttpPoolOptions options;
+    options.baseUrl = argv[1];
+    options.size = 1;
+    options.warmInterval = std::chrono::seconds(0);
+    int requests = 1000;
+    bool fresh = false;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--fresh") == 0) {
+            fresh = true;
+        } else if (std::strcmp(argv[i], "--http2") == 0) {
+            options.http2 = true;
+        } else if (std::strcmp(argv[i], "--insecure") == 0) {
+            options.verifyPeer = false;
+        } else {
+            requests = std::stoi(argv[i]);
+        }
+    }
+
+    initLogger();
+    std::string url = options.baseUrl + "/api/v2/public/test";
+    std::string body = R"({"jsonrpc":"2.0","id":1,"method":"public/test","params":{}})";
+    LatencyHistogram histogram;
+    HttpConnectionPool pool(options);
+    std::string response;
+    int failures = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; ++i) {
+        response.clear();
+        auto start = std::chrono::steady_clock::now();
+        long code = fresh ? freshPost(url, body, options.verifyPeer, response)
+                          : pool.post(url, body, response);
+        auto end = std::chrono::steady_clock::now();
+        if (code != 200) {
+            ++failures;
+        }
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "{\"mode\":\"" << (fresh ? "fresh" : "pooled") << "\""
+              << ",\"requests\":" << requests
+              << ",\"failures\":" << failures
+              << ",\"req_per_sec\":" << requests / seconds
+              << ",\"p50_us\":" << histogram.valueAtPercentile(50.0) / 1000.0
+              << ",\"p99_us\":" << histogram.valueAtPercentile(99.0) / 1000.0
+              << ",\"max_us\":" << histogram.max() / 1000.0
+              << ",\"pool_connects\":" << pool.connectCount() << "}" << std::endl;
+    shutdownLogger();
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,317 @@
+#include "ScriptRunner.h"
+#include "Logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+struct ScriptRunner::State {
+    // A WebSocket order sent and not answered yet.
+    struct Outstanding {
+        size_t line;
+        json id;
+        std::string cmd;
+        std::chrono::steady_clock::time_point readAt;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::ostream* out;       // null once the runner is gone
+    std::map<uint64_t, Outstanding> outstanding; // by send order
+    uint64_t nextKey = 0;
+    size_t timedOut = 0;
+    ScriptSummary summary;
+    std::vector<int64_t> latencies;
+
+    // One result line. Caller must not hold the mutex.
+    void write(size_t line, const json& id, const std::string& cmd, bool ok, const json& result,
+               int64_t latencyNs, int64_t rttNs) {
+        json record = {{"line", line}};
+        if (!id.is_null()) {
+            record["id"] = id;
+        }
+        record["cmd"] = cmd;
+        record["ok"] = ok;
+        record["result"] = result;
+        if (latencyNs >= 0) {
+            record["latency_ns"] = latencyNs;
+        }
+        if (rttNs > 0) {
+            record["rtt_ns"] = rttNs;
+        }
+        std::string text = record.dump();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!out) {
+            return;
+        }
+        *out << text << '\n';
+        ++(ok ? summary.ok : summary.failed);
+        if (latencyNs >= 0) {
+            latencies.push_back(latencyNs);
+        }
+    }
+};
+
+static int64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+ScriptRunner::ScriptRunner(Trade& trade, std::ostream& out, const ScriptOptions& options)
+    : trade(trade), options(options), state(std::make_shared<State>()) {
+    state->out = &out;
+    this->options.maxInFlight = std::max<size_t>(options.maxInFlight, 1);
+    this->options.restWindow = std::max<size_t>(options.restWindow, 1);
+}
+
+ScriptRunner::~ScriptRunner() {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->out = nullptr;
+}
+
+// ------------------ Commands ------------------ //
+
+ScriptSummary ScriptRunner::run(std::istream& in) {
+    auto start = std::chrono::steady_clock::now();
+    std::string text;
+    size_t line = 0;
+    while (std::getline(in, text)) {
+        ++line;
+        if (text.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        auto readAt = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            ++state->summary.commands;
+        }
+        json command = json::parse(text, nullptr, false);
+        if (command.is_discarded() || !command.is_object() || !command.contains("cmd") || !command["cmd"].is_string()) {
+            state->write(line, nullptr, "", false, "PARSE_ERROR", -1, 0);
+            continue;
+        }
+        try {
+            execute(line, command, readAt);
+        } catch (const json::exception&) {
+            // A field of the wrong type, e.g. {"cmd":"sleep","ms":"x"}.
+            json id = command.contains("id") ? command["id"] : json();
+            state->write(line, id, command["cmd"].get<std::string>(), false, "BAD_COMMAND", elapsedNs(readAt), 0);
+        }
+    }
+    flushRestWindow();
+    waitForResponses();
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    ScriptSummary summary = state->summary;
+    summary.wallNs = elapsedNs(start);
+    std::vector<int64_t> sorted = state->latencies;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) -> int64_t {
+        return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    };
+    double seconds = static_cast<double>(summary.wallNs) / 1e9;
+    json record = {{"summary",
+                    {{"commands", summary.commands},
+                     {"ok", summary.ok},
+                     {"failed", summary.failed},
+                     {"unanswered", state->timedOut},
+                     {"wall_ms", summary.wallNs / 1000000},
+                     {"commands_per_sec", seconds > 0.0 ? static_cast<double>(summary.commands) / seconds : 0.0},
+                     {"latency_ns", {{"p50", percentile(0.50)}, {"p99", percentile(0.99)},
+                                     {"max", sorted.empty() ? 0 : sorted.back()}}}}}};
+    if (state->out) {
+        *state->out << record.dump() << '\n';
+        state->out->flush();
+    }
+    return summary;
+}
+
+void ScriptRunner::execute(size_t line, const json& command, std::chrono::steady_clock::time_point readAt) {
+    const std::string cmd = command["cmd"].get<std::string>();
+    json id = command.contains("id") ? command["id"] : json();
+
+    if (cmd == "place" || cmd == "cancel" || cmd == "modify") {
+        Pending pending{line, id, cmd, OrderRequest(), readAt};
+        std::string error;
+        if (!buildOrder(cmd, command, pending.request, error)) {
+            state->write(line, id, cmd, false, error, elapsedNs(readAt), 0);
+            return;
+        }
+        submitOrder(std::move(pending));
+        return;
+    }
+
+    // Everything else runs in order with the orders around it.
+    flushRestWindow();
+    if (cmd == "subscribe") {
+        std::string channel = command.value("channel", "book");
+        std::vector<std::string> instruments;
+        if (command.contains("instruments") && command["instruments"].is_array()) {
+            for (const auto& instrument : command["instruments"]) {
+                if (instrument.is_string()) {
+                    instruments.push_back(instrument.get<std::string>());
+                }
+            }
+        }
+        if (instruments.empty() || (channel != "book" && channel != "trades")) {
+            state->write(line, id, cmd, false, "BAD_COMMAND", elapsedNs(readAt), 0);
+            return;
+        }
+        if (channel == "book") {
+            trade.subscribeToOrderBook(instruments);
+        } else {
+            trade.subscribeToMarketTrades(instruments);
+        }
+        state->write(line, id, cmd, true, "SUBSCRIBED", elapsedNs(readAt), 0);
+    } else if (cmd == "positions") {
+        state->write(line, id, cmd, true, trade.positionsReport(), elapsedNs(readAt), 0);
+    } else if (cmd == "transport") {
+        std::string value = command.value("value", "");
+        if (value != "rest" && value != "websocket") {
+            state->write(line, id, cmd, false, "BAD_COMMAND", elapsedNs(readAt), 0);
+            return;
+        }
+        // Responses of the old transport still arrive; only new orders switch.
+        trade.setOrderTransport(value == "rest" ? OrderTransport::REST : OrderTransport::WEBSOCKET);
+        state->write(line, id, cmd, true, value, elapsedNs(readAt), 0);
+    } else if (cmd == "wait") {
+        bool drained = waitForResponses();
+        state->write(line, id, cmd, drained, drained ? "DRAINED" : "TIMEOUT", elapsedNs(readAt), 0);
+    } else if (cmd == "sleep") {
+        std::this_thread::sleep_for(std::chrono::milliseconds(command.value("ms", 0)));
+        state->write(line, id, cmd, true, "SLEPT", elapsedNs(readAt), 0);
+    } else {
+        state->write(line, id, cmd, false, "UNKNOWN_COMMAND", elapsedNs(readAt), 0);
+    }
+}
+
+bool ScriptRunner::buildOrder(const std::string& cmd, const json& command, OrderRequest& out, std::string& error) {
+    try {
+        if (cmd == "place") {
+            std::string side = command.value("side", "");
+            std::string type = command.value("type", "limit");
+            if (!command.contains("instrument") || (side != "buy" && side != "sell") ||
+                (type != "limit" && type != "market")) {
+                error = "BAD_COMMAND";
+                return false;
+            }
+            out = OrderRequest::place(command["instrument"].get<std::string>(), command.value("amount", 0.0), side,
+                                      type, command.value("price", 0.0), command.value("expiry", ""),
+                                      command.value("strike", 0.0), command.value("option_type", ""),
+                                      command.value("label", ""));
+            return true;
+        }
+        std::string orderId = command.value("order_id", "");
+        if (orderId.empty() && command.contains("label") &&
+            !trade.orderIdForLabel(command["label"].get<std::string>(), orderId)) {
+            error = "UNKNOWN_LABEL";
+            return false;
+        }
+        if (orderId.empty()) {
+            error = "BAD_COMMAND";
+            return false;
+        }
+        out = cmd == "cancel" ? OrderRequest::cancel(orderId)
+                              : OrderRequest::edit(orderId, command.value("amount", 0.0), command.value("price", 0.0));
+        return true;
+    } catch (const json::exception&) {
+        // A field of the wrong type.
+        error = "BAD_COMMAND";
+        return false;
+    }
+}
+
+// ------------------ Pipelining ------------------ //
+
+void ScriptRunner::submitOrder(Pending pending) {
+    if (trade.getOrderTransport() == OrderTransport::REST) {
+        restWindow.push_back(std::move(pending));
+        if (restWindow.size() >= options.restWindow) {
+            flushRestWindow();
+        }
+        return;
+    }
+    uint64_t key;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        auto windowOpen = [this]() { return state->outstanding.size() < options.maxInFlight; };
+        if (!state->cv.wait_for(lock, options.drainTimeout, windowOpen)) {
+            // Responses lost to a disconnect (or never sent by the exchange) would block the script for good.
+            systemLogger->error("[Script] No response within {} ms with {} order(s) in flight, failing them",
+                                options.drainTimeout.count(), state->outstanding.size());
+            lock.unlock();
+            failOutstanding();
+            lock.lock();
+        }
+        key = state->nextKey++;
+        state->outstanding.emplace(key, State::Outstanding{pending.line, pending.id, pending.cmd, pending.readAt});
+    }
+    std::shared_ptr<State> shared = state;
+    trade.submitAsync(pending.request, [shared, key](const OrderResult& result) {
+        State::Outstanding entry;
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            auto it = shared->outstanding.find(key);
+            if (it == shared->outstanding.end()) {
+                return; // already reported as timed out
+            }
+            entry = std::move(it->second);
+            shared->outstanding.erase(it);
+            shared->cv.notify_all();
+        }
+        shared->write(entry.line, entry.id, entry.cmd, result.ok, result.result, elapsedNs(entry.readAt),
+                      result.latencyNs);
+    });
+}
+
+// Each order still waiting gets a TIMEOUT result line; a late response for it is dropped.
+void ScriptRunner::failOutstanding() {
+    std::map<uint64_t, State::Outstanding> stuck;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        stuck.swap(state->outstanding);
+        state->timedOut += stuck.size();
+        state->cv.notify_all();
+    }
+    for (const auto& entry : stuck) {
+        const State::Outstanding& order = entry.second;
+        state->write(order.line, order.id, order.cmd, false, "TIMEOUT", elapsedNs(order.readAt), 0);
+    }
+}
+
+// REST orders go out together; executeBatch runs them concurrently.
+void ScriptRunner::flushRestWindow() {
+    if (restWindow.empty()) {
+        return;
+    }
+    std::vector<OrderRequest> batch;
+    batch.reserve(restWindow.size());
+    for (const auto& pending : restWindow) {
+        batch.push_back(pending.request);
+    }
+    std::vector<OrderResult> results = trade.executeBatch(batch, options.drainTimeout);
+    for (size_t i = 0; i < restWindow.size() && i < results.size(); ++i) {
+        const Pending& pending = restWindow[i];
+        state->write(pending.line, pending.id, pending.cmd, results[i].ok, results[i].result,
+                     elapsedNs(pending.readAt), results[i].latencyNs);
+    }
+    restWindow.clear();
+}
+
+bool ScriptRunner::waitForResponses() {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    bool drained = state->cv.wait_for(lock, options.drainTimeout, [this]() { return state->outstanding.empty(); });
+    if (!drained) {
+        systemLogger->error("[Script] {} order(s) still unanswered after {} ms", state->outstanding.size(),
+                            options.drainTimeout.count());
+        lock.unlock();
+        failOutstanding();
+        lock.lock();
+    }
+    if (state->out) {
+        state->out->flush();
+    }
+    return drained;
+}
@@ -1,38 +1,49 @@
 #include "trade.h"
+#include "PositionEngine.h"
+#include "OrderManager.h"
+#include "RiskGate.h"
 #include "spdlog/spdlog.h"
+#include <iostream>
 #include <nlohmann/json.hpp>
 #include <vector>
 #include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 using json = nlohmann::json;
 
 // ------------------ Utility Functions ------------------ //
 
-std::string Trade::spotInstrumentToString(SpotInstrument instrument) {
+const std::string& Trade::spotInstrumentToString(SpotInstrument instrument) {
+    static const std::string names[] = {"BTC-PERPETUAL", "ETH-PERPETUAL", "UNKNOWN_SPOT"};
     switch (instrument) {
-        case SpotInstrument::BTC_SPOT: return "BTC-PERPETUAL";
-        case SpotInstrument::ETH_SPOT: return "ETH-PERPETUAL";
-        default: return "UNKNOWN_SPOT";
+        case SpotInstrument::BTC_SPOT: return names[0];
+        case SpotInstrument::ETH_SPOT: return names[1];
+        default: return names[2];
     }
 }
 
-std::string Trade::futuresInstrumentToString(FuturesInstrument instrument) {
+const std::string& Trade::futuresInstrumentToString(FuturesInstrument instrument) {
+    static const std::string names[] = {"BTC-PERPETUAL", "ETH-PERPETUAL", "USDC-PERPETUAL", "USDT-PERPETUAL",
+                                        "BTC-FUTURES", "ETH-FUTURES", "UNKNOWN_FUTURES"};
     switch (instrument) {
-        case FuturesInstrument::BTC_PERPETUAL: return "BTC-PERPETUAL";
-        case FuturesInstrument::ETH_PERPETUAL: return "ETH-PERPETUAL";
-        case FuturesInstrument::USDC_PERPETUAL: return "USDC-PERPETUAL";
-        case FuturesInstrument::USDT_PERPETUAL: return "USDT-PERPETUAL";
-        case FuturesInstrument::BTC_FUTURES: return "BTC-FUTURES";
-        case FuturesInstrument::ETH_FUTURES: return "ETH-FUTURES";
-        default: return "UNKNOWN_FUTURES";
+        case FuturesInstrument::BTC_PERPETUAL: return names[0];
+        case FuturesInstrument::ETH_PERPETUAL: return names[1];
+        case FuturesInstrument::USDC_PERPETUAL: return names[2];
+        case FuturesInstrument::USDT_PERPETUAL: return names[3];
+        case FuturesInstrument::BTC_FUTURES: return names[4];
+        case FuturesInstrument::ETH_FUTURES: return names[5];
+        default: return names[6];
     }
 }
 
-std::string Trade::optionsInstrumentToString(OptionsInstrument instrument) {
+const std::string& Trade::optionsInstrumentToString(OptionsInstrument instrument) {
+    static const std::string names[] = {"BTC-OPTIONS", "ETH-OPTIONS", "UNKNOWN_OPTIONS"};
     switch (instrument) {
-        case OptionsInstrument::BTC_OPTIONS: return "BTC-OPTIONS";
-        case OptionsInstrument::ETH_OPTIONS: return "ETH-OPTIONS";
-        default: return "UNKNOWN_OPTIONS";
+        case OptionsInstrument::BTC_OPTIONS: return names[0];
+        case OptionsInstrument::ETH_OPTIONS: return names[1];
+        default: return names[2];
     }
 }
 
@@ -61,76 +72,254 @@ Trade::~Trade() {
 
 // ------------------ Order Management Functions ------------------ //
 
+bool Trade::passesRisk(OrderRequest& request) {
+    RiskReject reason = RiskReject::NONE;
+    if (riskGate) {
+        ManagedOrder order;
+        if (request.action == OrderAction::EDIT && orderManager && orderManager->find(request.orderId, order)) {
+            reason = riskGate->checkEdit(order, request.amount, request.price);
+        } else {
+            reason = riskGate->checkOrder(request);
+        }
+    }
+    if (reason != RiskReject::NONE) {
+        spdlog::warn("Risk rejected {} {} {} @ {}: {}", request.action == OrderAction::EDIT ? "edit of" : request.side,
+                     request.action == OrderAction::EDIT ? request.orderId : request.instrument, request.amount,
+                     request.price, RiskGate::rejectName(reason));
+        return false;
+    }
+    // Registering the instrument of an order that will go keeps the interning
+    // off the consumer thread when its fills arrive.
+    if (positionEngine && request.action == OrderAction::PLACE) {
+        positionEngine->track(request.instrument);
+    }
+    return true;
+}
+
+// Sends the order over the configured transport. Over the WebSocket the call
+// returns as soon as the request is written and the response is logged when it arrives.
+void Trade::placeOrder(const char* product, const std::string& instrument, double amount,
+                       OrderSide side, OrderType type, double price, const std::string& expiryDate,
+                       double strikePrice, const std::string& optionType) {
+    // Sent as checked, so the order carries its risk reservation.
+    OrderRequest request = OrderRequest::place(instrument, amount, orderSideToString(side), orderTypeToString(type),
+                                               price, expiryDate, strikePrice, optionType);
+    if (!passesRisk(request)) {
+        return;
+    }
+    if (orderTransport == OrderTransport::WEBSOCKET) {
+        std::string label = product;
+        wsClient->sendOrder(request, [label](const RpcResponse& response) {
+            spdlog::info("{} Order Response ({} us): {}", label, response.roundTripNs / 1000, response.body);
+        });
+        return;
+    }
+    std::string response = restClient->sendOrder(std::move(request));
+    spdlog::info("{} Order Response: {}", product, response);
+}
+
 void Trade::placeSpotOrder(const SpotOrder& order) {
-    json payload = {
-        {"instrument", spotInstrumentToString(order.instrument)},
-        {"side", orderSideToString(order.side)},
-        {"type", orderTypeToString(order.type)},
-        {"amount", order.amount},
-        {"price", order.price}
-    };
-    spdlog::info("Placing Spot Order: {}", payload.dump());
-    std::string response = restClient->placeOrder(spotInstrumentToString(order.instrument),
-                                                    order.amount,
-                                                    orderSideToString(order.side),
-                                                    orderTypeToString(order.type),
-                                                    order.price,"",0.0,"");
-    spdlog::info("Spot Order Response: {}", response);
+    spdlog::info("Placing Spot Order: instrument={} side={} type={} amount={} price={}",
+                 spotInstrumentToString(order.instrument), orderSideToString(order.side),
+                 orderTypeToString(order.type), order.amount, order.price);
+    placeOrder("Spot", spotInstrumentToString(order.instrument), order.amount, order.side, order.type,
+               order.price);
 }
 
 void Trade::placeFuturesOrder(const FuturesOrder& order) {
-    json payload = {
-        {"instrument", futuresInstrumentToString(order.instrument)},
-        {"side", orderSideToString(order.side)},
-        {"type", orderTypeToString(order.type)},
-        {"amount", order.amount},
-        {"price", order.price},
-        {"expiry_date", order.expiryDate}
-    };
-    spdlog::info("Placing Futures Order: {}", payload.dump());
-    std::string response = restClient->placeOrder(futuresInstrumentToString(order.instrument),
-                                                    order.amount,
-                                                    orderSideToString(order.side),
-                                                    orderTypeToString(order.type),
-                                                    order.price,order.expiryDate,0.0,"");
-    spdlog::info("Futures Order Response: {}", response);
+    spdlog::info("Placing Futures Order: instrument={} side={} type={} amount={} price={} expiry_date={}",
+                 futuresInstrumentToString(order.instrument), orderSideToString(order.side),
+                 orderTypeToString(order.type), order.amount, order.price, order.expiryDate);
+    placeOrder("Futures", futuresInstrumentToString(order.instrument), order.amount, order.side, order.type,
+               order.price, order.expiryDate);
 }
 
 void Trade::placeOptionsOrder(const OptionsOrder& order) {
-    json payload = {
-        {"instrument", optionsInstrumentToString(order.instrument)},
-        {"side", orderSideToString(order.side)},
-        {"type", orderTypeToString(order.type)},
-        {"amount", order.amount},
-        {"price", order.price},
-        {"expiry_date", order.expiryDate},
-        {"strike_price", order.strikePrice},
-        {"option_type", optionTypeToString(order.optionType)}
-    };
-    
-    std::string response = restClient->placeOrder(optionsInstrumentToString(order.instrument),
-                                                    order.amount,
-                                                    orderSideToString(order.side),
-                                                    orderTypeToString(order.type),
-                                                    order.price,
-                                                    order.expiryDate,
-                                                    order.strikePrice,
-                                                    optionTypeToString(order.optionType));
-    
+    placeOrder("Options", optionsInstrumentToString(order.instrument), order.amount, order.side, order.type,
+               order.price, order.expiryDate, order.strikePrice, optionTypeToString(order.optionType));
 }
 
 void Trade::cancelOrder(const std::string& orderId) {
     spdlog::info("Cancelling Order with ID: {}", orderId);
+    if (orderTransport == OrderTransport::WEBSOCKET) {
+        wsClient->cancelOrder(orderId, [](const RpcResponse& response) {
+            spdlog::info("Cancel Order Response ({} us): {}", response.roundTripNs / 1000, response.body);
+        });
+        return;
+    }
     std::string response = restClient->cancelOrder(orderId);
     spdlog::info("Cancel Order Response: {}", response);
 }
 
 void Trade::modifyOrder(const std::string& orderId, double newAmount, double newPrice) {
     spdlog::info("Modifying Order ID: {} to new amount: {} and new price: {}", orderId, newAmount, newPrice);
-    std::string response = restClient->modifyOrder(orderId, newAmount, newPrice);
+    OrderRequest request = OrderRequest::edit(orderId, newAmount, newPrice);
+    if (!passesRisk(request)) {
+        return;
+    }
+    // Sent as checked, like a new order.
+    if (orderTransport == OrderTransport::WEBSOCKET) {
+        wsClient->sendOrder(request, [](const RpcResponse& response) {
+            spdlog::info("Modify Order Response ({} us): {}", response.roundTripNs / 1000, response.body);
+        });
+        return;
+    }
+    std::string response = restClient->sendOrder(std::move(request));
     spdlog::info("Modify Order Response: {}", response);
 }
 
+// Same result strings as the REST calls, taken from a WebSocket response.
+static std::string wsResultString(OrderAction action, const RpcResponse& response) {
+    if (response.transportFailure) {
+        return "CONNECTION_LOST"; // settled by the order manager's next reconcile
+    }
+    if (!response.ok) {
+        switch (action) {
+            case OrderAction::CANCEL: return "CANCEL_FAILED";
+            case OrderAction::EDIT: return "MODIFY_FAILED";
+            default: return "ORDER_FAILED";
+        }
+    }
+    if (action == OrderAction::CANCEL) {
+        return "ORDER_CANCELED";
+    }
+    try {
+        auto j = json::parse(response.body);
+        if (j.contains("order")) {
+            return j["order"].value("order_id", "ORDER_FAILED");
+        }
+        return j.value("order_id", "ORDER_FAILED");
+    } catch (json::exception&) {
+        return "JSON_ERROR";
+    }
+}
+
+std::vector<OrderResult> Trade::executeBatch(const std::vector<OrderRequest>& batch, std::chrono::milliseconds timeout) {
+    spdlog::info("Executing batch of {} requests", batch.size());
+    if (riskGate) {
+        // Rejected entries are answered here; the rest go out as one batch.
+        std::vector<OrderRequest> accepted;
+        std::vector<size_t> positions;
+        std::vector<OrderResult> results(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            OrderRequest request = batch[i];
+            if (passesRisk(request)) {
+                accepted.push_back(std::move(request));
+                positions.push_back(i);
+            } else {
+                results[i].result = "RISK_REJECTED";
+            }
+        }
+        // The accepted copies carry their reservations.
+        std::vector<OrderResult> sent = sendBatch(accepted, timeout);
+        for (size_t i = 0; i < sent.size(); ++i) {
+            results[positions[i]] = std::move(sent[i]);
+        }
+        return results;
+    }
+    return sendBatch(batch, timeout);
+}
+
+std::vector<OrderResult> Trade::sendBatch(const std::vector<OrderRequest>& batch, std::chrono::milliseconds timeout) {
+    if (batch.empty()) {
+        return {};
+    }
+    if (orderTransport == OrderTransport::REST) {
+        return restClient->executeBatch(batch);
+    }
+
+    // Every request is written back to back; the responses fill the shared
+    // state from the consumer thread, which may outlive this call on timeout.
+    struct BatchState {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<OrderResult> results;
+        size_t remaining;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->results.resize(batch.size());
+    state->remaining = batch.size();
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        OrderAction action = batch[i].action;
+        wsClient->sendOrder(batch[i], [state, i, action](const RpcResponse& response) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            OrderResult& out = state->results[i];
+            out.result = wsResultString(action, response);
+            out.ok = response.ok;
+            out.latencyNs = response.roundTripNs;
+            if (--state->remaining == 0) {
+                state->cv.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (!state->cv.wait_for(lock, timeout, [&state]() { return state->remaining == 0; })) {
+        spdlog::error("Batch timed out with {} of {} requests unanswered", state->remaining, batch.size());
+        for (auto& out : state->results) {
+            if (out.result.empty()) {
+                out.result = "TIMEOUT";
+            }
+        }
+    }
+    return state->results;
+}
+
+void Trade::submitAsync(const OrderRequest& prepared, std::function<void(const OrderResult&)> done) {
+    OrderRequest request = prepared;
+    if (!passesRisk(request)) {
+        OrderResult rejected;
+        rejected.result = "RISK_REJECTED";
+        done(rejected);
+        return;
+    }
+    if (orderTransport == OrderTransport::WEBSOCKET) {
+        OrderAction action = request.action;
+        wsClient->sendOrder(request, [action, done = std::move(done)](const RpcResponse& response) {
+            OrderResult out;
+            out.result = wsResultString(action, response);
+            out.ok = response.ok;
+            out.latencyNs = response.roundTripNs;
+            done(out);
+        });
+        return;
+    }
+    std::vector<OrderResult> results = restClient->executeBatch({request});
+    done(results.front());
+}
+
+bool Trade::orderIdForLabel(const std::string& label, std::string& orderId) const {
+    ManagedOrder order;
+    if (!orderManager || !orderManager->findByLabel(label, order) || !order.orderId[0]) {
+        return false;
+    }
+    orderId = order.orderId;
+    return true;
+}
+
+json Trade::positionsReport() const {
+    json report = {{"positions", json::array()}, {"currencies", json::object()}};
+    if (!positionEngine) {
+        return report;
+    }
+    for (const auto& view : positionEngine->openPositions()) {
+        report["positions"].push_back({{"instrument", wsClient->instruments().name(view.instrument)},
+                                       {"size", view.size},
+                                       {"average_price", view.averagePrice},
+                                       {"mark_price", view.markPrice},
+                                       {"unrealized_pnl", view.unrealizedPnl},
+                                       {"realized_pnl", view.realizedPnl}});
+    }
+    for (const auto& currency : positionEngine->currencies()) {
+        CurrencyTotals totals = positionEngine->totals(currency);
+        report["currencies"][currency] = {{"open_positions", totals.openPositions},
+                                          {"unrealized_pnl", totals.unrealizedPnl},
+                                          {"realized_pnl", totals.realizedPnl}};
+    }
+    return report;
+}
+
 // ------------------ WebSocket Market Data Functions ------------------ //
 
 void Trade::getOrderBook(const std::string& instrument) {
@@ -141,10 +330,55 @@ void Trade::getOrderBook(const std::string& instrument) {
 }
 
 void Trade::viewCurrentPositions() {
-    // Request positions via WebSocket (assuming currency is BTC for this example).
-    //hardcoded it.. could be modified.
-    wsClient->requestCurrentPositions("BTC");
-    spdlog::info("Requested current positions for BTC");
+    if (!positionEngine) {
+        wsClient->requestCurrentPositions("BTC");
+        spdlog::info("Requested current positions for BTC");
+        return;
+    }
+    std::vector<std::string> currencies = positionEngine->currencies();
+    std::vector<PositionView> open = positionEngine->openPositions();
+    std::cout << "\n=== Positions ===\n";
+    if (open.empty()) {
+        std::cout << "No open positions.\n";
+    }
+    for (const auto& view : open) {
+        std::cout << wsClient->instruments().name(view.instrument) << ": size " << view.size
+                  << " @ " << view.averagePrice << ", mark " << view.markPrice
+                  << ", unrealized " << view.unrealizedPnl << ", realized " << view.realizedPnl << "\n";
+    }
+    for (const auto& currency : currencies) {
+        CurrencyTotals totals = positionEngine->totals(currency);
+        if (totals.openPositions == 0 && totals.realizedPnl == 0.0 && !totals.account.valid) {
+            continue;
+        }
+        std::cout << currency << ": unrealized " << totals.unrealizedPnl << ", realized " << totals.realizedPnl;
+        if (totals.account.valid) {
+            std::cout << ", equity " << totals.account.equity << ", available " << totals.account.availableFunds;
+        }
+        std::cout << "\n";
+    }
+    spdlog::info("Viewed {} open position(s)", open.size());
+}
+
+void Trade::viewOpenOrders() {
+    if (!orderManager) {
+        std::cout << "No order manager attached.\n";
+        return;
+    }
+    std::vector<ManagedOrder> live = orderManager->liveOrders();
+    std::cout << "\n=== Open Orders ===\n";
+    if (live.empty()) {
+        std::cout << "No open orders.\n";
+    }
+    for (const auto& order : live) {
+        std::cout << (order.orderId[0] ? order.orderId : "(pending)") << " [" << order.label << "] "
+                  << (order.instrument != kNoInstrument ? wsClient->instruments().name(order.instrument) : "?")
+                  << " " << (order.buy ? "buy" : "sell") << " " << order.filledAmount << "/" << order.amount
+                  << " @ " << order.price << " " << OrderManager::stateName(order.state) << "\n";
+    }
+    OrderManagerStats stats = orderManager->stats();
+    std::cout << stats.live << " live of " << stats.capacity << ", " << stats.filled << " filled, "
+              << stats.cancelled << " cancelled, " << stats.rejected << " rejected\n";
 }
 
 void Trade::subscribeToOrderBook(const std::vector<std::string>& instruments) {
@@ -157,3 +391,20 @@ void Trade::subscribeToMarketTrades(const std::vector<std::string>& instruments)
     spdlog::info("Subscribed to market trades for {} instruments", instruments.size());
 }
 
+bool Trade::getTopOfBook(const std::string& instrument, TopOfBook& out) const {
+    const OrderBook* book = wsClient->orderBooks().find(instrument);
+    if (!book) {
+        return false;
+    }
+    out = book->topOfBook();
+    return out.valid;
+}
+
+bool Trade::getBookDepth(const std::string& instrument, BookDepth& out) const {
+    const OrderBook* book = wsClient->orderBooks().find(instrument);
+    if (!book) {
+        return false;
+    }
+    out = book->depth();
+    return out.valid;
+}
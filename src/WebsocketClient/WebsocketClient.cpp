@@ -1,8 +1,12 @@
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
 
 #include "WebsocketClient.h"
+#include "OrderManager.h"
+#include <algorithm>
 #include <iostream>
+#include <pthread.h>
 #include <sstream>
+#include <boost/asio/post.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <boost/bind/bind.hpp>
 
@@ -13,76 +17,98 @@ std::shared_ptr<boost::asio::ssl::context> WebsocketClient::on_tls_init() {
     return ctx;
 }
 
-WebsocketClient::WebsocketClient(Authorization* auth)
-    : running(false),  auth(auth)
+static void pinThread(std::thread& thread, int cpu, const char* name) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+        systemLogger->error("[Websocket Client] Could not pin {} thread to CPU {}", name, cpu);
+    }
+}
+
+WebsocketClient::WebsocketClient(Authorization* auth, const WebsocketClientOptions& options)
+    : options(options), running(false),  auth(auth), reconnectRng(std::random_device{}()), reconnects(0),
+      books(registry), consumerRunning(false), nextRequestId(1)
 {
 	initLogger();
+    bidScratch.reserve(1024);
+    askScratch.reserve(1024);
+    parsed = std::make_unique<ParsedMessage>();
+    // Ticker frames go to the market trade log unless a component takes them over.
+    dispatcher.onTicker(kNoInstrument, [](const ChannelDataEvent& event) {
+        markettrade->info("[MarketTrade] {}\n\n", event.data);
+    });
+    inbound = std::make_unique<SpscRing<ReceivedFrame>>(options.ringCapacity);
+    inbound->forEachSlot([&options](ReceivedFrame& frame) { frame.payload.reserve(options.frameReserve); });
+    if (!options.captureDirectory.empty()) {
+        FrameJournalOptions journalOptions;
+        journalOptions.directory = options.captureDirectory;
+        journalOptions.connectionId = options.connectionId;
+        journalOptions.fileSize = options.captureFileSize;
+        journal = std::make_unique<FrameJournal>(journalOptions);
+    }
     // Initialize the ASIO transport.
     wsClient.init_asio();
     wsClient.clear_access_channels(websocketpp::log::alevel::all);
 	wsClient.set_error_channels(websocketpp::log::elevel::rerror); // Only report runtime errors.
-
+    reconnectTimer = std::make_unique<boost::asio::steady_timer>(wsClient.get_io_service());
+    drainTimer = std::make_unique<boost::asio::steady_timer>(wsClient.get_io_service());
+    overflowTimer = std::make_unique<boost::asio::steady_timer>(wsClient.get_io_service());
 
     // Set TLS initialization handler.
     wsClient.set_tls_init_handler(boost::bind(&WebsocketClient::on_tls_init));
 
-    // Set message handler.
+    // Set message handler. Runs on the I/O thread: copy the frame into the ring and return.
     wsClient.set_message_handler([this](connection_hdl /*hdl*/, WebsocketppClient::message_ptr msg) {
-        auto start_time = std::chrono::high_resolution_clock::now();
-        try {
-            auto jsonMessage = json::parse(msg->get_payload());
-             
-            // Check if the message contains subscription data.
-            if (jsonMessage.contains("params") && jsonMessage["params"].contains("channel")) {
-                std::string channel = jsonMessage["params"]["channel"];
-                // Print based on channel type.
-                if (channel.find("book.") != std::string::npos) {
-                    orderbook->info("[OrderBook] {}\n\n",jsonMessage.dump(4));
-                } else if (channel.find("ticker.") != std::string::npos) {
-                    markettrade->info("[MarketTrade] {}\n\n",
-                              jsonMessage.dump(4));
-                } else {
-                    dump->info("[Other] {}", channel ,":\n {}",
-                              jsonMessage.dump(4), "\n\n");
-                }
-            } else if (jsonMessage.contains("result")) {
-                // Handle responses such as positions data or authentication.
-                if (jsonMessage["id"] == 3) {
-                    positions->info("[Positions] {}\n\n",jsonMessage["result"].dump(4));
-                } else if (jsonMessage["id"] == 0) {
-                    //dont want acces tokens in any log file 
-                }
-            } else {
-               
-                dump->info("[Raw Message]: {}\n" ,jsonMessage.dump(4));
-            }
-        } catch (const std::exception& e) {
-            systemLogger->error("Error parsing message: {}",e.what());
+        if (journal) {
+            // Captured before the ring so frames the consumer drops are still on disk.
+            const std::string& raw = msg->get_payload();
+            auto now = std::chrono::system_clock::now().time_since_epoch();
+            journal->append(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), raw.data(), raw.size());
         }
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto processing_latency = std::chrono::duration<double, std::micro>(end_time - start_time).count();
-        latencyLogger->info("Processed message in {} (microseconds)",processing_latency);
+        enqueueFrame(msg->get_payload(), FrameKind::DATA);
     });
 
     // Set open handler.
     wsClient.set_open_handler([this](connection_hdl /*hdl*/) {
         systemLogger->info( "[Websocket Client] Connected to Deribit WebSocket.");
         reconnectAttempts = 0;
+        if (sessions++ > 0) {
+            reconnects.fetch_add(1, std::memory_order_relaxed);
+            // Queued ahead of the new session's frames, so reconnect-to-book
+            // latency is measured from here.
+            enqueueFrame(std::string(), FrameKind::RECONNECTED);
+        }
+        // The server forgot the old session's subscriptions; raw book and
+        // ticker channels need an authorized session, so every channel is
+        // resubscribed once public/auth succeeds.
         wsAuthenticate();
     });
 
     // Set close handler.
     wsClient.set_close_handler([this](connection_hdl /*hdl*/) {
         systemLogger->error("[Websocket Client] WebSocket closed. Attempting to reconnect...");
+        authenticated.store(false, std::memory_order_release);
         wsConnection.reset();
-        attemptReconnect();
+        // Books go stale now rather than when the next session opens, so
+        // nothing reads a frozen book as valid during the backoff. Requests
+        // still pending fail behind the responses already received.
+        dropQueuedSends();
+        enqueueFrame("connection closed", FrameKind::DISCONNECTED, nextRequestId.load() - 1);
+        scheduleReconnect();
     });
 
     // Set fail handler.
     wsClient.set_fail_handler([this](connection_hdl /*hdl*/) {
         systemLogger->error( " [Websocket Client] WebSocket connection failed. Attempting to reconnect...");
+        authenticated.store(false, std::memory_order_release);
         wsConnection.reset();
-        attemptReconnect();
+        dropQueuedSends();
+        enqueueFrame("connection failed", FrameKind::DISCONNECTED, nextRequestId.load() - 1);
+        scheduleReconnect();
     });
 }
 
@@ -93,7 +119,11 @@ WebsocketClient::~WebsocketClient() {
 void WebsocketClient::start() {
     if (running.load()) return;
     running.store(true);
+    consumerRunning.store(true);
+    consumerThread = std::make_unique<std::thread>(&WebsocketClient::consumerLoop, this);
     wsThread = std::make_unique<std::thread>(&WebsocketClient::websocketLoop, this);
+    pinThread(*consumerThread, options.consumerCpu, "consumer");
+    pinThread(*wsThread, options.ioCpu, "I/O");
     systemLogger->info(" [Websocket Client] Starting WebSocket client.");
 }
 
@@ -103,65 +133,416 @@ void WebsocketClient::stop() {
     if (wsThread && wsThread->joinable()) {
         wsThread->join();
     }
+    consumerRunning.store(false);
+    inbound->wakeConsumer();
+    if (consumerThread && consumerThread->joinable()) {
+        consumerThread->join();
+    }
+    // The limiter outlives this client; its queued sends point back here.
+    dropQueuedSends();
+    if (journal) {
+        journal->close();
+    }
+    RingStats ring = inbound->stats();
+    systemLogger->info("[Websocket Client] Receive ring: capacity={} published={} dropped={} high_watermark={} "
+                       "held_back={}", ring.capacity, ring.published, ring.dropped, ring.highWatermark,
+                       overflowed.load(std::memory_order_relaxed));
     systemLogger->info("[Websocket Client] WebSocket client stopped.");
 }
 
 void WebsocketClient::websocketLoop() {
+    connect();
+    // The run() call will block until stop() is called; reconnects happen inside it.
+    wsClient.run();
+}
+
+// ------------------ Receive ring ------------------ //
 
+// Market data notifications start {"jsonrpc":"2.0","method":"subscription",
+// "params":{"channel":"book....". Losing one costs a book resync at most;
+// tickers and trades are superseded by the next one. user.* notifications
+// carry the account's orders, trades and positions, which nothing resends, so
+// they are held back like responses, as is a frame whose channel is not found
+// where expected. Anything else may be the only answer to a request.
+static bool isDroppable(const std::string& payload) {
+    std::string_view head = std::string_view(payload).substr(0, 96);
+    if (head.find("\"method\":\"subscription\"") == std::string_view::npos) {
+        return false;
+    }
+    static const std::string_view channelKey = "\"channel\":\"";
+    size_t channel = head.find(channelKey);
+    return channel != std::string_view::npos && head.substr(channel + channelKey.size(), 5) != "user.";
+}
+
+// Runs on the I/O thread. Frames held back earlier go first, so a held-back
+// response is never overtaken by a later frame.
+void WebsocketClient::enqueueFrame(const std::string& payload, FrameKind kind, uint64_t lastRequestId) {
+    auto receivedAt = std::chrono::high_resolution_clock::now();
+    ReceivedFrame* slot = overflow.empty() || flushOverflow() ? inbound->tryClaim() : nullptr;
+    if (slot) {
+        slot->receivedAt = receivedAt;
+        slot->payload.assign(payload);
+        slot->kind = kind;
+        slot->lastRequestId = lastRequestId;
+        inbound->publish();
+        return;
+    }
+    if (kind == FrameKind::DATA && isDroppable(payload)) {
+        // Counted as a drop; the consumer resyncs the books once it catches up.
+        inbound->recordDrop();
+        return;
+    }
+    overflow.push_back(ReceivedFrame{receivedAt, payload, kind, lastRequestId});
+    overflowed.fetch_add(1, std::memory_order_relaxed);
+    scheduleOverflowFlush();
+}
+
+// Moves held-back frames into the ring. Returns true once none are left.
+bool WebsocketClient::flushOverflow() {
+    while (!overflow.empty()) {
+        ReceivedFrame* slot = inbound->tryClaim();
+        if (!slot) {
+            return false;
+        }
+        ReceivedFrame& held = overflow.front();
+        slot->receivedAt = held.receivedAt;
+        slot->payload.assign(held.payload); // keeps the slot's preallocated buffer
+        slot->kind = held.kind;
+        slot->lastRequestId = held.lastRequestId;
+        inbound->publish();
+        overflow.pop_front();
+    }
+    return true;
+}
+
+// Retries shortly even if no further frame arrives to trigger a flush.
+void WebsocketClient::scheduleOverflowFlush() {
+    if (overflowArmed) {
+        return;
+    }
+    overflowArmed = true;
+    overflowTimer->expires_after(std::chrono::microseconds(200));
+    overflowTimer->async_wait([this](const boost::system::error_code& ec) {
+        overflowArmed = false;
+        if (!ec && !flushOverflow()) {
+            scheduleOverflowFlush();
+        }
+    });
+}
+
+// ------------------ Connection ------------------ //
+
+void WebsocketClient::connect() {
     websocketpp::lib::error_code ec;
-    auto con = wsClient.get_connection("wss://test.deribit.com/ws/api/v2", ec);
+    auto con = wsClient.get_connection(options.url, ec);
     if (ec) {
         systemLogger->error("[Websocket Client] Websocket Connection error: {}", ec.message());
+        scheduleReconnect();
         return;
     }
     wsConnection = con->get_handle();
     wsClient.connect(con);
-    // The run() call will block until stop() is called.
-    wsClient.run();
 }
 
-void WebsocketClient::sendMessage(const json& message) {
+// Runs on the I/O thread. The delay is drawn from the upper half of the backoff
+// window so a fleet of clients does not reconnect in lockstep.
+void WebsocketClient::scheduleReconnect() {
+    if (!running.load()) {
+        return;
+    }
+    auto window = std::min(options.reconnectMaxDelay, options.reconnectBaseDelay * (1 << std::min(reconnectAttempts, 16u)));
+    std::uniform_int_distribution<int64_t> jitter(window.count() / 2, window.count());
+    std::chrono::milliseconds delay(jitter(reconnectRng));
+    ++reconnectAttempts;
+    systemLogger->info("[Websocket Client] Reconnect attempt {} in {} ms", reconnectAttempts, delay.count());
+    reconnectTimer->expires_after(delay);
+    reconnectTimer->async_wait([this](const boost::system::error_code& ec) {
+        if (!ec && running.load()) {
+            connect();
+        }
+    });
+}
+
+bool WebsocketClient::sendText(const std::string& msgStr) {
     if (!wsConnection.expired()) {
-        std::string msgStr = message.dump();
         websocketpp::lib::error_code ec;
         wsClient.send(wsConnection, msgStr, websocketpp::frame::opcode::text, ec);
         if (ec) {
             systemLogger->error("[Websocket Client] error while sending payload to server: {}" ,ec.message());
-        } else {
-            orderLogger->info("[Websocket Client] msg sent  through websocket.");
+            return false;
         }
+        return true;
     } else {
        	systemLogger->error("[Websocket Client] WebSocket not connected. Cannot send message.");
     }
+    return false;
+}
+
+// ------------------ JSON-RPC request correlation ------------------ //
+
+uint64_t WebsocketClient::sendRequest(const std::string& method, const json& params, RpcCallback callback,
+                                      LatencyProbe probe) {
+    uint64_t id = nextRequestId.fetch_add(1, std::memory_order_relaxed);
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", method},
+        {"params", params}
+    };
+    return sendPrepared(id, request.dump(), std::move(callback), probe);
+}
+
+// Sends at once while credits last. Otherwise the message is copied and
+// queued; the id is still returned and the callback runs once it is answered.
+// A queued request is already pending, so a disconnect fails it like one in
+// flight and it is never sent to the next session.
+uint64_t WebsocketClient::sendPrepared(uint64_t id, const std::string& message, RpcCallback callback,
+                                       LatencyProbe probe, RequestPriority priority) {
+    if (!rateLimiter || rateLimiter->tryAcquire(priority)) {
+        return sendNow(id, message, std::move(callback), probe, priority);
+    }
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.emplace(id, PendingRequest{std::move(callback), std::chrono::high_resolution_clock::now(), probe,
+                                           priority});
+    }
+    auto at = rateLimiter->submit(priority, [this, id, message]() { sendQueued(id, message); }, this);
+    if (at != RateLimiter::Clock::time_point()) {
+        scheduleDrain(at);
+    }
+    return id;
+}
+
+// Session control (public/auth) skips the limiter's queue: nothing queued can
+// be served until the session is authorized. It still takes a credit when one
+// is free.
+uint64_t WebsocketClient::sendSessionRequest(const std::string& method, const json& params,
+                                             RpcCallback callback) {
+    uint64_t id = nextRequestId.fetch_add(1, std::memory_order_relaxed);
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", method},
+        {"params", params}
+    };
+    if (rateLimiter) {
+        rateLimiter->tryAcquire(RequestPriority::QUERY);
+    }
+    return sendNow(id, request.dump(), std::move(callback), LatencyProbe::COUNT, RequestPriority::QUERY);
+}
+
+// Runs when a queued request gets its credit. Round trips are timed from
+// here; a request whose entry is gone was failed while it waited.
+void WebsocketClient::sendQueued(uint64_t id, const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = pending.find(id);
+        if (it == pending.end()) {
+            return;
+        }
+        it->second.sentAt = std::chrono::high_resolution_clock::now();
+    }
+    if (!sendText(message)) {
+        completeRequest(id, false, R"({"message":"not sent"})");
+    }
+}
+
+// The close and fail handlers run this before failing what is pending, so a
+// queued send cannot slip out between the two.
+void WebsocketClient::dropQueuedSends() {
+    if (!rateLimiter) {
+        return;
+    }
+    size_t dropped = rateLimiter->cancel(this);
+    if (dropped > 0) {
+        systemLogger->warn("[Websocket Client] Dropped {} rate-limited requests queued for the closed session.",
+                           dropped);
+    }
+}
+
+void WebsocketClient::post(std::function<void()> task) {
+    boost::asio::post(wsClient.get_io_service(), std::move(task));
+}
+
+// Posted to the I/O thread, which owns the timer; an earlier deadline re-arms it.
+void WebsocketClient::scheduleDrain(std::chrono::steady_clock::time_point at) {
+    boost::asio::post(wsClient.get_io_service(), [this, at]() {
+        if (drainArmed && drainTimer->expiry() <= at) {
+            return;
+        }
+        drainArmed = true;
+        drainTimer->expires_at(at);
+        drainTimer->async_wait([this](const boost::system::error_code& ec) {
+            if (ec) {
+                return; // re-armed for an earlier deadline, or stopping
+            }
+            drainArmed = false;
+            auto next = rateLimiter->drain();
+            if (next != RateLimiter::Clock::time_point()) {
+                scheduleDrain(next);
+            }
+        });
+    });
+}
+
+// Registers the pending entry before sending so a fast response always finds it.
+uint64_t WebsocketClient::sendNow(uint64_t id, const std::string& message, RpcCallback callback,
+                                  LatencyProbe probe, RequestPriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.emplace(id, PendingRequest{std::move(callback), std::chrono::high_resolution_clock::now(), probe,
+                                           priority});
+    }
+    if (!sendText(message)) {
+        completeRequest(id, false, R"({"message":"not sent"})");
+        return 0;
+    }
+    return id;
+}
+
+// Orders, edits and cancels are rendered from templates into a reused buffer.
+uint64_t WebsocketClient::sendOrderRequest(OrderRequest request, RpcCallback callback, LatencyProbe probe) {
+    static thread_local std::string message;
+    if (orderManager) {
+        OrderHandle handle = orderManager->submit(request);
+        OrderAction action = request.action;
+        callback = [this, handle, action, callback = std::move(callback)](const RpcResponse& response) {
+            if (orderManager) {
+                orderManager->onResponse(handle, action, response.ok, response.body, response.transportFailure);
+            }
+            if (callback) {
+                callback(response);
+            }
+        };
+    }
+    uint64_t id = nextRequestId.fetch_add(1, std::memory_order_relaxed);
+    messages.render(message, id, request);
+    return sendPrepared(id, message, std::move(callback), probe, requestPriority(request.action));
+}
+
+std::future<RpcResponse> WebsocketClient::request(const std::string& method, const json& params, LatencyProbe probe) {
+    auto promise = std::make_shared<std::promise<RpcResponse>>();
+    std::future<RpcResponse> future = promise->get_future();
+    sendRequest(method, params, [promise](const RpcResponse& response) {
+        promise->set_value(response);
+    }, probe);
+    return future;
+}
+
+void WebsocketClient::completeRequest(uint64_t id, bool ok, std::string_view body, bool transportFailure) {
+    PendingRequest entry;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = pending.find(id);
+        if (it == pending.end()) {
+            return;
+        }
+        entry = std::move(it->second);
+        pending.erase(it);
+    }
+    auto now = std::chrono::high_resolution_clock::now();
+    int64_t roundTrip = std::chrono::duration_cast<std::chrono::nanoseconds>(now - entry.sentAt).count();
+    // Deribit error 10028 when the account's request credits ran out.
+    if (!ok && rateLimiter && body.find("too_many_requests") != std::string_view::npos) {
+        rateLimiter->onThrottled(entry.priority);
+    }
+    if (entry.probe != LatencyProbe::COUNT) {
+        recordLatency(entry.probe, roundTrip);
+    }
+    if (entry.callback) {
+        entry.callback(RpcResponse{id, ok, std::string(body), roundTrip, transportFailure});
+    }
+}
+
+// Consumer thread. Requests sent after the loss (ids above lastRequestId)
+// belong to the next session and are left alone.
+void WebsocketClient::failPendingRequests(const std::string& reason, uint64_t lastRequestId) {
+    std::vector<uint64_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (const auto& entry : pending) {
+            if (entry.first <= lastRequestId) {
+                ids.push_back(entry.first);
+            }
+        }
+    }
+    // In id order, so callbacks see the requests in the order they were made.
+    std::sort(ids.begin(), ids.end());
+    json error = { {"message", reason} };
+    std::string body = error.dump();
+    for (uint64_t id : ids) {
+        completeRequest(id, false, body, true);
+    }
+}
+
+size_t WebsocketClient::pendingRequestCount() const {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pending.size();
+}
+
+// ------------------ Order entry ------------------ //
+
+uint64_t WebsocketClient::placeOrder(const std::string& instrument, double amount, const std::string& side,
+                                     const std::string& orderType, double price, RpcCallback callback,
+                                     const std::string& expiryDate, double strikePrice,
+                                     const std::string& optionType) {
+    OrderRequest request = OrderRequest::place(instrument, amount, side, orderType, price,
+                                               expiryDate, strikePrice, optionType);
+    orderLogger->info("[Websocket Client] Placing {} order for {}: Amount: {}, Type: {}", side, instrument, amount, orderType);
+    return sendOrderRequest(std::move(request), std::move(callback), LatencyProbe::WS_ORDER_RTT);
+}
+
+uint64_t WebsocketClient::modifyOrder(const std::string& orderId, double newAmount, double newPrice, RpcCallback callback) {
+    orderLogger->info("[Websocket Client] Modifying order {}: New Amount: {}, New Price: {}", orderId, newAmount, newPrice);
+    return sendOrderRequest(OrderRequest::edit(orderId, newAmount, newPrice), std::move(callback),
+                            LatencyProbe::WS_EDIT_RTT);
+}
+
+uint64_t WebsocketClient::cancelOrder(const std::string& orderId, RpcCallback callback) {
+    orderLogger->info("[Websocket Client] Canceling order: {}", orderId);
+    return sendOrderRequest(OrderRequest::cancel(orderId), std::move(callback), LatencyProbe::WS_CANCEL_RTT);
+}
+
+uint64_t WebsocketClient::sendOrder(const OrderRequest& request, RpcCallback callback) {
+    switch (request.action) {
+        case OrderAction::CANCEL:
+            return sendOrderRequest(request, std::move(callback), LatencyProbe::WS_CANCEL_RTT);
+        case OrderAction::EDIT:
+            return sendOrderRequest(request, std::move(callback), LatencyProbe::WS_EDIT_RTT);
+        default:
+            return sendOrderRequest(request, std::move(callback), LatencyProbe::WS_ORDER_RTT);
+    }
+}
+
+// ------------------ Subscriptions ------------------ //
+
+// Subscription acks only matter when they fail.
+static void logSubscribeResult(const RpcResponse& response) {
+    if (!response.ok) {
+        systemLogger->error("[Websocket Client] Subscribe request {} failed: {}", response.id, response.body);
+    }
 }
 
 void WebsocketClient::subscribeToOrderBook(const std::vector<std::string>& instruments) {
     // Get the token from the authentication module.
     std::string token = auth->getAccessToken();
  
-    json request = {
-        {"jsonrpc", "2.0"},
-        {"id", 1},
-        {"method", "public/subscribe"},
-        {"params", {
-            {"channels", json::array()},
-            {"token", token}
-        }}
+    json params = {
+        {"channels", json::array()},
+        {"token", token}
     };
 
-    for (const auto& instrument : instruments) {
-        std::string channel = "book." + instrument+".raw" ;
-        if (subscribedChannels.find(channel) == subscribedChannels.end()) {
-            request["params"]["channels"].push_back(channel);
-            subscribedChannels.insert(channel);
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    for (InstrumentId id : registry.intern(instruments)) {
+        if (id != kNoInstrument && !subscribedChannels[static_cast<size_t>(ChannelKind::BOOK)].test(id)) {
+            books.addBook(registry.name(id));
+            params["channels"].push_back(registry.channelName(ChannelKind::BOOK, id));
+            subscribedChannels[static_cast<size_t>(ChannelKind::BOOK)].set(id);
         }
     }
-    if (!request["params"]["channels"].empty()) {
-    	auto start=std::chrono::high_resolution_clock::now();
-    	sendMessage(request);
-    	auto end=std::chrono::high_resolution_clock::now();
-    	auto msg_delay = std::chrono::duration<double, std::micro>(end - start).count();
-        latencyLogger->info(" time taken to sent request to subscribe to  order book recieve a response in {} (microseconds)",msg_delay);  
+    if (!params["channels"].empty()) {
+    	ScopedLatency latency(LatencyProbe::SUBSCRIBE);
+    	sendRequest("public/subscribe", params, logSubscribeResult);
         systemLogger->info("[Websocket Client] subscribed to order book in instuments.");  
     }
 }
@@ -169,31 +550,22 @@ void WebsocketClient::subscribeToOrderBook(const std::vector<std::string>& instr
 void WebsocketClient::subscribeToMarketTrades(const std::vector<std::string>& instruments) {
     // Get the token from the authentication module.
     std::string token = auth->getAccessToken();
-    std::cout<<token;
 
-    json request = {
-        {"jsonrpc", "2.0"},
-        {"id", 2},
-        {"method", "public/subscribe"},
-        {"params", {
-            {"channels", json::array()},
-            {"token", token}
-        }}
+    json params = {
+        {"channels", json::array()},
+        {"token", token}
     };
 
-    for (const auto& instrument : instruments) {
-        std::string channel = "ticker." + instrument + ".raw";
-        if (subscribedChannels.find(channel) == subscribedChannels.end()) {
-            request["params"]["channels"].push_back(channel);
-            subscribedChannels.insert(channel);
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    for (InstrumentId id : registry.intern(instruments)) {
+        if (id != kNoInstrument && !subscribedChannels[static_cast<size_t>(ChannelKind::TICKER)].test(id)) {
+            params["channels"].push_back(registry.channelName(ChannelKind::TICKER, id));
+            subscribedChannels[static_cast<size_t>(ChannelKind::TICKER)].set(id);
         }
     }
-    if (!request["params"]["channels"].empty()) {
-    	auto start=std::chrono::high_resolution_clock::now();
-        sendMessage(request);
-        auto end=std::chrono::high_resolution_clock::now();
-        auto msg_delay = std::chrono::duration<double, std::micro>(end - start).count();
-        latencyLogger->info(" time taken to sent request to get market trades and recieve a response in {} (microseconds)",msg_delay);
+    if (!params["channels"].empty()) {
+    	ScopedLatency latency(LatencyProbe::SUBSCRIBE);
+        sendRequest("public/subscribe", params, logSubscribeResult);
         systemLogger->info("[Websocket Client] Subscribed to market data for {} instrument(s).", instruments.size());
 
 
@@ -202,55 +574,401 @@ void WebsocketClient::subscribeToMarketTrades(const std::vector<std::string>& in
     }
 }
 
-void WebsocketClient::requestCurrentPositions(const std::string& currency) {
+void WebsocketClient::subscribe(ChannelKind kind, const std::vector<std::string>& instruments) {
+    if (kind == ChannelKind::BOOK) {
+        subscribeToOrderBook(instruments);
+        return;
+    }
+    if (kind == ChannelKind::UNKNOWN) {
+        return;
+    }
+    json params = {
+        {"channels", json::array()},
+        {"token", auth->getAccessToken()}
+    };
+    size_t index = static_cast<size_t>(kind);
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    for (InstrumentId id : registry.intern(instruments)) {
+        if (id != kNoInstrument && !subscribedChannels[index].test(id)) {
+            params["channels"].push_back(registry.channelName(kind, id));
+            subscribedChannels[index].set(id);
+        }
+    }
+    if (!params["channels"].empty()) {
+        bool isPrivate = kind == ChannelKind::USER_ORDERS || kind == ChannelKind::USER_TRADES;
+        ScopedLatency latency(LatencyProbe::SUBSCRIBE);
+        sendRequest(isPrivate ? "private/subscribe" : "public/subscribe", params, logSubscribeResult);
+        systemLogger->info("[Websocket Client] Subscribed to {} channel(s).", params["channels"].size());
+    }
+}
+
+void WebsocketClient::subscribeToPortfolio(const std::string& currency) {
+    subscribeAccountChannel("user.portfolio." + currency);
+}
+
+void WebsocketClient::subscribeToUserChanges(const std::string& kind, const std::string& currency) {
+    subscribeAccountChannel("user.changes." + kind + "." + currency + ".raw");
+}
+
+// Account-wide private channels are not per instrument, so they are tracked by name.
+void WebsocketClient::subscribeAccountChannel(const std::string& channel) {
+    json params = {
+        {"channels", json::array({channel})},
+        {"token", auth->getAccessToken()}
+    };
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        if (std::find(accountChannels.begin(), accountChannels.end(), channel) == accountChannels.end()) {
+            accountChannels.push_back(channel);
+        }
+    }
+    ScopedLatency latency(LatencyProbe::SUBSCRIBE);
+    sendRequest("private/subscribe", params, logSubscribeResult);
+    systemLogger->info("[Websocket Client] Subscribed to {}.", channel);
+}
+
+void WebsocketClient::requestCurrentPositions(const std::string& currency, RpcCallback callback) {
     // Get the token from the authentication module.
     std::string token = auth->getAccessToken();
     
-    json request = {
-        {"jsonrpc", "2.0"},
-        {"id", 3},
-        {"method", "private/get_positions"},
-        {"params", {
-            {"currency", currency},
-            {"kind", "future"},
-            {"token", token}
-        }}
+    json params = {
+        {"currency", currency},
+        {"token", token}
     };
-	auto start=std::chrono::high_resolution_clock::now();
-    sendMessage(request);
-    auto end=std::chrono::high_resolution_clock::now();
-    auto msg_delay = std::chrono::duration<double, std::micro>(end - start).count();
-    latencyLogger->info(" time taken to send positions info and recieve a response is {} (microseconds)",msg_delay);
+    if (!callback) {
+        params["kind"] = "future";
+        callback = [](const RpcResponse& response) {
+            if (response.ok) {
+                positions->info("[Positions] {}\n\n", response.body);
+            } else {
+                systemLogger->error("[Websocket Client] Positions request failed: {}", response.body);
+            }
+        };
+    }
+    {
+        ScopedLatency latency(LatencyProbe::POSITIONS_REQUEST);
+        sendRequest("private/get_positions", params, std::move(callback));
+    }
     orderLogger->info("[Websocket Client] Requested current positions for currency: {}",currency);
 }
 
-void WebsocketClient::attemptReconnect() {
-    if (reconnectAttempts >= maxReconnectAttempts) {
-        systemLogger->error("[Websocket Client] Maximum reconnection attempts reached. Giving up."); 
+void WebsocketClient::requestOpenOrders(RpcCallback callback) {
+    json params = {
+        {"token", auth->getAccessToken()}
+    };
+    sendRequest("private/get_open_orders", params, std::move(callback));
+    orderLogger->info("[Websocket Client] Requested open orders");
+}
+
+// ------------------ Frame processing ------------------ //
+
+void WebsocketClient::consumerLoop() {
+    while (ReceivedFrame* frame = inbound->wait(options.waitStrategy, consumerRunning)) {
+        if (frame->kind == FrameKind::RECONNECTED) {
+            handleReconnected(frame->receivedAt);
+        } else if (frame->kind == FrameKind::DISCONNECTED) {
+            handleDisconnected(frame->payload, frame->lastRequestId);
+        } else {
+            processFrame(frame->payload, frame->receivedAt);
+        }
+        inbound->pop();
+
+        uint64_t drops = inbound->dropped();
+        if (drops != handledDrops) {
+            systemLogger->error("[Websocket Client] Receive ring overflowed ({} frames dropped). Resyncing books.",
+                                drops - handledDrops);
+            handledDrops = drops;
+            resyncAllBooks();
+        }
+    }
+}
+
+void WebsocketClient::processFrame(const std::string& payload, std::chrono::high_resolution_clock::time_point receivedAt) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    bool recognised = parser.parse(payload, *parsed);
+    auto parsed_time = std::chrono::high_resolution_clock::now();
+    if (recognised) {
+        handleParsedMessage(*parsed, payload);
+    } else {
+        handleJsonMessage(payload);
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    recordLatency(LatencyProbe::QUEUE_WAIT, std::chrono::duration_cast<std::chrono::nanoseconds>(start_time - receivedAt).count());
+    recordLatency(LatencyProbe::PARSE, std::chrono::duration_cast<std::chrono::nanoseconds>(parsed_time - start_time).count());
+    recordLatency(LatencyProbe::DISPATCH, std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - parsed_time).count());
+    recordLatency(LatencyProbe::FRAME_PROCESSING, std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - receivedAt).count());
+}
+
+// Frames were lost, so every book may have missed deltas.
+void WebsocketClient::resyncAllBooks() {
+    books.forEach([this](OrderBook& book) {
+        book.invalidate();
+        InstrumentId id = registry.find(book.getInstrument());
+        resyncBook(registry.channelName(ChannelKind::BOOK, id));
+    });
+}
+
+// Fallback path for frames the streaming parser does not recognise.
+void WebsocketClient::handleJsonMessage(const std::string& payload) {
+    try {
+        auto jsonMessage = json::parse(payload);
+         
+        // Check if the message contains subscription data.
+        if (jsonMessage.contains("params") && jsonMessage["params"].contains("channel")) {
+            std::string channel = jsonMessage["params"]["channel"];
+            ChannelKey key = registry.resolveChannel(channel);
+            if (key.kind == ChannelKind::BOOK) {
+                handleBookUpdate(key.instrument, channel, jsonMessage["params"]["data"]);
+                orderbook->info("[OrderBook] {}\n\n",jsonMessage.dump(4));
+            } else {
+                std::string data = jsonMessage["params"]["data"].dump();
+                if (key.kind == ChannelKind::TICKER) {
+                    storeTicker(key.instrument, data);
+                }
+                if (!dispatchChannelData(key, channel, data)) {
+                    dump->info("[Other] {}", channel ,":\n {}",
+                              jsonMessage.dump(4), "\n\n");
+                }
+            }
+        } else if (jsonMessage.contains("id") && jsonMessage["id"].is_number_unsigned()) {
+            // Responses complete the pending request with the same id.
+            uint64_t id = jsonMessage["id"].get<uint64_t>();
+            if (jsonMessage.contains("result")) {
+                completeRequest(id, true, jsonMessage["result"].dump());
+            } else {
+                completeRequest(id, false, jsonMessage.value("error", json::object()).dump());
+            }
+        } else {
+           
+            dump->info("[Raw Message]: {}\n" ,jsonMessage.dump(4));
+        }
+    } catch (const std::exception& e) {
+        systemLogger->error("Error parsing message: {}",e.what());
+    }
+}
+
+void WebsocketClient::handleParsedMessage(const ParsedMessage& message, const std::string& payload) {
+    switch (message.kind) {
+        case MessageKind::NOTIFICATION: {
+            // One table lookup turns the channel name into (kind, instrument id).
+            ChannelKey key = registry.resolveChannel(message.channel);
+            if (key.kind == ChannelKind::BOOK && message.hasBook) {
+                OrderBook* book = books.get(key.instrument);
+                if (book) {
+                    applyBookUpdate(*book, key.instrument, message.bookUpdate(), message.channel);
+                    TopOfBook top = book->topOfBook();
+                    binaryLogger->logBookDelta(message.instrument.data(), message.instrument.size(),
+                                               message.changeId, message.timestamp,
+                                               message.bidCount, message.askCount, top.bidPrice, top.askPrice);
+                }
+            } else {
+                if (key.kind == ChannelKind::TICKER) {
+                    storeTicker(key.instrument, message.data);
+                }
+                if (!dispatchChannelData(key, message.channel, message.data)) {
+                    dump->info("[Other] {}:\n {}\n\n", message.channel, message.data);
+                }
+            }
+            break;
+        }
+        case MessageKind::RESPONSE:
+            // Responses complete the pending request with the same id.
+            if (message.hasId) {
+                completeRequest(static_cast<uint64_t>(message.id), true, message.result);
+            }
+            break;
+        case MessageKind::ERROR_RESPONSE:
+            if (message.hasId) {
+                completeRequest(static_cast<uint64_t>(message.id), false, message.error);
+            } else {
+                systemLogger->error("[Websocket Client] Error response without id: {}", message.error);
+            }
+            break;
+        default:
+            dump->info("[Raw Message]: {}\n", payload);
+            break;
+    }
+}
+
+// Convert the bids/asks arrays of a book notification into level updates.
+static void readBookLevels(const json& side, std::vector<BookLevelUpdate>& out) {
+    out.clear();
+    for (const auto& level : side) {
+        // Grouped books send [price, amount] without an action.
+        if (!level[0].is_string()) {
+            out.push_back(BookLevelUpdate{BookAction::CHANGE, level[0].get<double>(), level[1].get<double>()});
+            continue;
+        }
+        const std::string& action = level[0].get_ref<const std::string&>();
+        BookAction act = BookAction::CHANGE;
+        if (action == "new") {
+            act = BookAction::NEW;
+        } else if (action == "delete") {
+            act = BookAction::DELETE;
+        }
+        out.push_back(BookLevelUpdate{act, level[1].get<double>(), level[2].get<double>()});
+    }
+}
+
+void WebsocketClient::handleBookUpdate(InstrumentId instrument, const std::string& channel, const json& data) {
+    OrderBook* book = books.get(instrument);
+    if (!book) {
         return;
     }
-    
-    int delay = std::min(1 << reconnectAttempts, maxReconnectDelay); 
-    systemLogger->info("[Websocket Client] Reconnecting in {}", delay, " seconds..." ); std::this_thread::sleep_for(std::chrono::seconds(delay));
-    ++reconnectAttempts;
-    websocketLoop();
+
+    readBookLevels(data["bids"], bidScratch);
+    readBookLevels(data["asks"], askScratch);
+
+    BookUpdate update{};
+    update.isSnapshot = data.value("type", "snapshot") == "snapshot";
+    update.changeId = data.value("change_id", int64_t(0));
+    update.prevChangeId = data.value("prev_change_id", int64_t(0));
+    update.timestamp = data.value("timestamp", int64_t(0));
+    update.bids = bidScratch.data();
+    update.bidCount = bidScratch.size();
+    update.asks = askScratch.data();
+    update.askCount = askScratch.size();
+
+    applyBookUpdate(*book, instrument, update, channel);
+}
+
+void WebsocketClient::applyBookUpdate(OrderBook& book, InstrumentId instrument, const BookUpdate& update,
+                                      std::string_view channel) {
+    int64_t lastChangeId = book.lastChangeId();
+    BookApplyResult result = book.apply(update);
+    if (result == BookApplyResult::APPLIED) {
+        if (reconnectPending && update.isSnapshot) {
+            reconnectPending = false;
+            int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now() - reconnectedAt).count();
+            recordLatency(LatencyProbe::RECONNECT_TO_BOOK, elapsed);
+            systemLogger->info("[Websocket Client] First valid book after reconnect ({}) in {} us",
+                               book.getInstrument(), elapsed / 1000);
+        }
+        dispatcher.dispatch(BookEvent{instrument, update, book});
+    } else if (result == BookApplyResult::SEQUENCE_GAP) {
+        systemLogger->error("[Websocket Client] Sequence gap on {} (prev_change_id {} != {}). Resyncing.",
+                            book.getInstrument(), update.prevChangeId, lastChangeId);
+        resyncBook(std::string(channel));
+    }
+}
+
+// Hands a non-book notification to the registered handlers. Returns false if
+// nobody took it, so the caller can log it instead.
+bool WebsocketClient::dispatchChannelData(const ChannelKey& key, std::string_view channel, std::string_view data) {
+    if (key.kind != ChannelKind::UNKNOWN) {
+        return dispatcher.dispatch(ChannelDataEvent{key.kind, key.instrument, data});
+    }
+    static const std::string_view portfolioPrefix = "user.portfolio.";
+    static const std::string_view changesPrefix = "user.changes.";
+    if (channel.compare(0, portfolioPrefix.size(), portfolioPrefix) == 0) {
+        return dispatcher.dispatch(PortfolioEvent{channel.substr(portfolioPrefix.size()), data});
+    }
+    if (channel.compare(0, changesPrefix.size(), changesPrefix) == 0) {
+        return dispatcher.dispatch(UserChangesEvent{channel.substr(changesPrefix.size()), data});
+    }
+    return false;
+}
+
+// Decoded on the consumer thread, the store's single writer.
+void WebsocketClient::storeTicker(InstrumentId instrument, std::string_view data) {
+    TickerSnapshot ticker;
+    if (parser.parseTicker(data, ticker)) {
+        tickerStore.store(instrument, ticker);
+    }
+}
+
+// Re-subscribing makes Deribit send a fresh snapshot for the channel.
+void WebsocketClient::resyncBook(const std::string& channel) {
+    json params = { {"channels", json::array({channel})} };
+    sendRequest("public/unsubscribe", params, nullptr);
+    sendRequest("public/subscribe", params, logSubscribeResult);
+}
+
+// Replays the tracked subscriptions on a new session, a batch of channels per request.
+void WebsocketClient::resubscribeAll(bool privateChannels) {
+    const size_t batchSize = 64;
+    std::vector<std::string> channels;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        for (size_t kind = 0; kind < kChannelKinds; ++kind) {
+            ChannelKind channelKind = static_cast<ChannelKind>(kind);
+            bool isPrivate = channelKind == ChannelKind::USER_ORDERS || channelKind == ChannelKind::USER_TRADES;
+            if (isPrivate != privateChannels) {
+                continue;
+            }
+            for (size_t id = 0; id < registry.size(); ++id) {
+                if (subscribedChannels[kind].test(id)) {
+                    channels.push_back(registry.channelName(channelKind, static_cast<InstrumentId>(id)));
+                }
+            }
+        }
+        if (privateChannels) {
+            channels.insert(channels.end(), accountChannels.begin(), accountChannels.end());
+        }
+    }
+    if (channels.empty()) {
+        return;
+    }
+    const char* method = privateChannels ? "private/subscribe" : "public/subscribe";
+    for (size_t start = 0; start < channels.size(); start += batchSize) {
+        size_t end = std::min(start + batchSize, channels.size());
+        json params = { {"channels", json(std::vector<std::string>(channels.begin() + start, channels.begin() + end))} };
+        sendRequest(method, params, logSubscribeResult);
+    }
+    systemLogger->info("[Websocket Client] Resubscribed {} {} channel(s).", channels.size(),
+                       privateChannels ? "private" : "public");
+}
+
+// The session's deltas stopped; every book waits for the snapshot its
+// resubscription brings. Every response the session delivered has been
+// handled by now, so what is still pending will not be answered.
+void WebsocketClient::handleDisconnected(const std::string& reason, uint64_t lastRequestId) {
+    books.invalidateAll();
+    systemLogger->info("[Websocket Client] Session lost; books marked stale until resynced.");
+    failPendingRequests(reason, lastRequestId);
+}
+
+// The books were invalidated when the old session ended.
+void WebsocketClient::handleReconnected(std::chrono::high_resolution_clock::time_point openedAt) {
+    reconnectPending = true;
+    reconnectedAt = openedAt;
+    systemLogger->info("[Websocket Client] Session reconnected; waiting for fresh book snapshots.");
 }
 
 
+void WebsocketClient::onAuthenticated(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(authListenerMutex);
+    authListeners.push_back(std::move(listener));
+}
+
 void WebsocketClient::wsAuthenticate() {
 
-    json authMessage = {
-        {"jsonrpc", "2.0"},
-        {"id", 0}, 
-        {"method", "public/auth"},
-        {"params", {
-            {"grant_type", "client_credentials"},
-            {"client_id", auth->getClientId()},      
-            {"client_secret", auth->getClientSecret()},
-            {"scope", "read_write"}
-        }}
+    json params = {
+        {"grant_type", "client_credentials"},
+        {"client_id", auth->getClientId()},      
+        {"client_secret", auth->getClientSecret()},
+        {"scope", "read_write"}
     };
-    sendMessage(authMessage);
+    // The result carries access tokens, so it is deliberately not logged.
+    sendSessionRequest("public/auth", params, [this](const RpcResponse& response) {
+        if (response.ok) {
+            systemLogger->info("[Websocket Client] WebSocket session authenticated.");
+            authenticated.store(true, std::memory_order_release);
+            resubscribeAll(false);
+            resubscribeAll(true);
+            std::vector<std::function<void()>> listeners;
+            {
+                std::lock_guard<std::mutex> lock(authListenerMutex);
+                listeners = authListeners;
+            }
+            for (const auto& listener : listeners) {
+                listener();
+            }
+        } else {
+            systemLogger->error("[Websocket Client] WebSocket authentication failed: {}", response.body);
+        }
+    });
    
 }
 
@@ -6,12 +6,109 @@
 #include "Authorisation.h"
 #include "RestClient.h"
 #include "WebsocketClient.h"
+#include "PositionEngine.h"
+#include "OrderManager.h"
+#include "RiskGate.h"
+#include "RateLimiter.h"
+#include "LatencyHistogram.h"
+#include "ScriptRunner.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <vector>
 #include <exception>
 #include <chrono>
 
 
-int main(){
+// A numeric .env setting, or 'fallback' when it is unset or not a number.
+static double envNumber(dotenv& env, const std::string& key, double fallback) {
+    std::string value = env.get(key);
+    if (value.empty()) {
+        return fallback;
+    }
+    try {
+        return std::stod(value);
+    } catch (const std::exception&) {
+        std::cerr << key << " is not a number, using " << fallback << std::endl;
+        return fallback;
+    }
+}
+
+// Headless mode: trading_app --script <file|-> [--out <file>] [--transport rest|websocket]
+//                             [--max-in-flight n] [--rest-window n]
+struct ScriptArgs {
+    std::string path;           // empty: interactive menu
+    std::string outPath;        // empty: stdout
+    std::string transport = "websocket";
+    ScriptOptions options;
+};
+
+static bool parseArgs(int argc, char** argv, ScriptArgs& args) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--script" && hasValue) {
+            args.path = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            args.outPath = argv[++i];
+        } else if (arg == "--transport" && hasValue) {
+            args.transport = argv[++i];
+        } else if (arg == "--max-in-flight" && hasValue) {
+            args.options.maxInFlight = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--rest-window" && hasValue) {
+            args.options.restWindow = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return args.transport == "rest" || args.transport == "websocket";
+}
+
+// Runs the command script once the WebSocket session is authenticated and writes JSONL results.
+static int runScript(Trade& trade, WebsocketClient& wsClient, const ScriptArgs& args) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!wsClient.isAuthenticated() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!wsClient.isAuthenticated()) {
+        std::cerr << "WebSocket session not authenticated; WebSocket commands will fail" << std::endl;
+    }
+    std::ifstream file;
+    if (args.path != "-") {
+        file.open(args.path);
+        if (!file) {
+            std::cerr << "Cannot open script " << args.path << std::endl;
+            return 1;
+        }
+    }
+    std::ofstream outFile;
+    if (!args.outPath.empty()) {
+        outFile.open(args.outPath);
+        if (!outFile) {
+            std::cerr << "Cannot open output " << args.outPath << std::endl;
+            return 1;
+        }
+    }
+    trade.setOrderTransport(args.transport == "rest" ? OrderTransport::REST : OrderTransport::WEBSOCKET);
+    ScriptRunner runner(trade, args.outPath.empty() ? std::cout : outFile, args.options);
+    ScriptSummary summary = runner.run(args.path == "-" ? std::cin : file);
+    std::cerr << summary.commands << " command(s), " << summary.ok << " ok, " << summary.failed << " failed in "
+              << summary.wallNs / 1000000 << " ms" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv){
+    ScriptArgs script;
+    if (!parseArgs(argc, argv, script)) {
+        std::cerr << "usage: " << argv[0] << " [--script <file|-> [--out <file>] [--transport rest|websocket]"
+                  << " [--max-in-flight n] [--rest-window n]]" << std::endl;
+        return 1;
+    }
+    if (!script.path.empty()) {
+        // Results may go to stdout, so console logging moves to stderr.
+        spdlog::set_default_logger(spdlog::stderr_color_mt("console"));
+    }
 	dotenv env(".env");
 	
     std::string clientId = env.get("DERIBIT_CLIENT_ID");
@@ -19,16 +116,88 @@ int main(){
     if(clientId.empty() || clientSecret.empty()){
     	std::cerr<<"ENV variables not loaded properly"<<std::endl;
     }
+    int exitCode = 0;
     try {
         
-        Authorization auth(clientId, clientSecret);
-        RestClient restClient(&auth);
-        WebsocketClient wsClient(&auth);
+        // Endpoints default to Deribit testnet; override them to run against bin/mock_exchange.
+        HttpPoolOptions httpOptions;
+        if (!env.get("DERIBIT_REST_URL").empty()) {
+            httpOptions.baseUrl = env.get("DERIBIT_REST_URL");
+        }
+        httpOptions.verifyPeer = env.get("DERIBIT_TLS_INSECURE") != "1";
+        Authorization auth(clientId, clientSecret, httpOptions);
+        // One credit budget for both sessions; set RATE_* to the account's limits.
+        // Declared before the clients so it outlives the WebSocket I/O thread's drain timer.
+        RateLimitOptions rateOptions;
+        rateOptions.matchingEngine.rate = envNumber(env, "RATE_MATCHING_PER_SEC", rateOptions.matchingEngine.rate);
+        rateOptions.matchingEngine.burst = envNumber(env, "RATE_MATCHING_BURST", rateOptions.matchingEngine.burst);
+        rateOptions.nonMatchingEngine.rate = envNumber(env, "RATE_NON_MATCHING_PER_SEC", rateOptions.nonMatchingEngine.rate);
+        rateOptions.nonMatchingEngine.burst = envNumber(env, "RATE_NON_MATCHING_BURST", rateOptions.nonMatchingEngine.burst);
+        RateLimiter rateLimiter(rateOptions);
+        RestClient restClient(&auth, httpOptions);
+        WebsocketClientOptions wsOptions;
+        if (!env.get("DERIBIT_WS_URL").empty()) {
+            wsOptions.url = env.get("DERIBIT_WS_URL");
+        }
+        // Raw frame capture for offline replay, off unless CAPTURE_DIR is set.
+        wsOptions.captureDirectory = env.get("CAPTURE_DIR");
+        WebsocketClient wsClient(&auth, wsOptions);
+        restClient.setRateLimiter(&rateLimiter);
+        wsClient.setRateLimiter(&rateLimiter);
         wsClient.start();
+        startLatencyReporter(std::chrono::seconds(10));
+        // Positions and PnL from user.changes / user.portfolio after one snapshot.
+        PositionEngine positionEngine(wsClient);
+        positionEngine.start({"BTC", "ETH", "USDC", "USDT"});
+        // Live orders from both transports' responses and user.changes / user.orders.
+        OrderManager orderManager(wsClient);
+        // Pre-trade limits from .env; a limit set to 0 is off. Attached before the
+        // open orders are loaded so they count against the open-order limit.
+        RiskConfig riskConfig;
+        riskConfig.defaults.maxOrderSize = envNumber(env, "RISK_MAX_ORDER_SIZE", 0.0);
+        riskConfig.defaults.maxNotional = envNumber(env, "RISK_MAX_NOTIONAL", 0.0);
+        riskConfig.defaults.priceCollar = envNumber(env, "RISK_PRICE_COLLAR", 0.05);
+        riskConfig.defaults.maxPosition = envNumber(env, "RISK_MAX_POSITION", 0.0);
+        riskConfig.maxGrossNotional = envNumber(env, "RISK_MAX_GROSS_NOTIONAL", 0.0);
+        riskConfig.maxOpenOrders = static_cast<int>(envNumber(env, "RISK_MAX_OPEN_ORDERS", 200));
+        riskConfig.requireReferencePrice = env.get("RISK_REQUIRE_REFERENCE_PRICE") == "1";
+        RiskGate riskGate(wsClient, &positionEngine, riskConfig);
+        // Orders are only accepted for instruments loaded here: everything the
+        // menu can trade plus the comma-separated RISK_INSTRUMENTS.
+        for (int i = 0; i < 2; ++i) {
+            riskGate.setLimits(Trade::spotInstrumentToString(static_cast<SpotInstrument>(i)));
+            riskGate.setLimits(Trade::optionsInstrumentToString(static_cast<OptionsInstrument>(i)));
+        }
+        for (int i = 0; i < 6; ++i) {
+            riskGate.setLimits(Trade::futuresInstrumentToString(static_cast<FuturesInstrument>(i)));
+        }
+        std::string riskInstruments = env.get("RISK_INSTRUMENTS");
+        for (size_t start = 0; start < riskInstruments.size();) {
+            size_t comma = std::min(riskInstruments.find(',', start), riskInstruments.size());
+            if (comma > start) {
+                riskGate.setLimits(riskInstruments.substr(start, comma - start));
+            }
+            start = comma + 1;
+        }
+        riskGate.attach(orderManager);
+        restClient.setOrderManager(&orderManager);
+        orderManager.start();
+        // Queue depths and risk counters next to the wait histograms in each report.
+        LatencyReportHook statsReport([&rateLimiter, &riskGate](const char* label) {
+            rateLimiter.logStats(label);
+            riskGate.logStats(label);
+        });
         Trade trade(&restClient, &wsClient);
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+        trade.setPositionEngine(&positionEngine);
+        trade.setOrderManager(&orderManager);
+        trade.setRiskGate(&riskGate);
+        if (!script.path.empty()) {
+            exitCode = runScript(trade, wsClient, script);
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(5));
+        }
         
-        bool running = true;
+        bool running = script.path.empty();
         while (running) {
             std::cout << "\n=== Trade Engine Menu ===\n";
             std::cout << "1. Place Spot Order\n";
@@ -40,6 +209,10 @@ int main(){
             std::cout << "7. Subscribe to Order Book (WebSocket)\n";
             std::cout << "8. Subscribe to Market Trades (WebSocket)\n";
             std::cout << "9. Exit\n";
+            std::cout << "10. Toggle order transport (current: "
+                      << (trade.getOrderTransport() == OrderTransport::REST ? "REST" : "WebSocket") << ")\n";
+            std::cout << "11. Place Limit Order Ladder (batch)\n";
+            std::cout << "12. View Open Orders\n";
             std::cout << "Enter your choice: ";
             
             int choice;
@@ -220,17 +393,69 @@ int main(){
                 case 9:
                     running = false;
                     break;
+                case 10:
+                    trade.setOrderTransport(trade.getOrderTransport() == OrderTransport::REST
+                                            ? OrderTransport::WEBSOCKET : OrderTransport::REST);
+                    break;
+                case 11: {
+                    // Place a ladder of limit orders as one concurrent batch
+                    std::string instrument;
+                    int sideChoice, legs;
+                    double amount, startPrice, step;
+                    std::cout << "\nEnter instrument: ";
+                    std::cin >> instrument;
+                    std::cout << "Select side (1 = BUY, 2 = SELL): ";
+                    std::cin >> sideChoice;
+                    std::cout << "Enter amount per leg: ";
+                    std::cin >> amount;
+                    std::cout << "Enter first price: ";
+                    std::cin >> startPrice;
+                    std::cout << "Enter price step: ";
+                    std::cin >> step;
+                    std::cout << "Enter number of legs: ";
+                    std::cin >> legs;
+                    std::string side = (sideChoice == 1) ? "buy" : "sell";
+                    std::vector<OrderRequest> batch;
+                    for (int i = 0; i < legs; ++i) {
+                        batch.push_back(OrderRequest::place(instrument, amount, side, "limit", startPrice + i * step));
+                    }
+                    auto start = std::chrono::high_resolution_clock::now();
+                    std::vector<OrderResult> results = trade.executeBatch(batch);
+                    auto end = std::chrono::high_resolution_clock::now();
+                    for (size_t i = 0; i < results.size(); ++i) {
+                        std::cout << "Leg " << i + 1 << " @ " << batch[i].price << ": " << results[i].result
+                                  << " (" << results[i].latencyNs / 1000 << " us)\n";
+                    }
+                    std::cout << "Batch wall time: "
+                              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n";
+                    break;
+                }
+                case 12:
+                    trade.viewOpenOrders();
+                    break;
                 default:
                     std::cout << "Invalid option. Please try again.\n";
             }
         }
         
-        std::cout << "Exiting trade engine.\n";
+        rateLimiter.logStats("session");
+        riskGate.logStats("session");
+        AuthStats authStats = auth.stats();
+        systemLogger->info("[Auth] Session: refreshes={} failures={} last_refresh={}us token_expires_at={}",
+                           authStats.refreshes, authStats.failures, authStats.lastRefreshNs / 1000,
+                           authStats.expiryTime);
+        if (script.path.empty()) {
+            std::cout << "Exiting trade engine.\n";
+        }
     } catch (const std::exception exp) {
         std::cerr << "Fatal error: " << exp.what() << std::endl;
+        stopLatencyReporter();
+        shutdownLogger();
         return 1;
     }
+    stopLatencyReporter();
+    shutdownLogger();
 
     
-	return 0;
+	return exitCode;
 }